@@ -12,6 +12,9 @@ extern void hardFaultHandler(void);
 extern void toieHandler(void);
 extern void k70UartInterrupt(void);
 extern void pdbHandler(void);
+extern void adcHandler(void);
+extern void portdHandler(void);
+extern void porteHandler(void);
 extern void systickHandler(void);
 extern void pendsvHandler(void);
 
@@ -149,7 +152,7 @@ void (* const InterruptVector[])() __attribute__ ((section(".vectortable"))) = {
     Default_Handler,	/* IRQ55 */
     Default_Handler,	/* IRQ56 */
     Default_Handler,	/* IRQ57 */
-    Default_Handler,	/* IRQ58 */
+    adcHandler,	/* IRQ58 */
     Default_Handler,	/* IRQ59 */
     Default_Handler,	/* IRQ60 */
     Default_Handler,	/* IRQ61 */
@@ -181,8 +184,8 @@ void (* const InterruptVector[])() __attribute__ ((section(".vectortable"))) = {
     Default_Handler,	/* IRQ87 */
     Default_Handler,	/* IRQ88 */
     Default_Handler,	/* IRQ89 */
-    Default_Handler,	/* IRQ90 */
-    Default_Handler,	/* IRQ91 */
+    portdHandler,	/* IRQ90 */
+    porteHandler,	/* IRQ91 */
     Default_Handler,	/* IRQ92 */	
     Default_Handler,	/* IRQ93 */
     Default_Handler,	/* IRQ94 */
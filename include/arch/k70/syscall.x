@@ -13,9 +13,18 @@
     X(TRYLOCK,    trylock,   0)  \
     X(LOCK,       lock,      1)  \
     X(UNLOCK,     unlock,    1)  \
-    X(WAITPID,    waitpid,   1)  \
+    X(WAITPID,    waitpid,   0)  \
     X(EXITS,      _exits,    1)  \
     X(POSTSIGNAL, postsignal, 0) \
-    X(SLEEP,      sleep,     0)
+    X(SLEEP,      sleep,     0)  \
+    X(READV,      readv,     0)  \
+    X(WRITEV,     writev,    0)  \
+    X(SPAWN,      spawn,     0)  \
+    X(PIPE,       pipe,      0)  \
+    X(SIGRETURN,  sigreturn, 1)  \
+    X(MALLOC,     malloc,    0)  \
+    X(FREE,       free,      1)  \
+    X(GETCWD,     getcwd,    0)  \
+    X(BOOTWAIT,   bootwait,  0)
 
 
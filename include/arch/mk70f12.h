@@ -42,7 +42,7 @@ typedef uint32_t uintptr_t;
 void mcgInit(void);
 void sdramInit(void);
 
-#define SDRAM_START 0x8007f800 /* 0x80000000 + LCD_SDRAM_SIZE */
+#define SDRAM_START 0x800ff000 /* 0x80000000 + LCD_SDRAM_FRAMES * LCD_SDRAM_SIZE */
 
 #endif /* PLATFORM_K70CW */
 
@@ -53,6 +53,7 @@ void sdramInit(void);
 #define LCD_BPP   4
 #define LCD_SDRAM_START BASE_RAM
 #define LCD_SDRAM_SIZE 522240    /* LCD_XSIZE * LCD_YSIZE * LCD_BPP */
+#define LCD_SDRAM_FRAMES 2       /* mirrored for scrolling by panning */
 
 /* NVIC IRQ constants */
 #define NVIC_IRQ_DMA0       0
@@ -171,13 +172,26 @@ void sdramInit(void);
 #define FLEX_TIMER_CLOCK_FIXED  2
 #define FLEX_TIMER_CLOCK_EXTERN 3
 
-#define MANOS_ARCH_K70_STACK_SIZE (32 * 1024)
+#define MANOS_ARCH_K70_STACK_SIZE     (32 * 1024) /* default, and the largest stack class */
+#define MANOS_ARCH_K70_MIN_STACK_SIZE (2 * 1024)  /* smallest stack class */
+#define MANOS_ARCH_K70_STACK_POOL     4           /* free stacks kept per class */
+#define MANOS_ARCH_K70_STACK_ARENA    (1024 * 1024) /* Proc stacks carved from one block the MPU can fence */
 
 #define MANOS_ARCH_K70_CYCLES_PER_MILLIS 120000
+#define MANOS_ARCH_K70_RESET_CYCLES_PER_MILLIS 20972 /* the FLL the core runs on out of reset, until mcgInit() */
+
+/* core debug and FPU bits the derivative header leaves out */
+#define MANOS_ARCH_K70_DEMCR_TRCENA       (1u << 24)
+#define MANOS_ARCH_K70_DWT_CTRL_CYCCNTENA (1u << 0)
+#define MANOS_ARCH_K70_FPCCR              (*(volatile uint32_t*)0xE000EF34u)
+#define MANOS_ARCH_K70_FPCCR_ASPEN        (1u << 31)
+#define MANOS_ARCH_K70_FPCCR_LSPEN        (1u << 30)
 
 #define MANOS_ARCH_K70_SVC_INT_PRIORITY 15
 #define MANOS_ARCH_K70_SCHED_INT_PRIORITY 14
 #define MANOS_ARCH_K70_TIMER_PRIORITY   13
 #define MANOS_ARCH_K70_UART2_PRIORITY   13
+#define MANOS_ARCH_K70_ADC1_PRIORITY    13
+#define MANOS_ARCH_K70_SWPB_PRIORITY    13
 
 #endif /* ! MANOS_ARCH_MK70F12_H */
@@ -6,6 +6,7 @@
 #include "arch/mk70f12.h"
 
 #define MANOS_QUANTUM_IN_MILLIS 50
+#define MANOS_KLOG_DRAIN 64 /* console bytes fed from the log per scheduler interrupt, when it has no kick */
 
 #ifdef NDEBUG
 #include <assert.h>
@@ -16,7 +17,7 @@
 #include <stdlib.h>
 #define ASSERT(x) do {                                                                      \
     if (!(x)) {                                                                             \
-        sysprintln("Assertion failed: %s (%s: %s: %d)", #x, __FILE__, __func__, __LINE__);  \
+        sysklog(KlogEmerg, "Assertion failed: %s (%s: %s: %d)\n", #x, __FILE__, __func__, __LINE__); \
         __asm volatile ("bkpt");                                                            \
         abort();                                                                            \
     }                                                                                       \
@@ -63,6 +64,29 @@ static inline void leaveCriticalRegion(void) {
 #define YIELD() while(0)
 #endif
 
+#ifdef PLATFORM_K70CW
+#define NOINIT __attribute__((section(".noinit"))) /* left alone by startup, survives a reset */
+#else
+#define NOINIT
+#endif
+
+#ifdef PLATFORM_K70CW
+#define KERNEL_DATA __attribute__((section(".data.kernel"))) /* read-only to user mode, see initMpu() */
+#else
+#define KERNEL_DATA
+#endif
+
+#ifdef PLATFORM_K70CW
+#define CYCLE_COUNT() (DWT_CYCCNT)
+#define START_CYCLE_COUNT() do {                    \
+    DEMCR    |= MANOS_ARCH_K70_DEMCR_TRCENA;        \
+    DWT_CTRL |= MANOS_ARCH_K70_DWT_CTRL_CYCCNTENA;  \
+} while (0)
+#else
+#define CYCLE_COUNT() 0
+#define START_CYCLE_COUNT() while(0)
+#endif
+
 #ifdef PLATFORM_K70CW
 #define START_SYSTICK() (SYST_CSR |= SysTick_CSR_ENABLE_MASK)
 #define STOP_SYSTICK() (SYST_CSR &= ~(SysTick_CSR_ENABLE_MASK))
@@ -75,9 +99,14 @@ static inline void leaveCriticalRegion(void) {
 
 #define MANOS_MAXPROC 127 /* kernel is proc 0 */
 
-#define MANOS_MAXDEV 8
+#define MANOS_MAXDEV 9
 extern Dev* deviceTable[MANOS_MAXDEV];
 
+#define MANOS_MAXPIPE 16
+#define MANOS_PIPE_SIZE 512 /* bytes buffered in each pipe */
+
+#define MANOS_MAXMEX 8 /* cached executable images */
+
 #define MANOS_MAXUART 2
 extern UartHW* uartHardwareTable[MANOS_MAXUART];
 
@@ -87,8 +116,8 @@ extern TimerHW* timerHardwareTable[MANOS_MAXTIMER];
 extern Timer* hotpluggedTimers;
 
 extern Lock malLock;
-extern Lock freelistLock;
 extern ListHead procFreelist;
+extern ListHead procSpawnQ; /* Procs waiting for a free slot */
 extern Lock runQLock;
 extern ListHead procRunQ;
 extern Ref nextPid;
@@ -6,34 +6,83 @@
 #include <stdint.h>
 
 Pid getpid(void);
-Proc* newProc(void);
+Proc* newProc(size_t);
+Proc* spawnProc(size_t, long);
 void recycleProc(Proc*);
+void freeProc(Proc*);
+void exitProc(Proc*);
 void abortProc(Proc*);
 
 void wakeWaiting(Proc*);
+void wakeUp(ListHead*);
+void wakeUpOne(ListHead*);
+void wakeProc(Pid);
+int sleepOn(ListHead*, long);
+
+int armAlarm(Pid, long);
+int armWakeAlarm(Pid, long);
+void cancelAlarm(int);
+void cancelAlarms(Pid);
+
+Proc* allocStack(Proc*, size_t);
+void freeStack(Proc*);
+size_t stackHighWater(const Proc*);
+int getStackArena(uintptr_t*, uintptr_t*);
+int getStackRegion(const Proc*, uintptr_t*, uintptr_t*);
+
+int allocFd(FdTable*, Portal*);
+Portal* freeFd(FdTable*, int);
+Portal* lookupFd(const FdTable*, int);
+void releaseFdTable(FdTable*);
+
+int newPipe(Portal* [2]);
 
 ProcGroup* newProcGroup(int);
 void leaveProcGroup(ProcGroup*);
 void joinProcGroup(ProcGroup*, Proc*);
 
+Environ* mkEnviron(unsigned, size_t);
+char* appendEnviron(Environ*, const char*, size_t, const char*, size_t);
+Environ* holdEnviron(Environ*);
+void releaseEnviron(Environ*);
+const char* lookupEnviron(const Environ*, const char*);
+
+MexImage* findMex(const NodeInfo*);
+MexImage* loadMex(const NodeInfo*, const void*, size_t);
+void* instanceMex(const MexImage*);
+MexImage* holdMex(MexImage*);
+void releaseMex(MexImage*);
+
 void* kmalloc(size_t);
 void kfree(void*);
 
 void kmallocDump(void);
+void kmallocStats(KmallocStats*);
+const char* kmallocRegionStats(unsigned, KmallocStats*);
+int kmallocRegionMeta(unsigned, uintptr_t*, uintptr_t*);
 
 void* syskmalloc(size_t);
 void* syskmalloc0(size_t);
+void* syskmallocHint(size_t, MemHint);
 void syskfree(void*);
 
 void* kmemset(void*,int,size_t);
+void* kmemcpy(void*,const void*,size_t);
+void* kmemmove(void*,const void*,size_t);
 
-void syswaitpid(int);
+int syswaitpid(int, int*, int);
 int syspostsignal(Pid, ProcSig);
 int syssleep(long);
 
 int setSignalMask(uint32_t, uint32_t*);
 int setSignalBlock(uint32_t, uint32_t*);
 int setSignalUnblock(uint32_t, uint32_t*);
+int setSignalHandler(ProcSig, SigHandler, SigHandler*);
+int queueSignal(Proc*, ProcSig);
+ProcSig takeSignal(Proc*, uint32_t);
+void flushSignals(Proc*);
+uint32_t caughtSignals(const Proc*);
+SigHandler signalHandler(const Proc*, ProcSig);
 
 WalkTrail* emptyWalkTrail(unsigned);
 void freeWalkTrail(WalkTrail*);
@@ -81,13 +130,18 @@ int setInfoDev(Portal*, NodeInfo*);
 
 DeviceIndex fromDeviceId(DeviceId);
 DeviceId toDeviceId(DeviceIndex);
+void bringUpDevice(DeviceIndex);
 
 int sysexecv(const char*, char * const []);
+int sysspawn(const char*, char * const [], const SpawnAttr*, long);
+int syspipe(int [2]);
 int sysgetInfoFd(int fd, NodeInfo*);
 int sysopen(const char*, Caps);
 void sysclose(int);
 ptrdiff_t sysread(int, void*, size_t);
 ptrdiff_t syswrite(int, void*, size_t);
+ptrdiff_t sysreadv(int, const IoVec*, unsigned);
+ptrdiff_t syswritev(int, const IoVec*, unsigned);
 int sysuartctl(Uart*, const char*);
 Portal* syswalk(Portal*, char**, unsigned);
 
@@ -97,6 +151,7 @@ void sysunlock(Lock*);
 
 int dirread(int fd, NodeInfo**);
 char* getcwd(char*, size_t);
+char* sysgetcwd(char*, size_t);
 
 Path* mkPath(const char*);
     
@@ -110,6 +165,25 @@ void sysputs(const char*);
 int sysprintln(const char*, ...);
 int sysprint(const char*, ...);
 
+int sysklog(KlogLevel, const char*, ...);
+void klogWrite(KlogLevel, const char*, size_t);
+void drainKlog(size_t);
+size_t takeKlog(char*, size_t);
+void flushKlog(void);
+size_t readKlog(char*, size_t, Offset);
+size_t tailKlog(char*, size_t);
+
+void recordCrash(const CrashRegs*, int);
+size_t readCrash(char*, size_t, Offset);
+void clearCrash(void);
+
+void bootMark(BootPhase);
+int bootMarked(BootPhase);
+int bootWait(BootPhase, long);
+int bootMarkName(const char*, size_t);
+size_t readBoot(char*, size_t, Offset);
+int bootDeferred(int, char * const []);
+
 int fputchar(int, char);
 int fputstrn(int, const char*, size_t);
 int fputstr(int, const char*);
@@ -120,6 +194,22 @@ int fprintln(int, const char*, ...);
 ptrdiff_t fmtVsnprintf(char [], size_t, const char*, va_list);
 ptrdiff_t fmtSnprintf(char [], size_t, const char*, ...);
 ptrdiff_t fmtSprintf(char [], const char*, ...);
+ptrdiff_t fmtCopy(char [], size_t, const char*, size_t);
+
+/*
+ * Compile time fast path: a format the compiler can see holds no '%'
+ * is copied or written as it is, without a call into the formatter.
+ * Any other format, or one only known at run time, goes through it.
+ */
+#ifdef __GNUC__
+#define FMT_IS_PLAIN(fmt) (__builtin_constant_p(fmt) && __builtin_strchr((fmt), '%') == NULL)
+#define fmtSnprintf(buf, n, fmt, ...)                                   \
+    (FMT_IS_PLAIN(fmt) ? fmtCopy((buf), (n), (fmt), __builtin_strlen(fmt)) \
+                       : (fmtSnprintf)((buf), (n), (fmt), ##__VA_ARGS__))
+#define fprint(fd, fmt, ...)                                            \
+    (FMT_IS_PLAIN(fmt) ? fputstrn((fd), (fmt), __builtin_strlen(fmt))   \
+                       : (fprint)((fd), (fmt), ##__VA_ARGS__))
+#endif
 
 FifoQ* newFifoQ(size_t);
 FifoQ* clearFifoQ(FifoQ*);
@@ -143,6 +233,11 @@ void svcInit(uint8_t);
 void svcHandler(void);
 void hardFaultHandler(void);
 void enableNvicIrq(unsigned, uint8_t);
+void initMpu(void);
+void switchMpu(const Proc*);
+int mpuFault(uint32_t*);
+void debounceSwpb(void);
+void tickLed(void);
 void schedInit(int, uint8_t);
 
 /*
@@ -156,20 +251,27 @@ int getRef(Ref*);
 int incRef(Ref*);
 int decRef(Ref*);
 
-void waitpid(int);
+int waitpid(int, int*, int);
 
 /*
  * System calls
  */
 int kexec(const char*, char * const []);
+int kspawn(const char*, char * const [], const SpawnAttr*, long);
+int kpipe(int [2]);
 void kclose(int);
 int kfstat(int, NodeInfo*);
 int kopen(const char*, Caps);
 ptrdiff_t kread(int, void*, size_t);
 ptrdiff_t kwrite(int, void*, size_t);
+ptrdiff_t kreadv(int, const IoVec*, unsigned);
+ptrdiff_t kwritev(int, const IoVec*, unsigned);
 void _exits(void);
+void ksigreturn(void);
 void exits(void);
 int sleep(long);
+int postsignal(Pid, ProcSig);
+int kbootwait(BootPhase, long);
 
 #define ATOMIC(expr) do {   \
     enterCriticalRegion();  \
@@ -24,6 +24,7 @@ typedef int OnOff;
 #define DEV_DEVADC   'A'
 #define DEV_DEVTIMER 'T'
 #define DEV_DEVDEV   '='
+#define DEV_DEVPIPE  '|'
 
 #define CAP_READ      0
 #define CAP_WRITE     1
@@ -128,6 +129,165 @@ typedef struct Portal {
     Offset      offset;
 } Portal;
 
+#define MANOS_MAXIOV 16
+
+/**
+ * struct IoVec - one span of a scatter/gather transfer
+ * @base: start of the span
+ * @len:  bytes in the span
+ */
+typedef struct IoVec {
+    void*  base;
+    size_t len;
+} IoVec;
+
+/**
+ * struct AdcSample - one streamed ADC conversion
+ * @msecs:   systime at the conversion, truncated to 32 bits
+ * @channel: ADC channel converted
+ * @value:   conversion result
+ */
+typedef struct AdcSample {
+    uint32_t msecs;
+    uint16_t channel;
+    uint16_t value;
+} AdcSample;
+
+/**
+ * struct AdcBlock - header of a /dev/adc/stream read
+ * @count:   AdcSamples following the header
+ * @dropped: samples overwritten unread since the previous block
+ */
+typedef struct AdcBlock {
+    uint32_t count;
+    uint32_t dropped;
+} AdcBlock;
+
+/**
+ * struct SwpbEvent - one record of /dev/swpb/events
+ * @msecs:   systime when the button settled, truncated to 32 bits
+ * @button:  1 or 2
+ * @pressed: 1 when the button went down, 0 when it came up
+ * @pad:     zero
+ */
+typedef struct SwpbEvent {
+    uint32_t msecs;
+    uint8_t  button;
+    uint8_t  pressed;
+    uint16_t pad;
+} SwpbEvent;
+
+/**
+ * struct LedLevel - one record of /dev/led/wave (NICE)
+ * @msecs: LED engine tick at which the level was programmed
+ * @led:   0 orange, 1 yellow, 2 green, 3 blue
+ * @duty:  percent of each PWM period the LED is on
+ * @pad:   zero
+ */
+typedef struct LedLevel {
+    uint32_t msecs;
+    uint8_t  led;
+    uint8_t  duty;
+    uint16_t pad;
+} LedLevel;
+
+/*
+ * Where kmalloc looks first. Either way it falls back to the other
+ * region when the first is full.
+ */
+typedef enum {
+    MemAny,  /* by size, small from on-chip SRAM and the rest from SDRAM */
+    MemFast, /* on-chip SRAM, for hot kernel objects */
+    MemBulk, /* SDRAM, for buffers */
+} MemHint;
+
+/**
+ * struct KmallocStats - allocator summary
+ * @total:  bytes of heap
+ * @inUse:  bytes allocated now
+ * @hwm:    most bytes ever allocated at once
+ * @allocs: allocations made
+ * @frees:  allocations released
+ */
+typedef struct KmallocStats {
+    uint32_t total;
+    uint32_t inUse;
+    uint32_t hwm;
+    uint32_t allocs;
+    uint32_t frees;
+} KmallocStats;
+
+/**
+ * struct CrashRegs - the machine state of a fault
+ * @cfsr:      configurable fault status
+ * @hfsr:      hard fault status
+ * @mmfar:     memory manage fault address
+ * @bfar:      bus fault address
+ * @mpuAddr:   address the MPU refused, 0 when it refused nothing
+ * @excReturn: EXC_RETURN of the fault
+ * @frame:     stacked r0-r3, r12, lr, pc, xpsr
+ */
+typedef struct CrashRegs {
+    uint32_t cfsr;
+    uint32_t hfsr;
+    uint32_t mmfar;
+    uint32_t bfar;
+    uint32_t mpuAddr;
+    uint32_t excReturn;
+    uint32_t frame[8];
+} CrashRegs;
+
+#define CRASH_MAGIC 0x48535243 /* "CRSH" */
+#define CRASH_TRACE 512        /* bytes of the newest kernel log records kept */
+
+/**
+ * struct CrashRecord - the last fault, kept across a reset
+ * @magic:    CRASH_MAGIC when a record is held
+ * @sum:      checksum of the words after it
+ * @faults:   faults since the record was last cleared
+ * @killed:   1 if only the Proc was killed, 0 if the unit halted
+ * @systime:  when it happened
+ * @pid:      running Proc, -1 for none
+ * @regs:     machine state
+ * @heap:     allocator summary
+ * @traceLen: bytes at @trace
+ * @trace:    the newest kernel log records
+ */
+typedef struct CrashRecord {
+    uint32_t     magic;
+    uint32_t     sum;
+    uint32_t     faults;
+    uint32_t     killed;
+    uint64_t     systime;
+    int32_t      pid;
+    CrashRegs    regs;
+    KmallocStats heap;
+    uint32_t     traceLen;
+    char         trace[CRASH_TRACE];
+} CrashRecord;
+
+/*
+ * BOOT_PHASES - X(phase, name)
+ *
+ * The marks of a boot, in the order they are taken, see bootMark().
+ */
+#define BOOT_PHASES                                                         \
+    X(BootReset,    "reset")    /* main() entered */                        \
+    X(BootClocks,   "clocks")   /* PLL, SDRAM and SVC up */                 \
+    X(BootDevices,  "devices")  /* devices needed to boot up */             \
+    X(BootConsole,  "console")  /* kernel output on the console */          \
+    X(BootProcs,    "procs")    /* Proc slots allocated */                  \
+    X(BootSched,    "sched")    /* shell Proc made, scheduler started */    \
+    X(BootPrompt,   "prompt")   /* first shell prompt */                    \
+    X(BootDeferred, "deferred") /* lazy devices up in the background */
+
+#define X(p, n) p,
+typedef enum {
+    BOOT_PHASES
+    BootPhaseCount
+} BootPhase;
+#undef X
+
 typedef NodeInfo* (*GetNodeInfoFn)(const Portal*, WalkDirection, NodeInfo*);
 
 #define MANOS_MAXNAME 256
@@ -158,6 +318,13 @@ typedef struct Dev {
     int        (*setInfo)   (Portal*, NodeInfo*);
     ptrdiff_t  (*read)      (Portal*, void*, size_t, Offset);
     ptrdiff_t  (*write)     (Portal*, void*, size_t, Offset);
+    /* optional, when NULL the span list is walked with read/write */
+    ptrdiff_t  (*readv)     (Portal*, const IoVec*, unsigned, Offset);
+    ptrdiff_t  (*writev)    (Portal*, const IoVec*, unsigned, Offset);
+    /* optional, called for Portals still open when their Proc is torn down */
+    void       (*release)   (Portal*);
+    /* brought up on first attach rather than at boot, see bringUpDevice() */
+    int        lazy;
 } Dev;
 
 typedef struct Uart Uart;
@@ -187,9 +354,11 @@ struct UartHW {
     int (*bits)(Uart*, int);
     char (*getc)(Uart*);
     void (*putc)(Uart*, char);
+    void (*kick)(Uart*); /* start sending, pulling text with takeKlog(); optional */
 };
 
 #define MANOS_MAXFD 1024
+#define MANOS_MINFD 32 /* first table size, grows by doubling to MANOS_MAXFD */
 #define MANOS_MAXSIGPENDING 32
 
 typedef enum {
@@ -199,8 +368,20 @@ typedef enum {
     ProcRunning,
     ProcWaiting,
     ProcStopped,
+    ProcZombie,
 } ProcState;
 
+/* waitpid() options */
+#define WAIT_NOHANG   0x1 /* return 0 rather than wait */
+#define WAIT_UNTRACED 0x2 /* report stopped children too */
+
+/* waitpid() status: the exit code in the low byte, or how the child ended */
+#define WAIT_CODE_MASK  0xff
+#define WAIT_KILLED     0x100
+#define WAIT_STOPPED    0x200
+#define WAIT_CODE(s)    ((s) & WAIT_CODE_MASK)
+#define WAIT_EXITED(s)  (((s) & (WAIT_KILLED | WAIT_STOPPED)) == 0)
+
 /**
  * struct ProcGroup - a process group
  *
@@ -212,6 +393,98 @@ typedef struct ProcGroup {
     int      pgid;
 } ProcGroup;
 
+/**
+ * struct Environ - an environment snapshot shared by the Procs given it
+ * @refs:  holders of the snapshot, the last to let go frees it
+ * @count: entries filled in @envp
+ * @size:  bytes of string storage left after the entries
+ * @end:   where the next string is stored
+ * @envp:  "name=value" strings, NULL terminated
+ *
+ * Immutable once built, so a spawn only takes a reference.
+ */
+typedef struct Environ {
+    Ref      refs;
+    unsigned count;
+    size_t   size;
+    char*    end;
+    char*    envp[];
+} Environ;
+
+/**
+ * struct SpawnAttr - how a spawned Proc is set up
+ * @env: environment snapshot, NULL for the parent's
+ * @in:  parent descriptor to use as standard input, -1 for the tty
+ * @out: parent descriptor to use as standard output, -1 for the tty
+ */
+typedef struct SpawnAttr {
+    Environ* env;
+    int      in;
+    int      out;
+} SpawnAttr;
+
+#define MEX_MAGIC        0x3058454du /* "MEX0" */
+#define MEX_RELOC_DATA   0x80000000u /* the word is in data, else text */
+#define MEX_RELOC_TODATA 0x40000000u /* add the data address, else text */
+#define MEX_RELOC_OFFSET 0x3fffffffu /* byte offset of the word */
+
+/**
+ * struct MexHeader - head of a relocatable executable
+ * @magic:     MEX_MAGIC
+ * @textSize:  bytes of text following the header
+ * @dataSize:  bytes of initialised data following the text
+ * @bssSize:   bytes of zeroed data after the initialised data
+ * @entry:     text offset of the entry point, thumb bit set
+ * @nrelocs:   relocation words following the data
+ * @stackSize: stack bytes, 0 for the default
+ *
+ * Each relocation word names a 32 bit word by segment and offset, and
+ * the segment whose load address is added to it.
+ */
+typedef struct MexHeader {
+    uint32_t magic;
+    uint32_t textSize;
+    uint32_t dataSize;
+    uint32_t bssSize;
+    uint32_t entry;
+    uint32_t nrelocs;
+    uint32_t stackSize;
+} MexHeader;
+
+/**
+ * struct MexImage - a loaded executable, shared by the Procs running it
+ * @refs:      the cache and each Proc running the image
+ * @device:    device the file was loaded from
+ * @fid:       file the image was loaded from
+ * @length:    file length when loaded
+ * @mtime:     file mtime when loaded
+ * @lastUse:   cache clock at the last exec, for eviction
+ * @text:      relocated text
+ * @entry:     text offset of the entry point
+ * @stackSize: stack bytes, 0 for the default
+ * @dataSize:  bytes of initialised data
+ * @bssSize:   bytes of zeroed data
+ * @nfixups:   entries in @fixups
+ * @fixups:    data offsets of words holding a data address
+ * @data:      initialised data, text addresses already filled in
+ */
+typedef struct MexImage {
+    Ref         refs;
+    DeviceIndex device;
+    Fid         fid;
+    Offset      length;
+    Time        mtime;
+    uint32_t    lastUse;
+    char*       text;
+    uint32_t    entry;
+    size_t      stackSize;
+    size_t      dataSize;
+    size_t      bssSize;
+    unsigned    nfixups;
+    uint32_t*   fixups;
+    char*       data;
+} MexImage;
+
 /**
  * enum ProcSig - process signals
  */
@@ -222,15 +495,35 @@ typedef enum ProcSig {
 ,   SigAlarm    = 0x00000008
 } ProcSig;
 
+#define MANOS_NSIG 4 /* signals above, one bit each */
+
+typedef void (*SigHandler)(ProcSig);
+
+/**
+ * struct FdTable - a growable table of open descriptors
+ * @size:    number of descriptor slots, a multiple of 32
+ * @count:   number of open descriptors
+ * @inUse:   bitmap of open slots, one bit per descriptor
+ * @portals: open Portals indexed by descriptor
+ */
+typedef struct FdTable {
+    unsigned  size;
+    unsigned  count;
+    uint32_t* inUse;
+    Portal**  portals;
+} FdTable;
+
 /**
  * struct Proc - a process thread
  *
  * @pid:             process id
  * @ppid:            parent pid
  * @tty:             process console
+ * @in:              standard input descriptor, @tty unless redirected
+ * @out:             standard output descriptor, @tty unless redirected
  * @argv:            argv of the Proc
  * @state:           Proc scheduler state
- * @descriptorTable: open file descriptors
+ * @fds:             open file descriptors
  * @slash:           /
  * @dot:             ./
  * @waitQ:           queue of Procs waiting on this 
@@ -238,34 +531,58 @@ typedef enum ProcSig {
  * @nextRunQ:        list head to add to procRunQ
  * @nextFreelist:    list head to add to procFreelist (TODO: consolidate these)
  * @pgrp:            ProcGroup pointer
+ * @env:             environment snapshot, may be NULL
  * @canary1:         stack canary at the top of the stack
  * @canart2:         stack canary at the bottom of the stack
  * @stack:           process stack
+ * @stackSize:       bytes in @stack, one of the stack pool size classes
  * @sp:              stack pointer
- * @sigPending:      flag to note a posted signal
- * @signalQ:         signal heap
+ * @sigPending:      signals in @signalQ, masked or not
+ * @sigMask:         signals held in @signalQ rather than delivered
+ * @signalQ:         queued signals, most urgent first
+ * @sigHandlers:     user handlers, by signal bit number
+ * @sigCaught:       caught signal whose handler has yet to start
+ * @sigSp:           context a running handler interrupted, 0 if none
+ * @sigReturning:    the running handler has returned
  */
 typedef struct Proc {
     Pid        pid;
     Pid        ppid;
     int        tty;
+    int        in;
+    int        out;
     char**     argv;
     ProcState  state;
-    Portal*    descriptorTable[MANOS_MAXFD];
+    FdTable    fds;
     Portal*    slash;
     Portal*    dot;
     ListHead   waitQ;
     ListHead   nextWaitQ;
     ListHead   nextRunQ;
     ListHead   nextFreelist;
+    ListHead   children;    /* live children, by nextSibling */
+    ListHead   zombies;     /* exited children not yet waited for */
+    ListHead   nextSibling;
+    ListHead   childQ;      /* woken when a child exits or stops */
+    int        exitStatus;
+    int        waitReported;
     ProcGroup* pgrp;
+    Environ*   env;
+    MexImage*  image;
+    void*      data;
     /* TODO:  track memory allocations with asym-dll, release proc memory on exit, use allocation as storage for linkage */
     uint64_t*  canary1;
     uint64_t*  canary2;
     uint32_t*  stack;
+    size_t     stackSize;
     uint32_t   sp;
     uint32_t   sigPending;
     uint32_t   sigMask;
+    HeapQ*     signalQ;
+    SigHandler sigHandlers[MANOS_NSIG];
+    ProcSig    sigCaught;
+    uint32_t   sigSp;
+    int        sigReturning;
 } Proc;
 
 typedef struct StackFrame {
@@ -280,8 +597,32 @@ typedef struct StackFrame {
     int xpsr; /* combined APSR / IPSR / EPSR bits -- does the hardware push this ? */
 } StackFrame;
 
+/* kernel log severities, numbered as syslog's */
+typedef enum {
+    KlogEmerg = 0
+,   KlogErr   = 3
+,   KlogWarn  = 4
+,   KlogInfo  = 6
+,   KlogDebug = 7
+} KlogLevel;
+
 typedef struct LcdHw LcdHw;
 
+/**
+ * struct LcdRect - a screen rectangle, and the header of a /dev/lcd/rect
+ * write which is followed by @w * @h pixels, row by row
+ * @x: left column
+ * @y: top row
+ * @w: width in pixels
+ * @h: height in pixels
+ */
+typedef struct LcdRect {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+} LcdRect;
+
 typedef struct Lcd {
     void*    regs;
     char*    name;
@@ -303,6 +644,8 @@ struct LcdHw {
     void (*disable)(Lcd*);
     void (*clear)(Lcd*);
     void (*blit)(Lcd*, char*);
+    int  (*rect)(Lcd*, const LcdRect*, const void*);
+    void (*swap)(Lcd*, int);
     void (*scroll)(Lcd*);
     void (*putc)(Lcd*,int);
 };
@@ -348,6 +691,8 @@ typedef struct Date {
 typedef struct AlarmChain {
     uint64_t wakeTime;
     Pid      pid;
+    int      id;   /* returned by armAlarm(), to cancel this alarm alone */
+    int      wake; /* a kernel timeout, readies the Proc without a signal */
     ListHead next;
 } AlarmChain;
 
@@ -0,0 +1,44 @@
+#ifndef SHELL_CMDCACHE_H
+#define SHELL_CMDCACHE_H
+
+/**
+ * cmdcache.h
+ * Compiled command cache
+ */
+
+#include <torgo/dstring.h>
+#include <torgo/parser.h>
+
+/*
+ * CmdTemplate = (Int, [String], [Bool], [Bool], CmdTemplate)
+ *
+ * A parsed command, ready to be expanded into an argv. 'expand[i]'
+ * is set when 'argv[i]' holds a variable reference, 'op[i]' when it is
+ * an operator, a pipe, rather than a word. Commands parsed from the
+ * same line are chained through 'next'.
+ */
+typedef struct CmdTemplate {
+  int                 argc;
+  String**            argv;
+  char*               expand;
+  char*               op;
+  struct CmdTemplate* next;
+} CmdTemplate;
+
+CmdTemplate* mkCmdTemplate(ParseResult *result);
+void freeCmdTemplate(CmdTemplate *tmpl);
+
+typedef struct CmdCache CmdCache;
+
+CmdCache* mkCmdCache(void);
+void freeCmdCache(CmdCache *cache);
+
+const CmdTemplate* lookupLineCmdCache(CmdCache *cache, const String *line);
+const CmdTemplate* addLineCmdCache(CmdCache *cache, const String *line, CmdTemplate *cmds);
+
+const String* lookupTargetCmdCache(CmdCache *cache, const String *name);
+const String* addTargetCmdCache(CmdCache *cache, const String *name, const String *path);
+void dropTargetCmdCache(CmdCache *cache, const String *name);
+void flushTargetsCmdCache(CmdCache *cache);
+
+#endif /* ! SHELL_CMDCACHE_H */
@@ -1,11 +1,18 @@
 #ifndef SHELL_COMMANDS_H
 #define SHELL_COMMANDS_H
 
+#include <stddef.h>
+
 typedef int (*Cmd)(int, char * const []);
 
+/*
+ * stackSize is the default stack for the command, 0 for the
+ * largest class. Tune it from the high water mark 'ps' reports.
+ */
 typedef struct CmdTable {
   char *cmdName;
   Cmd cmd;
+  size_t stackSize;
 } CmdTable;
 
 int torgo_main(int, char * const []);
@@ -19,6 +26,7 @@ int cmdLsmem__Main(int, char * const[]);
 int cmdPs__Main(int, char * const[]);
 int cmdFg__Main(int, char * const[]);
 int cmdFizzbuzz__Main(int, char * const[]);
+int cmdEnv__Main(int, char * const[]);
 
-extern CmdTable builtinCmds[11];
+extern CmdTable builtinCmds[12];
 #endif /* ! SHELL_COMMANDS_H */
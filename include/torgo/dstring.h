@@ -7,6 +7,7 @@
  */
 
 #include <stddef.h>
+#include <stdint.h>
 
 /*
  * String = (CStr, Int)
@@ -28,5 +29,6 @@ String* copyString(const String *str);
 String* concatString(const String *a, const String *b);
 
 int matchString(const String *a, const String *b);
+uint32_t hashString(const String *str);
 
 #endif /* ! SHELL_STRING_H */
@@ -9,6 +9,7 @@
 #include <torgo/dstring.h>
 
 typedef struct Env Env;
+struct Environ;
 
 Env* mkEnv(void);
 void freeEnv(Env *env);
@@ -18,4 +19,7 @@ const String* updateVarEnv(Env *env, const String *name, const String *value);
 const String* lookupVarEnv(Env *env, const String *name);
 void unsetVarEnv(Env *env, const String *name);
 
+int exportVarEnv(Env *env, const String *name);
+struct Environ* exportsEnv(Env *env);
+
 #endif /* ! SHELL_ENV_H */
@@ -16,6 +16,7 @@ typedef struct ParseTokenIterator ParseTokenIterator;
 
 void freeParseTokenIterator(ParseTokenIterator *it);
 const String* getNextParseTokenIterator(ParseTokenIterator *it);
+int isOpParseTokenIterator(const ParseTokenIterator *it);
 
 typedef struct InputChainIterator InputChainIterator;
 
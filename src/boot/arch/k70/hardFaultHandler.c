@@ -1,3 +1,4 @@
+#include <inttypes.h>
 #include <manos.h>
 
 #ifdef PLATFORM_K70CW
@@ -8,7 +9,62 @@
 
 /* routines based on http://blog.feabhas.com/2013/02/developing-a-generic-hard-fault-handler-for-arm-cortex-m3cortex-m4/ */
 
-static void __attribute__((used)) hardFaultHandlerMain(uint32_t* frame) {
+extern void __manos_exit(int);
+
+#define EXC_RETURN_THREAD     (1u << 3)
+#define FPCCR_LSPACT          (1u << 0)
+
+/*
+ * A Proc that faulted in thread mode is killed rather than the unit. The
+ * faulting frame is abandoned and a fresh one built at the top of the
+ * Proc's stack, returning into __manos_exit() as if the Proc had ended.
+ *
+ * Return: the stack to resume on
+ */
+static uint32_t killFaultedProc(const CrashRegs* regs) {
+    /* a Proc's critical region dies with it, it could not mask interrupts anyway */
+    criticalRegionCount = 0;
+    MANOS_ARCH_K70_FPCCR &= ~FPCCR_LSPACT; /* drop lazily stacked FPU state */
+    rp->exitStatus = WAIT_KILLED;
+
+    uint32_t* sp = (uint32_t*)((char*)rp->stack + rp->stackSize);
+    *(--sp) = 0x1000000;                /* XPSR */
+    *(--sp) = (uint32_t)__manos_exit;   /* PC   */
+    *(--sp) = (uint32_t)__manos_exit;   /* LR   */
+    *(--sp) = 0;                        /* r12  */
+    *(--sp) = 0;                        /* r3   */
+    *(--sp) = 0;                        /* r2   */
+    *(--sp) = 0;                        /* r1   */
+    *(--sp) = 0;                        /* r0   */
+
+    sysklog(KlogErr, "proc %d killed: %s at 0x%.8" PRIx32 ", pc 0x%.8" PRIx32 "\n", rp->pid,
+            regs->mpuAddr ? "mpu refused access" : "fault",
+            regs->mpuAddr ? regs->mpuAddr : regs->frame[6], regs->frame[6]);
+    return (uint32_t)sp;
+}
+
+static uint32_t __attribute__((used)) hardFaultHandlerMain(uint32_t* frame, uint32_t excReturn) {
+    CrashRegs regs = {
+        .cfsr      = SCB_CFSR
+    ,   .hfsr      = SCB_HFSR
+    ,   .mmfar     = SCB_MMFAR
+    ,   .bfar      = SCB_BFAR
+    ,   .mpuAddr   = 0
+    ,   .excReturn = excReturn
+    };
+    for (unsigned i = 0; i < COUNT_OF(regs.frame); i++)
+        regs.frame[i] = frame[i];
+    mpuFault(&regs.mpuAddr);
+
+    if ((excReturn & EXC_RETURN_THREAD) && rp && rp->stack && rp->pid > 0) {
+        recordCrash(&regs, 1);
+        SCB_CFSR = regs.cfsr; /* write one to clear */
+        SCB_HFSR = regs.hfsr;
+        return killFaultedProc(&regs);
+    }
+
+    recordCrash(&regs, 0); /* read back from /dev/crash after the reset */
+
     volatile uint32_t faulted_r0  = frame[0];
     volatile uint32_t faulted_r1  = frame[1];
     volatile uint32_t faulted_r2  = frame[2];
@@ -41,6 +97,7 @@ static void __attribute__((used)) hardFaultHandlerMain(uint32_t* frame) {
     UNUSED(_AFSR);
     UNUSED(_MMFAR);
     UNUSED(_BFAR);
+    return 0;
 }
 
 void __attribute__((naked)) hardFaultHandler(void) {
@@ -49,8 +106,13 @@ __asm(
     "ite   eq\n\t"
     "mrseq r0, msp\n\t"
     "mrsne r0, psp\n\t"
-    "ldr   r1,[r0,#20]\n\t"
+    "mov   r1, lr\n\t"
     "bl    hardFaultHandlerMain\n\t" 
+    "cbz   r0, 1f\n\t"
+    "msr   msp, r0\n\t"                    /* resume the dead Proc on its fresh frame */
+    "mvn   lr, #6\n\t"                     /* 0xfffffff9, thread mode on msp */
+    "bx    lr\n"
+    "1:\n\t"
     "bkpt #0"
     :
     :
@@ -15,6 +15,8 @@ void pdbHandler(void) {
     Timer* timer = hotpluggedTimers->next;
     if (timer) {
         timer->hw->clear(timer);
+        debounceSwpb();
+        tickLed();
 
         if (listIsEmpty(&timer->alarms))
             return;
@@ -24,7 +26,10 @@ void pdbHandler(void) {
         uint64_t now = systime;
         LIST_FOR_EACH_ENTRY_SAFE(iter, save, &timer->alarms, next) {
             if (iter->wakeTime <= now) {
-                syspostsignal(iter->pid, SigAlarm);
+                if (iter->wake)
+                    wakeProc(iter->pid);
+                else
+                    syspostsignal(iter->pid, SigAlarm);
                 listUnlink(&iter->next);
                 __kfree(iter);
             }
@@ -6,15 +6,38 @@
 extern long long systickInterruptCount;
 extern long long pendsvInterruptCount;
 
+/*
+ * With hardware floating point a Proc which touched the FPU returns
+ * with EXC_RETURN bit 4 clear. The hardware lazily stacks s0-s15, the
+ * callee saved s16-s31 are ours to keep, and only for those Procs.
+ */
+#if defined(__VFP_FP__) && !defined(__SOFTFP__)
+#define SAVE_FPU    "tst  lr, #0x10\n\t" "it   eq\n\t" "vpusheq {s16-s31}\n\t"
+#define RESTORE_FPU "tst  lr, #0x10\n\t" "it   eq\n\t" "vpopeq {s16-s31}\n\t"
+#else
+#define SAVE_FPU    ""
+#define RESTORE_FPU ""
+#endif
+
 /** 
  * schedHandler - SysTick and PendSV handler
+ *
+ * scheduleFastPath() is asked first, when no other Proc could run the
+ * handler returns straight back to rp without saving anything.
  */
 void __attribute__((naked, used)) schedHandler(void) {
 __asm(
     /* On current running task stack */
 
-    "push {lr}\n\t"
-    "push {r4,r5,r6,r7,r8,r9,r10,r11}\n\t" /* push current Proc stack (hardware already pushed a stack frame) */
+    "push {r3, lr}\n\t"                    /* keep the SHCSR operand (r3) and exception return */
+    "bl   scheduleFastPath\n\t"
+    "pop  {r3, lr}\n\t"
+    "cbz  r0, 1f\n\t"
+    "bx   lr\n\t"                          /* fast path, rp keeps running */
+
+    "1:\n\t"
+    SAVE_FPU
+    "push {r4,r5,r6,r7,r8,r9,r10,r11,lr}\n\t" /* push current Proc stack (hardware already pushed a stack frame) */
     "ldr  r0, [%[shcsr]]\n\t"              /* push interrupt return state (thread or supervisor) */
     "and  r0,r0, %[mask]\n\t"
     "push {r0}\n\t"                        /* push the SVCALLACT value */
@@ -31,27 +54,48 @@ __asm(
     "bic r1, r1, %[mask]\n\t"
     "orr r0, r0, r1\n\t"
     "str r0, [%[shcsr]]\n\t"
-    "pop {r4,r5,r6,r7,r8,r9,r10,r11}\n\t"  /* unwind Proc stack */
-    "pop {pc}"                             /* return out of the interrupt, but on the switch Procs stack! */
+    "pop {r4,r5,r6,r7,r8,r9,r10,r11,lr}\n\t" /* unwind Proc stack */
+    RESTORE_FPU
+    "bx lr"                                /* return out of the interrupt, but on the switch Procs stack! */
     :
     : [shcsr] "r" (&SCB_SHCSR), [mask] "I" (SCB_SHCSR_SVCALLACT_MASK)
     : "r0", "r1", "sp", "memory" );
 }
 
+static void __attribute__((used)) countSystick(void) {
+    ATOMIC(systickInterruptCount++);
+}
+
+static void __attribute__((used)) countPendsv(void) {
+    ATOMIC(pendsvInterruptCount++);
+}
+
+/*
+ * The vector entries count the interrupt and branch, not call, into
+ * schedHandler(), so lr still holds the EXC_RETURN value it saves and
+ * tests, whatever the compiler would make of a C wrapper.
+ */
+
 /** 
  * systickHandler - Bookeeping version of systick
  */
-void systickHandler(void) {
-    ATOMIC(systickInterruptCount++);
-    schedHandler();
+void __attribute__((naked)) systickHandler(void) {
+__asm(
+    "push {r3, lr}\n\t"
+    "bl   countSystick\n\t"
+    "pop  {r3, lr}\n\t"
+    "b    schedHandler");
 }
 
 /**
  * pendsvHandler - Bookeeping version of pendsv
  */
-void pendsvHandler(void) {
-    ATOMIC(pendsvInterruptCount++);
-    schedHandler();
+void __attribute__((naked)) pendsvHandler(void) {
+__asm(
+    "push {r3, lr}\n\t"
+    "bl   countPendsv\n\t"
+    "pop  {r3, lr}\n\t"
+    "b    schedHandler");
 }
 
 #endif
@@ -8,4 +8,9 @@ void schedInit(int quantumMillis, uint8_t priority) {
 
     SYST_CSR |= SysTick_CSR_TICKINT_MASK | SysTick_CSR_CLKSOURCE_MASK;         /* enable the SysTick clock source to use the processor clock (120MHz) */
     SYST_RVR = SysTick_RVR_RELOAD(quantumMillis * MANOS_ARCH_K70_CYCLES_PER_MILLIS - 1); /* setup the SysTick quantum scaled to to cycle count of 8 1/3 nanos - counting starts at 1 */
+
+    START_CYCLE_COUNT();                                                      /* cycle counter for switch instrumentation, running since main() for the boot profile */
+
+    MANOS_ARCH_K70_FPCCR |= MANOS_ARCH_K70_FPCCR_ASPEN                        /* FPU frames are stacked lazily, only when a Proc used the FPU */
+                         |  MANOS_ARCH_K70_FPCCR_LSPEN;
 }
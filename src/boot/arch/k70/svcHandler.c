@@ -11,6 +11,14 @@ static int execSyscall(int* args) {
     return sysexecv((const char*)args[0], (char * const *)args[1]);
 }
 
+static int spawnSyscall(int* args) {
+    return sysspawn((const char*)args[0], (char * const *)args[1], (const SpawnAttr*)args[2], (long)args[3]);
+}
+
+static int pipeSyscall(int* args) {
+    return syspipe((int*)args[0]);
+}
+
 static void closeSyscall(int* args) {
     sysclose(args[0]);
 }
@@ -19,6 +27,10 @@ static int fstatSyscall(int* args) {
     return sysgetInfoFd(args[0], (NodeInfo*)args[1]);
 }
 
+static int getcwdSyscall(int* args) {
+    return (int)(uintptr_t)sysgetcwd((char*)args[0], (size_t)args[1]);
+}
+
 static int openSyscall(int* args) {
     return sysopen((const char*)args[0], (Caps)args[1]);
 }
@@ -31,6 +43,14 @@ static int writeSyscall(int* args) {
     return syswrite(args[0], (void*)args[1], (size_t)args[2]);
 }
 
+static int readvSyscall(int* args) {
+    return sysreadv(args[0], (const IoVec*)args[1], (unsigned)args[2]);
+}
+
+static int writevSyscall(int* args) {
+    return syswritev(args[0], (const IoVec*)args[1], (unsigned)args[2]);
+}
+
 static int trylockSyscall(int* args) {
     return systrylock((Lock*)args[0]);
 }
@@ -43,13 +63,26 @@ static void unlockSyscall(int* args) {
     sysunlock((Lock*)args[0]);
 }
 
-static void waitpidSyscall(int* args) {
-    syswaitpid(args[0]);
+static int waitpidSyscall(int* args) {
+    return syswaitpid(args[0], (int*)args[1], args[2]);
 }
 
+/* the run queue and the allocator are kernel data, so a Proc ends here */
 static void _exitsSyscall(int* args) {
     UNUSED(args);
     enterCriticalRegion();
+    abortProc(rp);
+    rp->state = ProcDead;
+    YIELD();
+    leaveCriticalRegion();
+}
+
+/* resumed in scheduleProc() on the context the handler interrupted */
+static void sigreturnSyscall(int* args) {
+    UNUSED(args);
+    enterCriticalRegion();
+    if (rp->sigSp)
+        rp->sigReturning = 1;
     YIELD();
     leaveCriticalRegion();
 }
@@ -62,6 +95,18 @@ static int sleepSyscall(int* args) {
     return syssleep((long)args[0]);
 }
 
+static int mallocSyscall(int* args) {
+    return (int)(uintptr_t)syskmalloc((size_t)args[0]);
+}
+
+static void freeSyscall(int* args) {
+    syskfree((void*)args[0]);
+}
+
+static int bootwaitSyscall(int* args) {
+    return bootWait((BootPhase)args[0], (long)args[1]);
+}
+
 #include <arch/k70/syscall.x>
 
 #include "syscall.h"
@@ -33,6 +33,44 @@ int kexec(const char* path, char * const argv[]) {
 }
 #endif
 
+#ifdef PLATFORM_K70CW
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+int __attribute__((naked)) __attribute__((noinline)) kspawn(const char* path, char * const argv[], const SpawnAttr* attr, long millis) {
+__asm(
+    "svc %[syscall]\n\t"
+    "bx lr"
+    :
+    : [syscall] "I" (MANOS_SYSCALL_SPAWN)
+);
+}
+#pragma GCC diagnostic pop
+#else
+int kspawn(const char* path, char * const argv[], const SpawnAttr* attr, long millis) {
+    return sysspawn(path, argv, attr, millis);
+}
+#endif
+
+#ifdef PLATFORM_K70CW
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+int __attribute__((naked)) __attribute__((noinline)) kpipe(int fds[2]) {
+__asm(
+    "svc %[syscall]\n\t"
+    "bx lr"
+    :
+    : [syscall] "I" (MANOS_SYSCALL_PIPE)
+);
+}
+#pragma GCC diagnostic pop
+#else
+int kpipe(int fds[2]) {
+    return syspipe(fds);
+}
+#endif
+
 /*
  * File Management System Calls
  */
@@ -74,6 +112,25 @@ int kfstat(int fd, NodeInfo* ni) {
 }
 #endif
 
+#ifdef PLATFORM_K70CW
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+char* __attribute__((naked)) __attribute__((noinline)) getcwd(char* buf, size_t n) {
+__asm(
+    "svc %[syscall]\n\t"
+    "bx lr"
+    :
+    : [syscall] "I" (MANOS_SYSCALL_GETCWD)
+);
+}
+#pragma GCC diagnostic pop
+#else
+char* getcwd(char* buf, size_t n) {
+    return sysgetcwd(buf, n);
+}
+#endif
+
 #ifdef PLATFORM_K70CW
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wreturn-type"
@@ -131,6 +188,44 @@ ptrdiff_t kwrite(int fd, void* buf, size_t n) {
 }
 #endif
 
+#ifdef PLATFORM_K70CW
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+ptrdiff_t __attribute__((naked)) __attribute__((noinline)) kreadv(int fd, const IoVec* iov, unsigned n) {
+__asm(
+    "svc %[syscall]\n\t"
+    "bx lr"
+    :
+    : [syscall] "I" (MANOS_SYSCALL_READV)
+);
+}
+#pragma GCC diagnostic pop
+#else
+ptrdiff_t kreadv(int fd, const IoVec* iov, unsigned n) {
+    return sysreadv(fd, iov, n);
+}
+#endif
+
+#ifdef PLATFORM_K70CW
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+ptrdiff_t __attribute__((naked)) __attribute__((noinline)) kwritev(int fd, const IoVec* iov, unsigned n) {
+__asm(
+    "svc %[syscall]\n\t"
+    "bx lr"
+    :
+    : [syscall] "I" (MANOS_SYSCALL_WRITEV)
+);
+}
+#pragma GCC diagnostic pop
+#else
+ptrdiff_t kwritev(int fd, const IoVec* iov, unsigned n) {
+    return syswritev(fd, iov, n);
+}
+#endif
+
 /**
  * IPC system calls
  */
@@ -193,8 +288,9 @@ void unlock(Lock* l) {
 
 #ifdef PLATFORM_K70CW
 #pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
 #pragma GCC diagnostic ignored "-Wunused-parameter"
-void __attribute__((naked, noinline)) waitpid(int pid) {
+int __attribute__((naked, noinline)) waitpid(int pid, int* status, int options) {
 __asm(
     "svc %[syscall]\n\t"
     "bx lr"
@@ -204,8 +300,8 @@ __asm(
 }
 #pragma GCC diagnostic pop
 #else
-void waitpid(int pid) {
-    syswaitpid(pid);
+int waitpid(int pid, int* status, int options) {
+    return syswaitpid(pid, status, options);
 }
 #endif
 
@@ -243,7 +339,99 @@ __asm(
 #pragma GCC diagnostic pop
 #else
 int postsignal(Pid pid, ProcSig sig) {
-    syspostsignal(pid, sig);
+    return syspostsignal(pid, sig);
+}
+#endif
+
+/*
+ * Memory Management System Calls
+ *
+ * The allocator keeps its bins, bitmaps and page descriptors where user
+ * mode cannot write them, so a Proc allocates through the kernel. Code
+ * shared with the kernel, such as releaseEnviron(), may call these from
+ * a handler or a critical region, where an svc would escalate to a hard
+ * fault; they go straight to the allocator then.
+ */
+
+#ifdef PLATFORM_K70CW
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void* __attribute__((naked, noinline)) kmalloc(size_t size) {
+__asm(
+    "mrs r1, ipsr\n\t"
+    "cbnz r1, 1f\n\t"
+    "mrs r1, primask\n\t"
+    "cbnz r1, 1f\n\t"
+    "svc %[syscall]\n\t"
+    "bx lr\n"
+    "1:\n\t"
+    "b syskmalloc"
+    :
+    : [syscall] "I" (MANOS_SYSCALL_MALLOC)
+    );
+}
+#pragma GCC diagnostic pop
+#else
+void* kmalloc(size_t size) {
+    return syskmalloc(size);
+}
+#endif
+
+#ifdef PLATFORM_K70CW
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+void __attribute__((naked, noinline)) kfree(void* ptr) {
+__asm(
+    "mrs r1, ipsr\n\t"
+    "cbnz r1, 1f\n\t"
+    "mrs r1, primask\n\t"
+    "cbnz r1, 1f\n\t"
+    "svc %[syscall]\n\t"
+    "bx lr\n"
+    "1:\n\t"
+    "b syskfree"
+    :
+    : [syscall] "I" (MANOS_SYSCALL_FREE)
+    );
+}
+#pragma GCC diagnostic pop
+#else
+void kfree(void* ptr) {
+    syskfree(ptr);
+}
+#endif
+
+#ifdef PLATFORM_K70CW
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wreturn-type"
+#pragma GCC diagnostic ignored "-Wunused-parameter"
+int __attribute__((naked, noinline)) kbootwait(BootPhase phase, long millis) {
+__asm(
+    "svc %[syscall]\n\t"
+    "bx lr"
+    :
+    : [syscall] "I" (MANOS_SYSCALL_BOOTWAIT)
+    );
+}
+#pragma GCC diagnostic pop
+#else
+int kbootwait(BootPhase phase, long millis) {
+    return bootWait(phase, millis);
+}
+#endif
+
+#ifdef PLATFORM_K70CW
+void __attribute__((naked, noinline)) ksigreturn(void) {
+__asm(
+    "svc %[syscall]\n\t"
+    "bx lr"
+    :
+    : [syscall] "I" (MANOS_SYSCALL_SIGRETURN)
+    );
+}
+#else
+void ksigreturn(void) {
 }
 #endif
 
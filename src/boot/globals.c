@@ -1,6 +1,11 @@
 #include <manos.h> 
 #include <manos/list.h>
 
+/*
+ * KERNEL_DATA globals are only written in supervisor mode, the MPU keeps
+ * user mode from writing them, see initMpu().
+ */
+
 extern Dev devRoot;
 extern Dev devLed;
 extern Dev devSwpb;
@@ -9,14 +14,18 @@ extern Dev devLcd;
 extern Dev devAdc;
 extern Dev devTimer;
 extern Dev devDev;
-
-long long svcInterruptCount     = 0;
-long long timerInterruptCount   = 0;
-long long pdbInterruptCount     = 0;
-long long systickInterruptCount = 0;
-long long pendsvInterruptCount  = 0;
-
-Dev* deviceTable[MANOS_MAXDEV] = {
+extern Dev devPipe;
+
+long long svcInterruptCount     KERNEL_DATA = 0;
+long long timerInterruptCount   KERNEL_DATA = 0;
+long long pdbInterruptCount     KERNEL_DATA = 0;
+long long systickInterruptCount KERNEL_DATA = 0;
+long long pendsvInterruptCount  KERNEL_DATA = 0;
+long long schedSwitchCount      KERNEL_DATA = 0; /* full context switches */
+long long schedFastCount        KERNEL_DATA = 0; /* switches skipped by the fast path */
+long long schedSwitchCycles     KERNEL_DATA = 0; /* cycles spent in full switches */
+
+Dev* deviceTable[MANOS_MAXDEV] KERNEL_DATA = {
     &devRoot
 ,   &devLed
 ,   &devSwpb
@@ -25,12 +34,13 @@ Dev* deviceTable[MANOS_MAXDEV] = {
 ,   &devAdc
 ,   &devTimer
 ,   &devDev
+,   &devPipe
 };
 
 extern UartHW k70UartHW;
 extern UartHW niceUartHW;
 
-UartHW* uartHardwareTable[MANOS_MAXUART] = {
+UartHW* uartHardwareTable[MANOS_MAXUART] KERNEL_DATA = {
     &k70UartHW
 ,   &niceUartHW
 };
@@ -38,36 +48,36 @@ UartHW* uartHardwareTable[MANOS_MAXUART] = {
 extern TimerHW k70TimerHW;
 extern TimerHW niceTimerHW;
 
-TimerHW* timerHardwareTable[MANOS_MAXTIMER] = {
+TimerHW* timerHardwareTable[MANOS_MAXTIMER] KERNEL_DATA = {
     &k70TimerHW
 ,   &niceTimerHW
 };
 
-Lock malLock;
+Lock malLock KERNEL_DATA;
 
-Lock freelistLock;
-LIST_HEAD(procFreelist);
-Proc** procTable;
+KERNEL_DATA LIST_HEAD(procFreelist);
+KERNEL_DATA LIST_HEAD(procSpawnQ);
+Proc** procTable KERNEL_DATA;
 
-Lock runQLock;
-LIST_HEAD(procRunQ);
+Lock runQLock KERNEL_DATA;
+KERNEL_DATA LIST_HEAD(procRunQ);
 
-Ref nextPid;
+Ref nextPid KERNEL_DATA;
 
-Proc* rp = NULL; 
+Proc* rp KERNEL_DATA = NULL;
 
-Uart* consoleUart = NULL;
-Uart* hotpluggedUarts = NULL;
+Uart* consoleUart KERNEL_DATA = NULL;
+Uart* hotpluggedUarts KERNEL_DATA = NULL;
 
-Timer* hotpluggedTimers = NULL;
+Timer* hotpluggedTimers KERNEL_DATA = NULL;
 
-volatile uint64_t systime = 0; /* monotonic timer */
+volatile uint64_t systime KERNEL_DATA = 0; /* monotonic timer */
 
-volatile int criticalRegionCount;
+volatile int criticalRegionCount; /* counted in user mode too, so left writable */
 
 #ifdef PLATFORM_K70CW
 extern LcdHw k70LcdHw;
-LcdHw* lcdHw = &k70LcdHw;
+LcdHw* lcdHw KERNEL_DATA = &k70LcdHw;
 #else
-LcdHw* lcdHw = NULL;
+LcdHw* lcdHw KERNEL_DATA = NULL;
 #endif
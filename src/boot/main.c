@@ -2,23 +2,30 @@
 #include <manos/list.h>
 #include <string.h>
 #include <inttypes.h>
+#include <arch/k70/derivative.h>
 
 #include <torgo/commands.h>
 
-extern Proc* schedProc(Cmd, int, char * const []);
+extern Proc* schedProc(Cmd, int, char * const [], const SpawnAttr*, size_t, long);
 extern void enterUserMode(void);
 
 extern uint32_t totalRAM;
-extern size_t numChunkOffsets;
-extern char* heap;
 /*
  * Kernel entry point. For now it just launches the shell.
+ *
+ * Each phase is marked in the boot profile, see /dev/boot. Lazy devices
+ * are left down until they are first attached, or until the deferred
+ * bring-up Proc gets to them once the shell is at its prompt.
  */
 int main(int argc, char** argv) {
     char * const firstArgv[] = { "/bin/sh", 0 };
+    char * const deferArgv[] = { "bootd", 0 };
+    START_CYCLE_COUNT();
+    bootMark(BootReset);
+
     INIT_LIST_HEAD(&procRunQ);
     INIT_LIST_HEAD(&procFreelist);
-    INIT_LOCK(&freelistLock);
+    INIT_LIST_HEAD(&procSpawnQ);
     INIT_LOCK(&runQLock);
     INIT_REF(&nextPid);
     INIT_LOCK(&malLock);
@@ -28,38 +35,47 @@ int main(int argc, char** argv) {
     sdramInit();
     svcInit(MANOS_ARCH_K70_SVC_INT_PRIORITY);
 #endif
+    bootMark(BootClocks);
 
     for (unsigned i = 0; i < COUNT_OF(deviceTable); i++) {
-        deviceTable[i]->reset();
-        deviceTable[i]->power(1);
-        deviceTable[i]->init();
+        if (!deviceTable[i]->lazy)
+            bringUpDevice(i);
     }
+    bootMark(BootDevices);
   
 #ifdef PLATFORM_K70CW
     k70Console();
 #elif PLATFORM_NICE
     niceConsole();
 #endif
+    bootMark(BootConsole);
 
     sysprintln("Allocating free list...");
 
-    Proc* flist = syskmalloc0(MANOS_MAXPROC * sizeof(*flist));
+    /* looked at on every switch, so kept in on-chip SRAM when it fits */
+    Proc* flist = syskmallocHint(MANOS_MAXPROC * sizeof(*flist), MemFast);
     Proc* p = flist;
     for (unsigned i = 0; i < MANOS_MAXPROC; i++, p++) {
         INIT_LIST_HEAD(&p->nextFreelist);
         listAddAfter(&p->nextFreelist, &procFreelist);
     }
 
-    procTable = syskmalloc0(MANOS_MAXPROC * sizeof(procTable));
+    procTable = syskmallocHint(MANOS_MAXPROC * sizeof(procTable), MemFast);
+    bootMark(BootProcs);
 
     sysprintln("Total System RAM: %" PRIu32 "", totalRAM);
-    sysprintln(" # Chunk Offsets: %" PRIu32 "", numChunkOffsets);
-    sysprintln("    Heap Address: 0x%.8" PRIx32 "", (uintptr_t)heap);
+    KmallocStats heapStats;
+    const char* heapName;
+    for (unsigned i = 0; (heapName = kmallocRegionStats(i, &heapStats)) != NULL; i++)
+        sysprintln("%16s: %" PRIu32 " of %" PRIu32 " in use", heapName, heapStats.inUse, heapStats.total);
 
     /* OK. Still in supervisor mode */
-    schedProc(torgo_main, 1, firstArgv);
+    schedProc(torgo_main, 1, firstArgv, NULL, 0, -1);
+    schedProc(bootDeferred, 1, deferArgv, NULL, 4096, -1);
 #ifdef PLATFORM_K70CW
+    initMpu(); /* the first stack made the arena */
     schedInit(50, MANOS_ARCH_K70_SCHED_INT_PRIORITY);
+    bootMark(BootSched);
     sysprint("Entering User Mode");
     enterUserMode();
     sysprintln("...");
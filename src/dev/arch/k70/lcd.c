@@ -10,6 +10,30 @@
 #define G 1
 #define B 2
 
+#define LCD_GLYPH_CACHE 4 /* (fg,bg) pairs kept rendered */
+#define LCD_MAX_DIRTY   8 /* dirty rects tracked before merging */
+#define LCD_EOF_SPIN    2000000 /* polls of LISR, a few frames at 120MHz */
+
+/**
+ * struct Glyphs - the console font pre-rendered in one pair of colors
+ * @fg:       foreground the glyphs were rendered with
+ * @bg:       background the glyphs were rendered with
+ * @rendered: bitmap of the characters rendered so far
+ * @bits:     pixels, one row of PROFONT_FONT_WIDTH words per font row
+ */
+typedef struct Glyphs {
+    uint32_t fg;
+    uint32_t bg;
+    uint32_t rendered[PROFONT_CHARS_IN_FONT / 32];
+    uint32_t (*bits)[PROFONT_FONT_HEIGHT][PROFONT_FONT_WIDTH];
+} Glyphs;
+
+/*
+ * The framebuffer is twice the screen height and every row is written
+ * to both halves, so any run of ysize rows starting at @top is the whole
+ * screen. Scrolling advances @top and pans LCDC_LSSAR to it instead of
+ * moving the pixels.
+ */
 typedef struct Control {
     void*    mmap;
     uint32_t xsize;
@@ -20,6 +44,12 @@ typedef struct Control {
     uint32_t consFontH;
     uint32_t consFontW;
     unsigned consTabSpc;
+    uint32_t top;
+    Glyphs   glyphs[LCD_GLYPH_CACHE];
+    unsigned nextGlyphs;
+    uint32_t* back;
+    LcdRect  dirty[LCD_MAX_DIRTY];
+    unsigned ndirty;
 } Control;
 
 static Control k70Control[] = {
@@ -46,6 +76,106 @@ Lcd k70Lcd[] = {
 
 #define LCD_PIXEL(c, p, w) ((p & (c)->colorMask[(w)]) >> (c)->colorShift[(w)])
 
+/**
+ * k70LcdRow() - first pixel of a screen row
+ * @ctrl: LCD control
+ * @y:    row on screen, 0 is the top
+ *
+ * Return: the row in the first half of the framebuffer, its mirror is
+ * ysize rows further on
+ */
+static inline uint32_t* k70LcdRow(Control* ctrl, uint32_t y) {
+    return (uint32_t*)ctrl->mmap + ((ctrl->top + y) % ctrl->ysize) * ctrl->xsize;
+}
+
+static inline uint32_t* k70LcdMirror(Control* ctrl, uint32_t* row) {
+    return row + ctrl->ysize * ctrl->xsize;
+}
+
+/**
+ * k70LcdPan() - point the LCDC at the current top row
+ * @ctrl: LCD control
+ */
+static void k70LcdPan(Control* ctrl) {
+#ifdef PLATFORM_K70CW
+    LCDC_LSSAR = (uintptr_t)((uint32_t*)ctrl->mmap + ctrl->top * ctrl->xsize);
+#else
+    UNUSED(ctrl);
+#endif
+}
+
+/**
+ * k70LcdFillRows() - paint screen rows with the background color
+ * @lcd: LCD
+ * @y:   first row on screen
+ * @n:   rows to paint
+ */
+static void k70LcdFillRows(Lcd* lcd, uint32_t y, uint32_t n) {
+    Control* ctrl = lcd->regs;
+    uint8_t r = LCD_PIXEL(ctrl, lcd->colors.bg, R);
+    uint8_t g = LCD_PIXEL(ctrl, lcd->colors.bg, G);
+    uint8_t b = LCD_PIXEL(ctrl, lcd->colors.bg, B);
+    size_t rowBytes = ctrl->xsize * ctrl->bpp;
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t* row = k70LcdRow(ctrl, y + i);
+        if (r == g && r == b) { /* monochromatic case */
+            kmemset(row, r, rowBytes);
+        } else {
+            for (uint32_t x = 0; x < ctrl->xsize; x++)
+                row[x] = lcd->colors.bg;
+        }
+        kmemcpy(k70LcdMirror(ctrl, row), row, rowBytes);
+    }
+}
+
+/**
+ * k70LcdGlyph() - a character rendered in the current colors
+ * @lcd: LCD
+ * @c:   character
+ *
+ * Glyphs are rendered on first use into a small cache keyed by the
+ * (fg,bg) pair; the least recently added pair is reused when it is full.
+ *
+ * Return: PROFONT_FONT_HEIGHT rows of PROFONT_FONT_WIDTH pixels, or NULL
+ * if there was no memory for the cache
+ */
+static const uint32_t* k70LcdGlyph(Lcd* lcd, unsigned char c) {
+    Control* ctrl = lcd->regs;
+    Glyphs* glyphs = NULL;
+    for (unsigned i = 0; i < LCD_GLYPH_CACHE; i++) {
+        Glyphs* g = &ctrl->glyphs[i];
+        if (g->bits && g->fg == lcd->colors.fg && g->bg == lcd->colors.bg) {
+            glyphs = g;
+            break;
+        }
+    }
+
+    if (!glyphs) {
+        glyphs = &ctrl->glyphs[ctrl->nextGlyphs];
+        if (!glyphs->bits) {
+            glyphs->bits = syskmalloc(PROFONT_CHARS_IN_FONT * sizeof *glyphs->bits);
+            if (!glyphs->bits)
+                return NULL;
+        }
+        ctrl->nextGlyphs = (ctrl->nextGlyphs + 1) % LCD_GLYPH_CACHE;
+        glyphs->fg = lcd->colors.fg;
+        glyphs->bg = lcd->colors.bg;
+        memset(glyphs->rendered, 0, sizeof glyphs->rendered);
+    }
+
+    if (!(glyphs->rendered[c / 32] & (1u << (c % 32)))) {
+        for (uint32_t y = 0; y < PROFONT_FONT_HEIGHT; y++) {
+            for (uint32_t x = 0; x < PROFONT_FONT_WIDTH; x++) {
+                glyphs->bits[c][y][x] = profont[c][y][x] ? glyphs->fg : glyphs->bg;
+            }
+        }
+        glyphs->rendered[c / 32] |= 1u << (c % 32);
+    }
+
+    return &glyphs->bits[c][0][0];
+}
+
 static Lcd* k70LcdHotplug(void) {
 #ifdef PLATFORM_K70CW
     return &k70Lcd[0];
@@ -60,9 +190,9 @@ static void k70LcdEnable(Lcd* lcd) {
     SIM_SCGC5 |= SIM_SCGC5_PORTE_MASK | SIM_SCGC5_PORTF_MASK;
     SIM_SCGC3 |= SIM_SCGC3_LCDC_MASK;
 
-    /* disable MPU */
-    MPU_CESR &= ~MPU_CESR_VLD_MASK;
-    
+    /* let the LCDC, bus master 7, fetch frames; the MPU stays on */
+    MPU_RGDAAC_REG(MPU_BASE_PTR, 0) |= MPU_RGDAAC_M7WE_MASK | MPU_RGDAAC_M7RE_MASK;
+
     /* enable pins */
     for (unsigned i = 0; i < 28; i++) {
         switch (i) {
@@ -79,7 +209,8 @@ static void k70LcdEnable(Lcd* lcd) {
     }
 
     /* base of the video ram */
-    LCDC_LSSAR = (uintptr_t)ctrl->mmap;
+    ctrl->top  = 0;
+    k70LcdPan(ctrl);
     /* vram size */
     LCDC_LSR        = LCDC_LSR_XMAX(ctrl->xsize  / 16) | LCDC_LSR_YMAX(ctrl->ysize);
     lcd->fbSize     = ctrl->xsize * ctrl->ysize * ctrl->bpp;
@@ -146,17 +277,10 @@ static void k70LcdDisable(Lcd* lcd) {
 
 static void k70LcdClear(Lcd* lcd) {
     Control* ctrl = lcd->regs;
-    uint8_t r = LCD_PIXEL(ctrl, lcd->colors.bg, R);
-    uint8_t g = LCD_PIXEL(ctrl, lcd->colors.bg, G);
-    uint8_t b = LCD_PIXEL(ctrl, lcd->colors.bg, B);
 
-    if (r == g && r == b) { /* monochromatic case */
-        kmemset(ctrl->mmap, r, lcd->fbSize);
-    } else {
-        for (uint32_t* pixel = (uint32_t*)ctrl->mmap; pixel < (uint32_t*)ctrl->mmap + (ctrl->xsize * ctrl->ysize); pixel++) {
-            *pixel = lcd->colors.bg;
-        }
-    }
+    ctrl->top = 0;
+    k70LcdFillRows(lcd, 0, ctrl->ysize);
+    k70LcdPan(ctrl);
 
     lcd->consX = 0;
     lcd->consY = ctrl->ysize - ctrl->consFontH;
@@ -164,35 +288,184 @@ static void k70LcdClear(Lcd* lcd) {
 
 static void k70LcdBlit(Lcd* lcd, char* bits) {
     Control* ctrl = lcd->regs;
-    for (uint32_t* in = (uint32_t*)bits, *out = (uint32_t*)ctrl->mmap; out < (uint32_t*)ctrl->mmap + (ctrl->xsize * ctrl->ysize); in++, out++) {
-        *out = *in;
+
+    ctrl->top = 0;
+    kmemcpy(ctrl->mmap, bits, lcd->fbSize);
+    kmemcpy(k70LcdMirror(ctrl, ctrl->mmap), bits, lcd->fbSize);
+    k70LcdPan(ctrl);
+
+    if (ctrl->back)
+        kmemcpy(ctrl->back, bits, lcd->fbSize);
+    ctrl->ndirty = 0;
+}
+
+static int k70LcdRectsTouch(const LcdRect* a, const LcdRect* b) {
+    return a->x <= b->x + b->w && b->x <= a->x + a->w
+        && a->y <= b->y + b->h && b->y <= a->y + a->h;
+}
+
+static LcdRect k70LcdRectUnion(const LcdRect* a, const LcdRect* b) {
+    uint16_t x0 = a->x < b->x ? a->x : b->x;
+    uint16_t y0 = a->y < b->y ? a->y : b->y;
+    uint16_t x1 = a->x + a->w > b->x + b->w ? a->x + a->w : b->x + b->w;
+    uint16_t y1 = a->y + a->h > b->y + b->h ? a->y + a->h : b->y + b->h;
+    return (LcdRect){ x0, y0, x1 - x0, y1 - y0 };
+}
+
+/**
+ * k70LcdMarkDirty() - add a rect to the dirty list
+ * @ctrl: LCD control
+ * @r:    rect updated in the back buffer
+ *
+ * Touching or overlapping rects are merged into their bounding box. When
+ * the list is full the new rect is merged with whichever entry grows the
+ * least by taking it in.
+ */
+static void k70LcdMarkDirty(Control* ctrl, LcdRect r) {
+    for (unsigned i = 0; i < ctrl->ndirty;) {
+        if (k70LcdRectsTouch(&ctrl->dirty[i], &r)) {
+            r = k70LcdRectUnion(&ctrl->dirty[i], &r);
+            ctrl->dirty[i] = ctrl->dirty[--ctrl->ndirty];
+            i = 0; /* the union may now touch an earlier rect */
+        } else {
+            i++;
+        }
     }
+
+    if (ctrl->ndirty == LCD_MAX_DIRTY) {
+        unsigned best = 0;
+        uint32_t bestGrowth = UINT32_MAX;
+        for (unsigned i = 0; i < ctrl->ndirty; i++) {
+            LcdRect u = k70LcdRectUnion(&ctrl->dirty[i], &r);
+            uint32_t growth = u.w * u.h - ctrl->dirty[i].w * ctrl->dirty[i].h;
+            if (growth < bestGrowth) {
+                best = i;
+                bestGrowth = growth;
+            }
+        }
+        r = k70LcdRectUnion(&ctrl->dirty[best], &r);
+        ctrl->dirty[best] = ctrl->dirty[--ctrl->ndirty];
+        k70LcdMarkDirty(ctrl, r);
+        return;
+    }
+
+    ctrl->dirty[ctrl->ndirty++] = r;
 }
 
-static void k70LcdScroll(Lcd* lcd) {
+/**
+ * k70LcdRect() - draw pixels into a rect of the back buffer
+ * @lcd:    LCD
+ * @r:      rect to update
+ * @pixels: @r->w * @r->h pixels, row by row
+ *
+ * Nothing reaches the screen until the next swap.
+ *
+ * Return: 0 on success, -1 with errno EINVAL if @r is off screen or
+ * ENOMEM if the back buffer could not be allocated
+ */
+static int k70LcdRect(Lcd* lcd, const LcdRect* r, const void* pixels) {
     Control* ctrl = lcd->regs;
-    uint32_t* buf = ctrl->mmap;
+    if (r->w == 0 || r->h == 0 || r->x + r->w > ctrl->xsize || r->y + r->h > ctrl->ysize) {
+        errno = EINVAL;
+        return -1;
+    }
 
-    /* scroll up from bottom */
-    memmove(buf, buf + (ctrl->consFontH * ctrl->xsize), ctrl->bpp * lcd->consY * ctrl->xsize);
+    if (!ctrl->back) {
+        ctrl->back = syskmalloc(lcd->fbSize);
+        if (!ctrl->back) {
+            errno = ENOMEM;
+            return -1;
+        }
+        kmemcpy(ctrl->back, k70LcdRow(ctrl, 0), lcd->fbSize); /* contiguous thanks to the mirror */
+    }
 
-    uint8_t r = LCD_PIXEL(ctrl, lcd->colors.bg, R);
-    uint8_t g = LCD_PIXEL(ctrl, lcd->colors.bg, G);
-    uint8_t b = LCD_PIXEL(ctrl, lcd->colors.bg, B);
+    const char* in = pixels;
+    size_t rowBytes = r->w * ctrl->bpp;
+    for (uint32_t y = 0; y < r->h; y++, in += rowBytes)
+        kmemcpy(ctrl->back + (r->y + y) * ctrl->xsize + r->x, in, rowBytes);
 
-    /* clear last row */
-    if (r == g && r == b) {
-        kmemset(buf + (lcd->consY * ctrl->xsize), r, ctrl->bpp * (ctrl->ysize - lcd->consY) * ctrl->xsize);
-    } else {
-        for (uint32_t* pixel = buf + (lcd->consY + ctrl->xsize); pixel < (buf + ctrl->ysize * ctrl->xsize); pixel++) {
-            *pixel = lcd->colors.bg;
+    k70LcdMarkDirty(ctrl, *r);
+    return 0;
+}
+
+/**
+ * k70LcdWaitFrame() - spin until the LCDC finishes fetching a frame
+ */
+static void k70LcdWaitFrame(void) {
+#ifdef PLATFORM_K70CW
+    uint32_t sink = LCDC_LISR; /* reading clears stale status */
+    UNUSED(sink);
+    for (unsigned spin = 0; spin < LCD_EOF_SPIN; spin++) {
+        if (LCDC_LISR & LCDC_LISR_EOF_MASK)
+            break;
+    }
+#endif
+}
+
+/**
+ * k70LcdSwap() - push the dirty rects of the back buffer to the screen
+ * @lcd:   LCD
+ * @vsync: wait for the end of the current frame first, so the copy
+ *         lands in vertical blanking rather than tearing mid-frame
+ */
+static void k70LcdSwap(Lcd* lcd, int vsync) {
+    Control* ctrl = lcd->regs;
+    if (ctrl->ndirty == 0)
+        return;
+
+    if (vsync)
+        k70LcdWaitFrame();
+
+    for (unsigned i = 0; i < ctrl->ndirty; i++) {
+        LcdRect* r = &ctrl->dirty[i];
+        size_t rowBytes = r->w * ctrl->bpp;
+        for (uint32_t y = r->y; y < (uint32_t)r->y + r->h; y++) {
+            uint32_t* row = k70LcdRow(ctrl, y) + r->x;
+            kmemcpy(row, ctrl->back + y * ctrl->xsize + r->x, rowBytes);
+            kmemcpy(k70LcdMirror(ctrl, row), row, rowBytes);
+        }
+    }
+    ctrl->ndirty = 0;
+}
+
+static void k70LcdScroll(Lcd* lcd) {
+    Control* ctrl = lcd->regs;
+
+    /* the old top text row becomes the new bottom one */
+    ctrl->top = (ctrl->top + ctrl->consFontH) % ctrl->ysize;
+    k70LcdFillRows(lcd, lcd->consY, ctrl->ysize - lcd->consY);
+    k70LcdPan(ctrl);
+}
+
+/**
+ * k70LcdDrawChar() - draw a character at the console cursor
+ * @lcd: LCD
+ * @c:   character
+ */
+static void k70LcdDrawChar(Lcd* lcd, unsigned char c) {
+    Control* ctrl = lcd->regs;
+    const uint32_t* glyph = k70LcdGlyph(lcd, c);
+
+    for (uint32_t y = 0; y < ctrl->consFontH; y++) {
+        uint32_t* row = k70LcdRow(ctrl, lcd->consY + y) + lcd->consX;
+        uint32_t* mirror = k70LcdMirror(ctrl, row);
+        if (glyph) {
+            const uint32_t* bits = glyph + y * PROFONT_FONT_WIDTH;
+            for (uint32_t x = 0; x < PROFONT_FONT_WIDTH; x++) {
+                row[x]    = bits[x];
+                mirror[x] = bits[x];
+            }
+        } else {
+            for (uint32_t x = 0; x < ctrl->consFontW; x++) {
+                row[x]    = profont[c][y][x] ? lcd->colors.fg : lcd->colors.bg;
+                mirror[x] = row[x];
+            }
         }
     }
 }
 
 static void k70LcdPutc(Lcd* lcd, int c) {
     Control* ctrl = lcd->regs;
-    uint32_t* buf = ctrl->mmap;
 
     switch (c) {
     case '\r':
@@ -213,11 +486,7 @@ static void k70LcdPutc(Lcd* lcd, int c) {
         k70LcdClear(lcd);
         break;
     default:
-        for (uint32_t y = 0; y < ctrl->consFontH; y++) {
-            for (uint32_t x = 0; x < ctrl->consFontW; x++) {
-                *(buf + (y + lcd->consY) * ctrl->xsize + (x + lcd->consX)) = profont[c][y][x] ? lcd->colors.fg : lcd->colors.bg;
-            }
-        }
+        k70LcdDrawChar(lcd, c);
         lcd->consX += ctrl->consFontW;
         break;
     }
@@ -235,6 +504,8 @@ LcdHw k70LcdHw = {
 ,   .disable = k70LcdDisable
 ,   .clear   = k70LcdClear
 ,   .blit    = k70LcdBlit
+,   .rect    = k70LcdRect
+,   .swap    = k70LcdSwap
 ,   .scroll  = k70LcdScroll
 ,   .putc    = k70LcdPutc
 };
@@ -0,0 +1,178 @@
+#include <manos.h>
+#include <arch/k70/derivative.h>
+
+/*
+ * The K70 has no core MPU, only the system MPU on the crossbar slave
+ * ports. Regions are OR'd: an access is allowed if any region holding
+ * it allows it. Procs run in user mode and the kernel in supervisor, so
+ * the map below takes user writes away everywhere, then gives them back
+ * in the gaps between the fences and inside the running Proc's own stack.
+ *
+ *   RGD0   everything       supervisor rwx, user r-x, DMA masters and LCDC rw
+ *   RGD1-2 gaps             user rwx
+ *   RGD3   rp's stack       user rw-, reloaded by switchMpu() on each switch
+ *   RGD4-  more gaps        user rwx
+ *
+ * The fences are the stack arena, the KERNEL_DATA section and the
+ * metadata at the base of each kmalloc() region. Procs allocate through
+ * a syscall, so nothing in user mode writes them. The MPU works in 32
+ * byte blocks and a fence is shrunk to the whole blocks inside it, a
+ * block shared with anything else stays open. Chunk tags and arenas sit
+ * among the allocations and stay user writable.
+ */
+
+#define MPU_UM_R 4
+#define MPU_UM_W 2
+#define MPU_UM_X 1
+#define MPU_SM_RWX    0
+#define MPU_SM_AS_UM  3
+
+#define MPU_SLAVE_PORTS 5
+#define MPU_RGDS        12
+#define MPU_RGD_STACK   3
+#define MPU_BLOCK       32
+#define MPU_MAX_FENCES  8
+
+#ifdef PLATFORM_K70CW
+
+static void setRegion(unsigned rgd, uintptr_t start, uintptr_t end, uint32_t um) {
+    /* a write to words 0-2 clears the valid bit, word 3 sets it again */
+    MPU_WORD_REG(MPU_BASE_PTR, rgd, 0) = MPU_WORD_SRTADDR(start >> 5);
+    MPU_WORD_REG(MPU_BASE_PTR, rgd, 1) = MPU_WORD_ENDADDR(end >> 5);
+    MPU_WORD_REG(MPU_BASE_PTR, rgd, 2) = MPU_WORD_M0UM(um) | MPU_WORD_M0SM(MPU_SM_AS_UM)
+                                       | MPU_WORD_M1UM(um) | MPU_WORD_M1SM(MPU_SM_AS_UM);
+    MPU_WORD_REG(MPU_BASE_PTR, rgd, 3) = MPU_WORD_VLD_MASK;
+}
+
+extern char __kernel_data_start[];
+extern char __kernel_data_end[];
+
+typedef struct Fence {
+    uintptr_t start;
+    uintptr_t end;   /* one past the last byte */
+} Fence;
+
+/* insert [start, end) into the n fences sorted by start, returns the new count */
+static unsigned addFence(Fence* fences, unsigned n, uintptr_t start, uintptr_t end) {
+    start = (start + MPU_BLOCK - 1) & ~(uintptr_t)(MPU_BLOCK - 1);
+    end &= ~(uintptr_t)(MPU_BLOCK - 1);
+    if (start >= end || n == MPU_MAX_FENCES)
+        return n;
+
+    unsigned i = n;
+    for (; i > 0 && fences[i - 1].start > start; i--)
+        fences[i] = fences[i - 1];
+    fences[i].start = start;
+    fences[i].end = end;
+    return n + 1;
+}
+
+/* give user mode [start, last] in the next free descriptor, returns the one after */
+static unsigned openGap(unsigned rgd, uintptr_t start, uintptr_t last) {
+    if (rgd == MPU_RGD_STACK)
+        rgd++;
+    setRegion(rgd, start, last, MPU_UM_R | MPU_UM_W | MPU_UM_X);
+    return rgd + 1;
+}
+
+/**
+ * initMpu() - fence the kernel off from user mode
+ *
+ * Call once the first Proc has its stack, so the arena exists, and the
+ * allocator has laid out its regions. Without an arena the MPU is left
+ * off.
+ */
+void initMpu(void) {
+    Fence fences[MPU_MAX_FENCES];
+    unsigned n = 0;
+    uintptr_t start, end;
+    if (getStackArena(&start, &end) == -1)
+        return;
+
+    n = addFence(fences, n, start, end);
+    n = addFence(fences, n, (uintptr_t)__kernel_data_start, (uintptr_t)__kernel_data_end);
+    for (unsigned i = 0; kmallocRegionMeta(i, &start, &end) == 0; i++)
+        n = addFence(fences, n, start, end);
+
+    MPU_CESR &= ~MPU_CESR_VLD_MASK;
+
+    /* RGD0 bounds are fixed, only its access rights can be changed */
+    MPU_RGDAAC_REG(MPU_BASE_PTR, 0) = MPU_RGDAAC_M0UM(MPU_UM_R | MPU_UM_X) | MPU_RGDAAC_M0SM(MPU_SM_RWX)
+                                    | MPU_RGDAAC_M1UM(MPU_UM_R | MPU_UM_X) | MPU_RGDAAC_M1SM(MPU_SM_RWX)
+                                    | MPU_RGDAAC_M2UM(MPU_UM_R | MPU_UM_W | MPU_UM_X) | MPU_RGDAAC_M2SM(MPU_SM_RWX)
+                                    | MPU_RGDAAC_M3UM(MPU_UM_R | MPU_UM_W | MPU_UM_X) | MPU_RGDAAC_M3SM(MPU_SM_RWX)
+                                    | MPU_RGDAAC_M4WE_MASK | MPU_RGDAAC_M4RE_MASK
+                                    | MPU_RGDAAC_M5WE_MASK | MPU_RGDAAC_M5RE_MASK
+                                    | MPU_RGDAAC_M6WE_MASK | MPU_RGDAAC_M6RE_MASK
+                                    | MPU_RGDAAC_M7WE_MASK | MPU_RGDAAC_M7RE_MASK;
+
+    unsigned rgd = 1;
+    uintptr_t at = 0;
+    for (unsigned i = 0; i < n; i++) {
+        if (fences[i].start > at)
+            rgd = openGap(rgd, at, fences[i].start - 1);
+        if (fences[i].end > at)
+            at = fences[i].end;
+    }
+    rgd = openGap(rgd, at, 0xffffffff);
+
+    for (; rgd < MPU_RGDS; rgd++)
+        MPU_WORD_REG(MPU_BASE_PTR, rgd, 3) = 0;
+    MPU_WORD_REG(MPU_BASE_PTR, MPU_RGD_STACK, 3) = 0;
+
+    MPU_CESR |= MPU_CESR_VLD_MASK;
+}
+
+/**
+ * switchMpu() - give user mode write access to a Proc's stack alone
+ * @p: Proc about to run
+ *
+ * Four register writes, cheap enough for every context switch. A stack
+ * from outside the arena is already writable and needs no region.
+ */
+void switchMpu(const Proc* p) {
+    uintptr_t start, end;
+    if (getStackRegion(p, &start, &end) == -1) {
+        MPU_WORD_REG(MPU_BASE_PTR, MPU_RGD_STACK, 3) = 0;
+        return;
+    }
+    setRegion(MPU_RGD_STACK, start, end, MPU_UM_R | MPU_UM_W);
+}
+
+/**
+ * mpuFault() - collect and clear an MPU access error
+ * @addr: set to the address of the refused access
+ *
+ * Return: 1 if the MPU refused an access, 0 if not
+ */
+int mpuFault(uint32_t* addr) {
+    uint32_t sperr = MPU_CESR & MPU_CESR_SPERR_MASK;
+    if (!sperr)
+        return 0;
+
+    for (unsigned i = 0; i < MPU_SLAVE_PORTS; i++) {
+        if (sperr & (1u << (31 - i))) { /* SPERR bit 7 is slave port 0 */
+            *addr = MPU_EAR_REG(MPU_BASE_PTR, i);
+            break;
+        }
+    }
+
+    MPU_CESR = MPU_CESR_VLD_MASK | sperr; /* write one to clear */
+    return 1;
+}
+
+#else
+
+void initMpu(void) {
+}
+
+void switchMpu(const Proc* p) {
+    UNUSED(p);
+}
+
+int mpuFault(uint32_t* addr) {
+    UNUSED(addr);
+    return 0;
+}
+
+#endif /* PLATFORM_K70CW */
@@ -158,6 +158,15 @@ static void k70UartPutc(Uart* uart, char c) {
     leaveCriticalRegion();
 }
 
+/*
+ * Start the transmit interrupt, which sends outQ and then the kernel
+ * log; TDRE is already set on an idle UART, so it fires at once.
+ */
+static void k70UartKick(Uart* uart) {
+    Control* ctrl = uart->regs;
+    ATOMIC(UART_C2_REG(ctrl->mmap) |= UART_C2_TIE_MASK);
+}
+
 UartHW k70UartHW = {
     .name    = "k70Uart"
 ,   .hotplug = k70UartHotplug
@@ -168,6 +177,7 @@ UartHW k70UartHW = {
 ,   .bits    = k70UartBits
 ,   .getc    = k70UartGetc
 ,   .putc    = k70UartPutc
+,   .kick    = k70UartKick
 };
 
 void k70UartInterrupt(void) {
@@ -187,6 +197,14 @@ void k70UartInterrupt(void) {
         if (dequeueFifoQ(uart->outQ, &c))
             UART_D_REG(ctrl->mmap) = c;
 
+        /* the console refills from the kernel log once writes are out */
+        if (uart->outQ->isEmpty && uart == consoleUart) {
+            char text[16];
+            size_t n = takeKlog(text, sizeof text);
+            for (size_t i = 0; i < n; i++)
+                enqueueFifoQ(uart->outQ, text[i]);
+        }
+
         if (uart->outQ->isEmpty)
             UART_C2_REG(ctrl->mmap) &= ~UART_C2_TIE_MASK;
     }
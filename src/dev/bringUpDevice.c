@@ -0,0 +1,44 @@
+#include <manos.h>
+#include <manos/list.h>
+
+enum {
+    DeviceDown = 0
+,   DeviceComingUp
+,   DeviceUp
+};
+
+static uint8_t deviceUp[MANOS_MAXDEV];
+static LIST_HEAD(deviceUpQ); /* callers waiting for a device another is bringing up */
+
+/**
+ * bringUpDevice() - reset, power on and init a device, once
+ * @device: index into the device table
+ *
+ * main() brings up the devices a boot needs; a lazy device comes up on
+ * its first attach instead. Must run in supervisor mode, as from main()
+ * or a syscall. Only claiming the device is a critical region, the
+ * bring-up itself runs with interrupts on; a second caller meanwhile
+ * sleeps until it is done, so it never sees a device half way up.
+ */
+void bringUpDevice(DeviceIndex device) {
+    enterCriticalRegion();
+    if (deviceUp[device] != DeviceDown) {
+        while (deviceUp[device] == DeviceComingUp) {
+            if (sleepOn(&deviceUpQ, 0) == -1)
+                break;
+        }
+        leaveCriticalRegion();
+        return;
+    }
+    deviceUp[device] = DeviceComingUp;
+    leaveCriticalRegion();
+
+    deviceTable[device]->reset();
+    deviceTable[device]->power(1);
+    deviceTable[device]->init();
+
+    enterCriticalRegion();
+    deviceUp[device] = DeviceUp;
+    wakeUp(&deviceUpQ);
+    leaveCriticalRegion();
+}
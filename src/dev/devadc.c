@@ -1,49 +1,569 @@
 /*
- * Trival ADC device. 
+ * Trival ADC device.
  *
- * Provides 
+ * Provides
  *
  * /pot which gives raw potentiometer readings
  * /temp which gives raw temp sensor readings
+ * /ctl which starts and stops streaming: "stream <chan> <hz>", "stop"
+ *      and configures frames: "scan <chan> ...", "avg <chan> <n>",
+ *      "oversample <bits>", "decimate <n>"
+ * /stream which gives blocks of timestamped samples while streaming
+ * /frame which gives one uint32 per scanned channel, in scan order
+ *
+ * Streamed conversions are hardware triggered by PDB0 channel 1, which
+ * rides on the same ~1kHz counter as the millisecond alarms, so the
+ * stream rate is that tick divided down. Each conversion complete
+ * interrupt drops a sample into a ring; a read of /stream blocks until
+ * enough samples are waiting to fill the caller's buffer.
+ *
+ * A frame converts each channel of the scan list with its hardware
+ * averaging (1, 4, 8, 16 or 32 samples), sums 4^bits conversions and
+ * drops bits to oversample, then boxcar averages n of those results as
+ * a decimating low-pass filter.
+ *
+ * On NICE there is no ADC; samples are synthesized from a waveform
+ * selected with "wave sine|triangle|square|saw" on /ctl.
  */
 #include <errno.h>
 #include <manos.h>
+#include <manos/list.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <arch/k70/derivative.h>
 
+#define ADC_TICK_HZ    1000 /* PDB0 trigger rate, see k70PDB0 */
+#define ADC_RING_SIZE  512  /* power of two */
+#define ADC_MAX_CHAN   0x1f
+#define ADC_MAX_SCAN   8
+#define ADC_MAX_OVERSAMPLE 4   /* extra bits, 256 conversions */
+#define ADC_MAX_DECIMATE   64
+#define ADC_DEFAULT_AVG    32
+
+typedef enum {
+    AdcPot  = 0x14
+,   AdcTemp = 0x1a
+} AdcChan;
+
+typedef enum {
+    WaveSine
+,   WaveTriangle
+,   WaveSquare
+,   WaveSaw
+} AdcWave;
+
+/**
+ * struct AdcStream - streaming state shared with the conversion interrupt
+ * @running:   non-zero while PDB triggered conversions are enabled
+ * @channel:   channel being streamed
+ * @hz:        requested sample rate
+ * @divisor:   PDB ticks per kept sample
+ * @tick:      PDB ticks since the last kept sample
+ * @head:      next ring slot to fill
+ * @count:     samples waiting in the ring
+ * @dropped:   samples overwritten unread since the last block
+ * @watermark: samples a sleeping reader is waiting for
+ * @readers:   Procs blocked reading /stream
+ * @wave:      synthesized waveform (NICE)
+ * @msecs:     synthesized clock (NICE)
+ * @ring:      the samples
+ */
+typedef struct AdcStream {
+    volatile int      running;
+    unsigned          channel;
+    unsigned          hz;
+    unsigned          divisor;
+    unsigned          tick;
+    unsigned          head;
+    volatile unsigned count;
+    uint32_t          dropped;
+    unsigned          watermark;
+    ListHead          readers;
+    AdcWave           wave;
+    uint32_t          msecs;
+    AdcSample         ring[ADC_RING_SIZE];
+} AdcStream;
+
+static AdcStream adcStream;
+
+/**
+ * struct AdcScan - frame configuration
+ * @count:      channels in the scan list
+ * @channel:    channels, in frame order
+ * @avg:        hardware samples averaged per conversion, per channel
+ * @oversample: extra bits of resolution, 4^bits conversions per result
+ * @decimate:   results boxcar averaged into each frame value
+ */
+typedef struct AdcScan {
+    unsigned count;
+    uint8_t  channel[ADC_MAX_SCAN];
+    uint8_t  avg[ADC_MAX_SCAN];
+    unsigned oversample;
+    unsigned decimate;
+} AdcScan;
+
+static AdcScan adcScan = {
+    .count      = 2
+,   .channel    = { AdcPot, AdcTemp }
+,   .avg        = { ADC_DEFAULT_AVG, ADC_DEFAULT_AVG }
+,   .oversample = 0
+,   .decimate   = 1
+};
+
+/**
+ * adcSc3() - ADC_SC3 bits for a hardware averaging count
+ * @avg: samples averaged, one of 1, 4, 8, 16 or 32
+ *
+ * Return: the SC3 value, or -1 if @avg is not supported
+ */
+static int adcSc3(unsigned avg) {
+    switch (avg) {
+    case 1:  return 0;
+    case 4:  return ADC_SC3_AVGE_MASK | ADC_SC3_AVGS(0x0);
+    case 8:  return ADC_SC3_AVGE_MASK | ADC_SC3_AVGS(0x1);
+    case 16: return ADC_SC3_AVGE_MASK | ADC_SC3_AVGS(0x2);
+    case 32: return ADC_SC3_AVGE_MASK | ADC_SC3_AVGS(0x3);
+    default: return -1;
+    }
+}
+
 static void initAdcHw(void) {
 #ifdef PLATFORM_K70CW
     SIM_SCGC3 |= SIM_SCGC3_ADC1_MASK;
     ADC1_CFG1  = ADC_CFG1_MODE(0x1); /* bits 12 & 13 */
-    ADC1_SC3   = ADC_SC3_AVGE_MASK | ADC_SC3_AVGS(0x3); /* sample average of 32 per cycle */
+    ADC1_SC3   = adcSc3(ADC_DEFAULT_AVG);
 #endif
 }
 
-typedef enum {
-    AdcPot  = 0x14
-,   AdcTemp = 0x1a
-} AdcChan;
+#ifdef PLATFORM_NICE
+/* first quadrant of a 12bit sine, 16 steps */
+static const uint16_t sineQuadrant[17] = {
+       0,  201,  399,  594,  783,  965, 1137, 1299
+,   1447, 1582, 1702, 1805, 1891, 1959, 2008, 2038
+,   2047
+};
+
+/**
+ * synthesizeAdc() - NICE stand-in for a conversion
+ * @msecs: time of the conversion
+ *
+ * Return: a 12bit sample of the selected waveform with a one second period
+ */
+static uint16_t synthesizeAdc(uint32_t msecs) {
+    unsigned phase = (msecs % 1000) * 64 / 1000; /* 0 .. 63 */
+    unsigned step  = phase % 16;
+    switch (adcStream.wave) {
+    case WaveTriangle:
+        return phase < 32 ? phase * 4095 / 31 : (63 - phase) * 4095 / 31;
+    case WaveSquare:
+        return phase < 32 ? 4095 : 0;
+    case WaveSaw:
+        return phase * 4095 / 63;
+    case WaveSine:
+    default:
+        switch (phase / 16) {
+        case 0:  return 2048 + sineQuadrant[step];
+        case 1:  return 2048 + sineQuadrant[16 - step];
+        case 2:  return 2048 - sineQuadrant[step];
+        default: return 2048 - sineQuadrant[16 - step];
+        }
+    }
+}
+#endif
 
-static int32_t readAdcHw(AdcChan chan) {
+static int32_t readAdcHw(unsigned chan, unsigned avg) {
+#ifdef PLATFORM_K70CW
+    ADC1_SC3  = adcSc3(avg);
     ADC1_SC1A = chan;
     while (!(ADC1_SC1A & ADC_SC1_COCO_MASK))
         ;
     return ADC1_RA;
+#else
+    UNUSED(avg);
+    return synthesizeAdc((uint32_t)systime + chan * 125); /* channels out of phase */
+#endif
 }
 
 static int32_t readPotAdc(void) {
-    return readAdcHw(AdcPot);
+    return readAdcHw(AdcPot, ADC_DEFAULT_AVG);
 }
 
 static int32_t readTempAdc(void) {
-    return readAdcHw(AdcTemp);
+    return readAdcHw(AdcTemp, ADC_DEFAULT_AVG);
+}
+
+/**
+ * readAdcFrame() - convert every channel of the scan list
+ * @buf:  destination, receives one uint32_t per channel
+ * @size: bytes available at @buf
+ *
+ * Return: bytes written, -1 with errno EINVAL if @buf is too small
+ */
+static ptrdiff_t readAdcFrame(void* buf, size_t size) {
+    size_t bytes = adcScan.count * sizeof(uint32_t);
+    if (size < bytes) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    uint32_t* out = buf;
+    unsigned conversions = 1 << (2 * adcScan.oversample);
+    for (unsigned i = 0; i < adcScan.count; i++) {
+        uint32_t acc = 0;
+        for (unsigned d = 0; d < adcScan.decimate; d++) {
+            uint32_t sum = 0;
+            for (unsigned n = 0; n < conversions; n++)
+                sum += readAdcHw(adcScan.channel[i], adcScan.avg[i]);
+            acc += sum >> adcScan.oversample;
+        }
+        out[i] = acc / adcScan.decimate;
+    }
+
+    return bytes;
+}
+
+/**
+ * putAdcSample() - append a sample to the stream ring
+ * @msecs: time of the conversion
+ * @value: conversion result
+ *
+ * Called from the conversion interrupt. A full ring overwrites its oldest
+ * sample and counts it as dropped, so readers always see the newest data.
+ */
+static void putAdcSample(uint32_t msecs, uint16_t value) {
+    AdcSample* s = &adcStream.ring[adcStream.head];
+    s->msecs   = msecs;
+    s->channel = adcStream.channel;
+    s->value   = value;
+    adcStream.head = (adcStream.head + 1) & (ADC_RING_SIZE - 1);
+
+    if (adcStream.count == ADC_RING_SIZE)
+        adcStream.dropped++;
+    else
+        adcStream.count++;
+
+    if (adcStream.count >= adcStream.watermark)
+        wakeUp(&adcStream.readers);
+}
+
+/**
+ * adcHandler() - ADC1 conversion complete interrupt
+ */
+void adcHandler(void) {
+#ifdef PLATFORM_K70CW
+    uint16_t value = ADC1_RA; /* reading R clears COCO */
+    if (!adcStream.running)
+        return;
+
+    if (++adcStream.tick < adcStream.divisor)
+        return;
+
+    adcStream.tick = 0;
+    putAdcSample((uint32_t)systime, value);
+#endif
+}
+
+#ifdef PLATFORM_NICE
+/**
+ * synthesizeAdcStream() - fill the ring as though @n conversions completed
+ * @n: samples to produce
+ */
+static void synthesizeAdcStream(unsigned n) {
+    while (n--) {
+        adcStream.msecs += adcStream.divisor;
+        putAdcSample(adcStream.msecs, synthesizeAdc(adcStream.msecs));
+    }
+}
+#endif
+
+static void startAdcStreamHw(void) {
+#ifdef PLATFORM_K70CW
+    ADC1_SC3     = adcSc3(ADC_DEFAULT_AVG);
+    ADC1_SC2    |= ADC_SC2_ADTRG_MASK;
+    ADC1_SC1A    = ADC_SC1_AIEN_MASK | ADC_SC1_ADCH(adcStream.channel);
+    PDB0_CH1DLY0 = 0;
+    PDB0_CH1C1   = PDB_C1_EN(1) | PDB_C1_TOS(1); /* pre-trigger 0 on every PDB0 cycle */
+    PDB0_SC     |= PDB_SC_LDOK_MASK;
+    enableNvicIrq(NVIC_IRQ_ADC1, MANOS_ARCH_K70_ADC1_PRIORITY);
+#endif
+}
+
+static void stopAdcStreamHw(void) {
+#ifdef PLATFORM_K70CW
+    PDB0_CH1C1  = 0;
+    PDB0_SC    |= PDB_SC_LDOK_MASK;
+    ADC1_SC2   &= ~ADC_SC2_ADTRG_MASK;
+    ADC1_SC1A   = ADC_SC1_ADCH(ADC_MAX_CHAN); /* module disabled */
+#endif
+}
+
+/**
+ * startAdcStream() - begin streaming a channel
+ * @channel: ADC channel to convert
+ * @hz:      samples per second, 1 .. ADC_TICK_HZ
+ *
+ * Return: 0 on success, -1 with errno EINVAL on a bad argument
+ */
+static int startAdcStream(unsigned channel, unsigned hz) {
+    if (channel >= ADC_MAX_CHAN || hz == 0 || hz > ADC_TICK_HZ) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    enterCriticalRegion();
+    stopAdcStreamHw();
+    adcStream.channel   = channel;
+    adcStream.hz        = hz;
+    adcStream.divisor   = ADC_TICK_HZ / hz;
+    adcStream.tick      = 0;
+    adcStream.head      = 0;
+    adcStream.count     = 0;
+    adcStream.dropped   = 0;
+    adcStream.watermark = 1;
+    adcStream.msecs     = (uint32_t)systime;
+    adcStream.running   = 1;
+    startAdcStreamHw();
+    leaveCriticalRegion();
+    return 0;
+}
+
+static void stopAdcStream(void) {
+    enterCriticalRegion();
+    adcStream.running = 0;
+    stopAdcStreamHw();
+    wakeUp(&adcStream.readers);
+    leaveCriticalRegion();
+}
+
+/**
+ * readAdcStream() - copy out a block of streamed samples
+ * @buf:  destination, receives an AdcBlock then its samples
+ * @size: bytes available at @buf
+ *
+ * Blocks until as many samples as fit in @buf (capped at half the ring)
+ * are waiting, or the stream is stopped.
+ *
+ * Return: bytes copied, 0 once the stream is stopped and drained, -1 on error
+ */
+static ptrdiff_t readAdcStream(void* buf, size_t size) {
+    if (size < sizeof(AdcBlock) + sizeof(AdcSample)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    unsigned want = (size - sizeof(AdcBlock)) / sizeof(AdcSample);
+    if (want > ADC_RING_SIZE / 2)
+        want = ADC_RING_SIZE / 2;
+
+#ifdef PLATFORM_NICE
+    if (adcStream.running && adcStream.count < want)
+        synthesizeAdcStream(want - adcStream.count);
+#endif
+
+    enterCriticalRegion();
+    while (adcStream.running && adcStream.count < want) {
+        adcStream.watermark = want;
+        if (sleepOn(&adcStream.readers, 0) == -1) {
+            leaveCriticalRegion();
+            return -1;
+        }
+    }
+    adcStream.watermark = 1;
+
+    AdcBlock* block = buf;
+    AdcSample* out  = (AdcSample*)(block + 1);
+    unsigned n      = adcStream.count < want ? adcStream.count : want;
+    unsigned tail   = (adcStream.head - adcStream.count) & (ADC_RING_SIZE - 1);
+    for (unsigned i = 0; i < n; i++)
+        out[i] = adcStream.ring[(tail + i) & (ADC_RING_SIZE - 1)];
+
+    block->count      = n;
+    block->dropped    = adcStream.dropped;
+    adcStream.count  -= n;
+    adcStream.dropped = 0;
+    leaveCriticalRegion();
+
+    if (n == 0)
+        return 0;
+
+    return sizeof(AdcBlock) + n * sizeof(AdcSample);
+}
+
+/**
+ * parseAdcArgs() - parse the numeric arguments of a /ctl command
+ * @arg: text following the command word
+ * @v:   receives the values
+ * @max: capacity of @v
+ *
+ * Return: number of values parsed, -1 if there are more than @max or a
+ * word is not a non-negative number
+ */
+static int parseAdcArgs(char* arg, long* v, unsigned max) {
+    unsigned n = 0;
+    for (;;) {
+        while (*arg == ' ')
+            arg++;
+        if (*arg == '\0' || *arg == '\n')
+            return n;
+
+        char* e;
+        long x = strtol(arg, &e, 0);
+        if (e == arg || x < 0 || n == max)
+            return -1;
+        v[n++] = x;
+        arg = e;
+    }
+}
+
+/**
+ * setAdcScan() - replace the scan list
+ * @v: channels
+ * @n: channels in @v
+ *
+ * Channels keep their averaging if they were already in the list.
+ *
+ * Return: 0 on success, -1 with errno EINVAL on a bad channel
+ */
+static int setAdcScan(const long* v, unsigned n) {
+    AdcScan scan = adcScan;
+    scan.count = n;
+    for (unsigned i = 0; i < n; i++) {
+        if (v[i] >= ADC_MAX_CHAN) {
+            errno = EINVAL;
+            return -1;
+        }
+        scan.channel[i] = v[i];
+        scan.avg[i]     = ADC_DEFAULT_AVG;
+        for (unsigned j = 0; j < adcScan.count; j++) {
+            if (adcScan.channel[j] == v[i])
+                scan.avg[i] = adcScan.avg[j];
+        }
+    }
+    adcScan = scan;
+    return 0;
+}
+
+static const char* const adcWaveNames[] = {
+    [WaveSine]     = "sine"
+,   [WaveTriangle] = "triangle"
+,   [WaveSquare]   = "square"
+,   [WaveSaw]      = "saw"
+};
+
+#define ADC_CTL_MAP \
+    X("stop", Stop, 0, 0) \
+    X("stream", Stream, 2, 2) \
+    X("scan", Scan, 1, ADC_MAX_SCAN) \
+    X("avg", Avg, 2, 2) \
+    X("oversample", Oversample, 1, 1) \
+    X("decimate", Decimate, 1, 1) \
+    X("wave", Wave, 0, 0)
+
+#define X(w, c, lo, hi) AdcCtl##c,
+typedef enum {
+ADC_CTL_MAP
+} AdcCtl;
+#undef X
+
+#define X(w, c, lo, hi) { w, lo, hi },
+static const struct {
+    const char* word;
+    unsigned    min;
+    unsigned    max;
+} adcCtls[] = {
+ADC_CTL_MAP
+};
+#undef X
+
+/**
+ * ctlAdc() - apply one /ctl command
+ * @cmd: NUL terminated command line
+ *
+ * Return: 0 on success, -1 with errno EINVAL on a malformed command
+ */
+static int ctlAdc(char* cmd) {
+    char* arg = cmd;
+    while (*arg && *arg != ' ' && *arg != '\n')
+        arg++;
+    size_t len = arg - cmd;
+
+    unsigned ctl;
+    for (ctl = 0; ctl < COUNT_OF(adcCtls); ctl++) {
+        if (strlen(adcCtls[ctl].word) == len && strncmp(cmd, adcCtls[ctl].word, len) == 0)
+            break;
+    }
+
+    if (ctl == COUNT_OF(adcCtls)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (ctl == AdcCtlWave) {
+        while (*arg == ' ')
+            arg++;
+        for (unsigned i = 0; i < COUNT_OF(adcWaveNames); i++) {
+            size_t n = strlen(adcWaveNames[i]);
+            if (strncmp(arg, adcWaveNames[i], n) == 0 && (arg[n] == '\0' || arg[n] == '\n')) {
+                adcStream.wave = i;
+                return 0;
+            }
+        }
+        errno = EINVAL;
+        return -1;
+    }
+
+    long v[ADC_MAX_SCAN];
+    int n = parseAdcArgs(arg, v, COUNT_OF(v));
+    if (n < (int)adcCtls[ctl].min || n > (int)adcCtls[ctl].max) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    switch (ctl) {
+    case AdcCtlStop:
+        stopAdcStream();
+        return 0;
+    case AdcCtlStream:
+        return startAdcStream(v[0], v[1]);
+    case AdcCtlScan:
+        return setAdcScan(v, n);
+    case AdcCtlAvg:
+        if (adcSc3(v[1]) == -1)
+            break;
+        for (unsigned i = 0; i < adcScan.count; i++) {
+            if (adcScan.channel[i] == v[0]) {
+                adcScan.avg[i] = v[1];
+                return 0;
+            }
+        }
+        break;
+    case AdcCtlOversample:
+        if (v[0] > ADC_MAX_OVERSAMPLE)
+            break;
+        adcScan.oversample = v[0];
+        return 0;
+    case AdcCtlDecimate:
+        if (v[0] == 0 || v[0] > ADC_MAX_DECIMATE)
+            break;
+        adcScan.decimate = v[0];
+        return 0;
+    default:
+        break;
+    }
+
+    errno = EINVAL;
+    return -1;
 }
 
 #define NAMESPACE_MAP    \
     X(".", STATICNS_SENTINEL, Dot, CRUMB_ISDIR, 0, 0555, 0) \
     X("pot", FidDot, Pot, CRUMB_ISFILE, 0, 0444, 0) \
-    X("temp", FidDot, Temp, CRUMB_ISFILE, 0, 0444, 0)
+    X("temp", FidDot, Temp, CRUMB_ISFILE, 0, 0444, 0) \
+    X("ctl", FidDot, Ctl, CRUMB_ISFILE, 0, 0644, 0) \
+    X("stream", FidDot, Stream, CRUMB_ISFILE, 0, 0444, 0) \
+    X("frame", FidDot, Frame, CRUMB_ISFILE, 0, 0444, 0)
 
 #define X(p, u, s, t, z, m, c) Fid##s,
 typedef enum {
@@ -59,6 +579,8 @@ NAMESPACE_MAP
 #undef X
 
 static void initAdc(void) {
+    INIT_LIST_HEAD(&adcStream.readers);
+    adcStream.watermark = 1;
     initAdcHw();
 }
 
@@ -88,14 +610,59 @@ static int getInfoAdc(const Portal* p, NodeInfo* ni) {
     return getNodeInfoStaticNS(p, adcSNS, WalkSelf, ni) == NULL ? -1 : 0;
 }
 
-static ptrdiff_t readAdc(Portal* p, void* buf, size_t size, Offset offset) {
-    if (size < sizeof(uint32_t)) return 0;
+static ptrdiff_t readCtlAdc(Portal* p, void* buf, size_t size, Offset offset) {
+    char line[160];
+    int len = 0;
 
+#define ADC_FMT(...) do {                                                    \
+    ptrdiff_t n = fmtSnprintf(line + len, sizeof line - len, __VA_ARGS__);  \
+    if (n > 0) len += n;                                                    \
+} while (0)
+
+    if (adcStream.running)
+        ADC_FMT("stream %u %u %u\n", adcStream.channel, adcStream.hz, adcStream.count);
+    else
+        ADC_FMT("stop\n");
+
+    ADC_FMT("scan");
+    for (unsigned i = 0; i < adcScan.count; i++)
+        ADC_FMT(" %u/%u", adcScan.channel[i], adcScan.avg[i]);
+    ADC_FMT("\noversample %u\ndecimate %u\n", adcScan.oversample, adcScan.decimate);
+
+#undef ADC_FMT
+
+    if (offset >= (Offset)len)
+        return 0;
+
+    size_t bytes = len - offset;
+    if (bytes > size)
+        bytes = size;
+    memcpy(buf, line + offset, bytes);
+    p->offset += bytes;
+    return bytes;
+}
+
+static ptrdiff_t readAdc(Portal* p, void* buf, size_t size, Offset offset) {
     if (p->crumb.flags & CRUMB_ISDIR) {
         return readStaticNS(p, adcSNS, buf, size, offset);
     }
 
     AdcFidEnt fid = STATICNS_CRUMB_SELF_IDX(p->crumb);
+    if (fid == FidCtl)
+        return readCtlAdc(p, buf, size, offset);
+    if (fid == FidStream)
+        return readAdcStream(buf, size);
+
+    if (size < sizeof(uint32_t)) return 0;
+
+    if (adcStream.running) {
+        errno = EBUSY; /* the converter belongs to the stream */
+        return -1;
+    }
+
+    if (fid == FidFrame)
+        return readAdcFrame(buf, size);
+
     switch (fid) {
     case FidPot:
         *(uint32_t*)buf = readPotAdc();
@@ -113,12 +680,17 @@ static ptrdiff_t readAdc(Portal* p, void* buf, size_t size, Offset offset) {
 }
 
 static ptrdiff_t writeAdc(Portal *p, void* buf, size_t size, Offset offset) {
-    UNUSED(p);
-    UNUSED(buf);
-    UNUSED(size);
     UNUSED(offset);
-    errno = EPERM;
-    return -1; 
+    if ((p->crumb.flags & CRUMB_ISDIR) || STATICNS_CRUMB_SELF_IDX(p->crumb) != FidCtl) {
+        errno = EPERM;
+        return -1;
+    }
+
+    char cmd[64] = {0};
+    memcpy(cmd, buf, size < sizeof cmd - 1 ? size : sizeof cmd - 1);
+    if (ctlAdc(cmd) == -1)
+        return -1;
+    return size;
 }
 
 Dev devAdc = {
@@ -138,4 +710,5 @@ Dev devAdc = {
 ,   .setInfo  = setInfoDev
 ,   .read     = readAdc
 ,   .write    = writeAdc
+,   .lazy     = 1
 };
@@ -6,8 +6,10 @@
 #define NAMESPACE_MAP   \
     X(".",          STATICNS_SENTINEL, Dot,        CRUMB_ISDIR,  0, 0555, 0)  \
     X("date",       FidDot,            Date,       CRUMB_ISFILE, 0, 0644, 0)  \
-    X("kprint",     FidDot,            KPrint,     CRUMB_ISFILE, 0, 0222, 0)  \
-    X("interrupts", FidDot,            Interrupts, CRUMB_ISFILE, 0, 0444, 0)
+    X("kprint",     FidDot,            KPrint,     CRUMB_ISFILE, 0, 0644, 0)  \
+    X("interrupts", FidDot,            Interrupts, CRUMB_ISFILE, 0, 0444, 0)  \
+    X("crash",      FidDot,            Crash,      CRUMB_ISFILE, 0, 0644, 0)  \
+    X("boot",       FidDot,            Boot,       CRUMB_ISFILE, 0, 0644, 0)
 
 #define X(p, u, s, t, z, m, c) Fid##s,
 typedef enum {
@@ -30,6 +32,10 @@ static Portal* attachDevDev(char* path) {
         p->crumb = devdevSNS[FidKPrint].crumb;
     } else if (strcmp(path, "interrupts") == 0) {
         p->crumb = devdevSNS[FidInterrupts].crumb;
+    } else if (strcmp(path, "crash") == 0) {
+        p->crumb = devdevSNS[FidCrash].crumb;
+    } else if (strcmp(path, "boot") == 0) {
+        p->crumb = devdevSNS[FidBoot].crumb;
     } else {
         p->crumb = devdevSNS[0].crumb;
     }
@@ -76,6 +82,9 @@ extern long long timerInterruptCount;
 extern long long pdbInterruptCount;
 extern long long systickInterruptCount;
 extern long long pendsvInterruptCount;
+extern long long schedSwitchCount;
+extern long long schedFastCount;
+extern long long schedSwitchCycles;
 
 
 #define INT_MAP_FMT "%s:\t\t\t%lld\n"
@@ -90,9 +99,13 @@ static struct IntMap {
 ,   { "PDB",     &pdbInterruptCount     }
 ,   { "SYSTICK", &systickInterruptCount }
 ,   { "PENDSV",  &pendsvInterruptCount  }
+,   { "SWITCH",  &schedSwitchCount      }  /* full context switches */
+,   { "SWFAST",  &schedFastCount        }  /* switches skipped, rp kept running */
+,   { "SWCYCLE", &schedSwitchCycles     }  /* cycles in full switches, divide by SWITCH */
 };
 
-#define INT_MAP_SIZE (5 * 21 + INT_MAP_FMT_OVERHEAD)
+#define INT_MAP_NAME_MAX 8 /* longest name above, with room to spare */
+#define INT_MAP_SIZE (COUNT_OF(intMap) * (INT_MAP_NAME_MAX + 21 + INT_MAP_FMT_OVERHEAD))
 
 static size_t readInterrupts(char* buf, size_t size) {
     char* c = buf;
@@ -140,6 +153,18 @@ static ptrdiff_t readDevDev(Portal* p, void* buf, size_t size, Offset offset) {
             } else bytes = 0;
         }
         break;
+    case FidKPrint:
+        bytes = readKlog(buf, size, offset);
+        p->offset += bytes;
+        break;
+    case FidCrash:
+        bytes = readCrash(buf, size, offset);
+        p->offset += bytes;
+        break;
+    case FidBoot:
+        bytes = readBoot(buf, size, offset);
+        p->offset += bytes;
+        break;
     default:
         errno = EPERM;
         bytes = -1;
@@ -195,8 +220,13 @@ static ptrdiff_t writeDevDev(Portal* p, void* buf, size_t size, Offset offset) {
     case FidDate:
         return writeDate(buf, size);
     case FidKPrint:
-        sysnputs(buf, size);
+        klogWrite(KlogInfo, buf, size);
+        return size;
+    case FidCrash:
+        clearCrash(); /* any write, as 'echo > /dev/crash' */
         return size;
+    case FidBoot:
+        return bootMarkName(buf, size) == -1 ? -1 : (ptrdiff_t)size;
     default:
         errno = EPERM;
         return -1;
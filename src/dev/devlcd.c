@@ -1,6 +1,22 @@
+/*
+ * LCD device.
+ *
+ * Provides
+ *
+ * /clear which repaints the screen in the background color on "1"
+ * /fg and /bg which set the colors
+ * /blit which copies a whole frame to the screen
+ * /rect which takes one or more LcdRect headers, each followed by its
+ *       pixels, and draws them into a back buffer
+ * /swap which pushes the dirty parts of the back buffer to the screen,
+ *       "1" immediately, "v" at the end of the current frame
+ * /cons which writes text on the console
+ */
 #include <errno.h>
 #include <manos.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 static Lcd* enableLcd(Lcd* lcd) {
     lcd->hw->enable(lcd);
@@ -17,6 +33,8 @@ static void disableLcd(Lcd* lcd) {
     X("fg", FidDot, Fg, CRUMB_ISFILE, 0, 0644, 0) \
     X("bg", FidDot, Bg, CRUMB_ISFILE, 0, 0644, 0) \
     X("blit", FidDot, Blit, CRUMB_ISFILE, 522240, 0222, 0) \
+    X("rect", FidDot, Rect, CRUMB_ISFILE, 0, 0222, 0) \
+    X("swap", FidDot, Swap, CRUMB_ISFILE, 0, 0222, 0) \
     X("cons", FidDot, Cons, CRUMB_ISFILE, 0, 0644, 0)
 
 #define X(p, u, s, t, z, m, c) Fid##s,
@@ -77,6 +95,34 @@ static ptrdiff_t readLcd(Portal* p, void* buf, size_t size, Offset offset) {
     return -1; /* not ready to use */
 }
 
+/**
+ * writeRectLcd() - draw a run of rects into the back buffer
+ * @buf:  LcdRect headers, each followed by its pixels
+ * @size: bytes at @buf
+ *
+ * Return: bytes consumed, or -1 if the first rect is malformed
+ */
+static ptrdiff_t writeRectLcd(const char* buf, size_t size) {
+    size_t bytes = 0;
+    while (size - bytes >= sizeof(LcdRect)) {
+        LcdRect r;
+        memcpy(&r, buf + bytes, sizeof r);
+        size_t need = sizeof r + (size_t)r.w * r.h * lcdScreen->colorDepth;
+        if (size - bytes < need)
+            break;
+
+        if (lcdScreen->hw->rect(lcdScreen, &r, buf + bytes + sizeof r) == -1)
+            return bytes ? (ptrdiff_t)bytes : -1;
+        bytes += need;
+    }
+
+    if (bytes == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    return bytes;
+}
+
 static ptrdiff_t writeLcd(Portal* p, void* buf, size_t size, Offset offset) {
     UNUSED(offset);
     if (size == 0) return 0;
@@ -121,6 +167,15 @@ static ptrdiff_t writeLcd(Portal* p, void* buf, size_t size, Offset offset) {
     case FidBlit:
         lcdScreen->hw->blit(lcdScreen, buf);
         return lcdScreen->fbSize;
+    case FidRect:
+        return writeRectLcd(buf, size);
+    case FidSwap:
+        if (*(char*)buf != '1' && *(char*)buf != 'v') {
+            errno = EINVAL;
+            return -1;
+        }
+        lcdScreen->hw->swap(lcdScreen, *(char*)buf == 'v');
+        return size;
     case FidCons:
         for (size_t i = 0; i < size; i++) {
             lcdScreen->hw->putc(lcdScreen, *((char*)buf + i));
@@ -155,4 +210,5 @@ Dev devLcd = {
 ,   .setInfo  = setInfoDev
 ,   .read     = readLcd
 ,   .write    = writeLcd
+,   .lazy     = 1
 };
@@ -9,13 +9,37 @@
  *    ./yellow
  *    ./green
  *    ./blue
+ *    ./ctl
+ *    ./wave (NICE only)
  *
  *    Reading a byte from ./<color> returns in a '1' or a '0' indicating the current state of the LED
  *    Writing a byte ('1' or '0') to ./<color> updates the state of the LED.
+ *
+ *    Writing to ./ctl loads a program into an LED:
+ *
+ *      duty <color> <percent>                 steady brightness
+ *      blink <color> <period> <on> [<percent>] on for <on> of every <period> ms
+ *      seq <color> <ms> <percent> ...         each level held <ms>, looping
+ *
+ *    Reading ./ctl gives the program of each LED, one per line.
+ *
+ * Orange and blue sit on FTM2 channels 1 and 0, so their brightness is
+ * hardware PWM and a steady level costs nothing once programmed. Yellow
+ * and green have no timer channel and are software PWM in 10% steps.
+ * Blink and sequence programs are stepped by tickLed() from the
+ * millisecond PDB tick, which only counts down and rewrites a duty at
+ * each step.
+ *
+ * On NICE there are no LEDs; every level the engine programs is recorded
+ * as an LedLevel and read back from ./wave. A read runs the engine
+ * forward on its own clock until the records asked for are made, so the
+ * waveform of a program can be checked without waiting for it.
  */
 
 #include <errno.h>
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include <manos.h>
 
@@ -36,6 +60,8 @@ static uint32_t __FAKE_REG = 0;
 #define SIM_SCGC5 __FAKE_REG
 #define SIM_SCGC5_PORTA_MASK 0
 #define PTA_BASE_PTR 0
+#define FTM_CnV_REG(x, n) (&__FAKE_REG)[(n) & 0]
+#define FTM2_BASE_PTR 0
 
 #else
 #include <arch/k70/derivative.h>
@@ -86,6 +112,84 @@ typedef enum {
   LedBlue
 } LedColor;
 
+static const char* const ledColorNames[] = {
+  [LedOrange] = "orange",
+  [LedYellow] = "yellow",
+  [LedGreen]  = "green",
+  [LedBlue]   = "blue",
+};
+
+#define LED_COUNT        4
+#define LED_MAX_STEPS    8
+#define LED_MAX_MILLIS   0xffff
+#define LED_PWM_HZ       1000
+#define LED_FTM_PRESCALE 6    /* bus clock / 64 */
+#define LED_FTM_MOD      (60000000 / 64 / LED_PWM_HZ - 1)
+#define LED_SW_PERIOD    10   /* ticks per software PWM period */
+#define LED_WAVE_SIZE    64   /* power of two */
+#define LED_WAVE_HORIZON 60000 /* most ticks a ./wave read runs the engine */
+
+/*
+ * FTM2 channel driving each LED, -1 for software PWM. The pin mapping is
+ * from the K70 signal multiplexing table, PTA10 and PTA11 on ALT3.
+ */
+static const int ledFtmChannel[] = {
+  [LedOrange] = 1,
+  [LedYellow] = -1,
+  [LedGreen]  = -1,
+  [LedBlue]   = 0,
+};
+
+typedef enum {
+  ProgDuty,
+  ProgBlink,
+  ProgSeq
+} LedProgKind;
+
+static const char* const ledProgNames[] = {
+  [ProgDuty]  = "duty",
+  [ProgBlink] = "blink",
+  [ProgSeq]   = "seq",
+};
+
+/*
+ * LedStep = (Percent, Millis)
+ */
+typedef struct LedStep {
+  uint8_t  duty;
+  uint16_t millis;
+} LedStep;
+
+/*
+ * LedProgram = (LedProgKind, [LedStep], Int, Int, Percent)
+ *
+ * What an LED is doing. 'left' counts the ticks until the next step and
+ * is 0 for a program of one step, which holds forever. 'level' is the
+ * duty being output.
+ */
+typedef struct LedProgram {
+  LedProgKind       kind;
+  unsigned          steps;
+  LedStep           step[LED_MAX_STEPS];
+  unsigned          at;
+  volatile uint32_t left;
+  volatile uint8_t  level;
+} LedProgram;
+
+static LedProgram ledPrograms[LED_COUNT];
+static uint32_t ledTicks;
+
+#ifdef PLATFORM_NICE
+/*
+ * The NICE stand-in for the LEDs, a ring of the levels programmed.
+ */
+static struct {
+  unsigned head;
+  unsigned count;
+  LedLevel ring[LED_WAVE_SIZE];
+} ledWave;
+#endif
+
 /*
  * Both PSOR and PCOR are 32-bit wide registers with the property that
  * when written to the word is xor'd on the register so only set bits
@@ -127,22 +231,284 @@ static void setLed(LedColor which, LedState state) {
 /*
  * getLed :: LedColor -> LedState
  *
- * Get the state of the respecive LED device
+ * Get the state of the respecive LED device, on at any level above zero.
+ * PDOR does not follow the pins given to FTM2, so ask the program.
  */
 static LedState getLed(LedColor which) {
-  /* TODO: seems to always be 0, is this not wired up ? */
-  int rawState = (GPIO_PDOR_REG(PTA_BASE_PTR) & ledColorBits[which]);
-  LedState state = (LedState)rawState;
-  return state;
+  return ledPrograms[which].level ? LedOn : LedOff;
+}
+
+/*
+ * setFtmDutyLed :: Int -> Percent -> ()
+ *
+ * Set the duty of an FTM2 channel. The channels are low true, matching the
+ * LEDs, so CnV is the on time; 0 never turns on and above MOD never turns off.
+ * The new value is latched at the end of the running period.
+ */
+static void setFtmDutyLed(int channel, unsigned duty) {
+  FTM_CnV_REG(FTM2_BASE_PTR, channel) = duty * (LED_FTM_MOD + 1) / 100;
+}
+
+#ifdef PLATFORM_NICE
+/*
+ * recordLedLevel :: LedColor -> Percent -> ()
+ *
+ * Append a level to the wave ring, overwriting the oldest when full.
+ */
+static void recordLedLevel(LedColor which, unsigned duty) {
+  LedLevel* l = &ledWave.ring[ledWave.head];
+  l->msecs = ledTicks;
+  l->led   = which;
+  l->duty  = duty;
+  l->pad   = 0;
+  ledWave.head = (ledWave.head + 1) & (LED_WAVE_SIZE - 1);
+  if (ledWave.count < LED_WAVE_SIZE)
+    ledWave.count++;
+}
+#endif
+
+/*
+ * setLevelLed :: LedColor -> Percent -> ()
+ *
+ * Output a duty on an LED. Software PWM LEDs are left to tickLed() unless
+ * fully on or off.
+ */
+static void setLevelLed(LedColor which, unsigned duty) {
+  if (ledPrograms[which].level == duty)
+    return;
+
+  ledPrograms[which].level = duty;
+#ifdef PLATFORM_NICE
+  recordLedLevel(which, duty);
+#endif
+
+  if (ledFtmChannel[which] >= 0)
+    setFtmDutyLed(ledFtmChannel[which], duty);
+  else if (duty == 0 || duty == 100)
+    setLed(which, duty ? LedOn : LedOff);
+}
+
+/*
+ * loadLedProgram :: LedColor -> LedProgKind -> [LedStep] -> Int -> ()
+ *
+ * Replace the program of an LED and start it from its first step.
+ */
+static void loadLedProgram(LedColor which, LedProgKind kind, const LedStep* steps, unsigned n) {
+  LedProgram* prog = &ledPrograms[which];
+
+  enterCriticalRegion();
+  prog->kind  = kind;
+  prog->steps = n;
+  for (unsigned i = 0; i < n; i++)
+    prog->step[i] = steps[i];
+  prog->at   = 0;
+  prog->left = n > 1 ? steps[0].millis : 0;
+  setLevelLed(which, steps[0].duty);
+  leaveCriticalRegion();
+}
+
+/**
+ * tickLed() - advance the LED programs by a millisecond
+ *
+ * Called from the millisecond tick. Each LED counts down its current step
+ * and moves to the next when it runs out. Software PWM LEDs at a partial
+ * duty are switched on at the start of each period and off once their
+ * share of it has passed; nothing else touches the hardware.
+ */
+void tickLed(void) {
+  unsigned phase = ++ledTicks % LED_SW_PERIOD;
+
+  for (unsigned i = 0; i < LED_COUNT; i++) {
+    LedProgram* prog = &ledPrograms[i];
+    if (prog->left && --prog->left == 0) {
+      prog->at   = (prog->at + 1) % prog->steps;
+      prog->left = prog->step[prog->at].millis;
+      setLevelLed((LedColor)i, prog->step[prog->at].duty);
+    }
+
+    unsigned duty = prog->level;
+    if (ledFtmChannel[i] >= 0 || duty == 0 || duty == 100)
+      continue;
+
+    if (phase == 0)
+      setLed((LedColor)i, LedOn);
+    else if (phase == (duty * LED_SW_PERIOD + 99) / 100)
+      setLed((LedColor)i, LedOff);
+  }
+}
+
+#define LED_CTL_MAP \
+  X(ProgDuty, 1, 1) \
+  X(ProgBlink, 2, 3) \
+  X(ProgSeq, 2, LED_MAX_STEPS + 1)
+
+#define X(k, lo, hi) [k] = { lo, hi },
+static const struct {
+  unsigned min;
+  unsigned max;
+} ledCtls[] = {
+LED_CTL_MAP
+};
+#undef X
+
+/*
+ * nextWordLed :: String -> Int -> String
+ *
+ * Skip to the word after 'cmd', setting 'len' to the length of that word.
+ */
+static char* nextWordLed(char* cmd, size_t* len) {
+  while (*cmd && *cmd != ' ' && *cmd != '\n')
+    cmd++;
+  while (*cmd == ' ')
+    cmd++;
+
+  char* end = cmd;
+  while (*end && *end != ' ' && *end != '\n')
+    end++;
+  *len = end - cmd;
+  return cmd;
+}
+
+/*
+ * matchWordLed :: String -> Int -> [String] -> Int -> Int
+ *
+ * Index of the word in 'names', -1 if it is not there.
+ */
+static int matchWordLed(const char* word, size_t len, const char* const* names, unsigned n) {
+  for (unsigned i = 0; i < n; i++) {
+    if (strlen(names[i]) == len && strncmp(word, names[i], len) == 0)
+      return i;
+  }
+  return -1;
+}
+
+/*
+ * ctlLed :: String -> Err
+ *
+ * Apply one ./ctl command. Returns -1 with errno EINVAL on a malformed one.
+ */
+static int ctlLed(char* cmd) {
+  size_t len;
+  char* word;
+  for (len = 0; cmd[len] && cmd[len] != ' ' && cmd[len] != '\n'; len++)
+    ;
+
+  int kind = matchWordLed(cmd, len, ledProgNames, COUNT_OF(ledProgNames));
+  word = nextWordLed(cmd, &len);
+  int which = matchWordLed(word, len, ledColorNames, COUNT_OF(ledColorNames));
+  if (kind == -1 || which == -1) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  long v[LED_MAX_STEPS + 1];
+  unsigned n = 0;
+  char* arg = word + len;
+  for (;;) {
+    while (*arg == ' ')
+      arg++;
+    if (*arg == '\0' || *arg == '\n')
+      break;
+
+    char* e;
+    long x = strtol(arg, &e, 0);
+    if (e == arg || x < 0 || n == COUNT_OF(v)) {
+      errno = EINVAL;
+      return -1;
+    }
+    v[n++] = x;
+    arg = e;
+  }
+
+  if (n < ledCtls[kind].min || n > ledCtls[kind].max) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  LedStep steps[LED_MAX_STEPS];
+  unsigned count;
+  switch (kind) {
+  case ProgDuty:
+    if (v[0] > 100)
+      break;
+    steps[0] = (LedStep){ .duty = v[0], .millis = 0 };
+    loadLedProgram(which, kind, steps, 1);
+    return 0;
+  case ProgBlink: {
+    long duty = n == 3 ? v[2] : 100;
+    if (v[0] > LED_MAX_MILLIS || v[1] == 0 || v[1] >= v[0] || duty > 100)
+      break;
+    steps[0] = (LedStep){ .duty = duty, .millis = v[1] };
+    steps[1] = (LedStep){ .duty = 0,    .millis = v[0] - v[1] };
+    loadLedProgram(which, kind, steps, 2);
+    return 0;
+  }
+  case ProgSeq:
+    if (v[0] == 0 || v[0] > LED_MAX_MILLIS)
+      break;
+    for (count = 0; count < n - 1; count++) {
+      if (v[count + 1] > 100)
+        break;
+      steps[count] = (LedStep){ .duty = v[count + 1], .millis = v[0] };
+    }
+    if (count < n - 1)
+      break;
+    loadLedProgram(which, kind, steps, count);
+    return 0;
+  default:
+    break;
+  }
+
+  errno = EINVAL;
+  return -1;
 }
 
+#ifdef PLATFORM_K70CW
+/*
+ * initLedPwm :: ()
+ *
+ * Run FTM2 as an edge aligned PWM at LED_PWM_HZ and hand it the orange
+ * and blue pins, both off.
+ */
+static void initLedPwm(void) {
+  SIM_SCGC3 |= SIM_SCGC3_FTM2_MASK;
+
+  FTM2_MODE  = FTM_MODE_WPDIS_MASK;
+  FTM2_SC    = 0;
+  FTM2_CNTIN = 0;
+  FTM2_CNT   = 0;
+  FTM2_MOD   = LED_FTM_MOD;
+  FTM2_C0SC  = FTM_CnSC_MSB_MASK | FTM_CnSC_ELSA_MASK; /* low true pulses */
+  FTM2_C1SC  = FTM_CnSC_MSB_MASK | FTM_CnSC_ELSA_MASK;
+  FTM2_C0V   = 0;
+  FTM2_C1V   = 0;
+  FTM2_SC    = FTM_SC_CLKS(1) | FTM_SC_PS(LED_FTM_PRESCALE);
+
+  BLUE_LED_PCR   = PORT_PCR_MUX(3);
+  ORANGE_LED_PCR = PORT_PCR_MUX(3);
+}
+#endif
+
+#define NAMESPACE_MAP \
+  X(".", STATICNS_SENTINEL, Dot, CRUMB_ISDIR, 0, 0555, 0) \
+  X("orange", FidDot, Orange, CRUMB_ISFILE, 0, 0644, 0) \
+  X("yellow", FidDot, Yellow, CRUMB_ISFILE, 0, 0644, 0) \
+  X("green", FidDot, Green, CRUMB_ISFILE, 0, 0644, 0) \
+  X("blue", FidDot, Blue, CRUMB_ISFILE, 0, 0644, 0) \
+  X("ctl", FidDot, Ctl, CRUMB_ISFILE, 0, 0644, 0) \
+  LED_WAVE_NAMESPACE
+
+#ifdef PLATFORM_NICE
+#define LED_WAVE_NAMESPACE X("wave", FidDot, Wave, CRUMB_ISFILE, 0, 0444, 0)
+#else
+#define LED_WAVE_NAMESPACE
+#endif
+
+#define X(p, u, s, t, z, m, c) Fid##s,
 typedef enum {
-  FidDot,
-  FidOrange,
-  FidYellow,
-  FidGreen,
-  FidBlue,
+NAMESPACE_MAP
 } LedFidEnt;
+#undef X
 
 /*
  * initLed :: ()
@@ -158,22 +524,21 @@ static void initLed(void) {
   for (unsigned i = 0; i < COUNT_OF(leds); i++) {
     setLed(leds[i], LedOff);
     makeGPIOOut(leds[i]);
+    ledPrograms[i].kind  = ProgDuty;
+    ledPrograms[i].steps = 1;
   }
+
+#ifdef PLATFORM_K70CW
+  initLedPwm();
+#endif
 }
 
+#define X(p, u, s, t, z, m, c) { p, MKSTATICNS_CRUMB(u, Fid##s, t), z, m, c },
 static StaticNS ledSNS[] = {
-    /* root */
-    { ".", MKSTATICNS_CRUMB(STATICNS_SENTINEL, 0, CRUMB_ISDIR), 0, 0555, 0 }
-
-    /* one level */
-,   { "orange", MKSTATICNS_CRUMB(0, FidOrange, CRUMB_ISFILE), 0, 0644, 0 }
-,   { "yellow", MKSTATICNS_CRUMB(0, FidYellow, CRUMB_ISFILE), 0, 0644, 0 }
-,   { "green",  MKSTATICNS_CRUMB(0, FidGreen, CRUMB_ISFILE),  0, 0644, 0 }
-,   { "blue",   MKSTATICNS_CRUMB(0, FidBlue, CRUMB_ISFILE),   0, 0644, 0 }
-
-    /* sentinel */
-,   { "", MKSTATICNS_SENTINEL_CRUMB, 0, 0, 0 }
+NAMESPACE_MAP
+    { "", MKSTATICNS_SENTINEL_CRUMB, 0, 0, 0 }
 };
+#undef X
 
 /*
  * attachLed :: String -> Portal
@@ -226,6 +591,98 @@ static int getInfoLed(const Portal *p, NodeInfo *ni) {
   return getNodeInfoStaticNS(p, ledSNS, WalkSelf, ni) == NULL ? -1 : 0;
 }
 
+/*
+ * readCtlLed :: Portal -> [Byte] -> Int -> Int -> Int
+ *
+ * The program of each LED in the form it is written to ./ctl.
+ */
+static ptrdiff_t readCtlLed(Portal *p, void *buf, size_t size, Offset offset) {
+  char text[256];
+  int len = 0;
+
+#define LED_FMT(...) do {                                                 \
+  ptrdiff_t n = fmtSnprintf(text + len, sizeof text - len, __VA_ARGS__);  \
+  if (n > 0) len += n;                                                    \
+} while (0)
+
+  for (unsigned i = 0; i < LED_COUNT; i++) {
+    LedProgram prog;
+    ATOMIC(prog = ledPrograms[i]);
+
+    LED_FMT("%s %s", ledColorNames[i], ledProgNames[prog.kind]);
+    switch (prog.kind) {
+    case ProgDuty:
+      LED_FMT(" %u", prog.step[0].duty);
+      break;
+    case ProgBlink:
+      LED_FMT(" %u %u %u", prog.step[0].millis + prog.step[1].millis, prog.step[0].millis, prog.step[0].duty);
+      break;
+    case ProgSeq:
+      LED_FMT(" %u", prog.step[0].millis);
+      for (unsigned j = 0; j < prog.steps; j++)
+        LED_FMT(" %u", prog.step[j].duty);
+      break;
+    }
+    LED_FMT("\n");
+  }
+
+#undef LED_FMT
+
+  if (offset >= (Offset)len)
+    return 0;
+
+  size_t bytes = len - offset;
+  if (bytes > size)
+    bytes = size;
+  memcpy(buf, text + offset, bytes);
+  p->offset += bytes;
+  return bytes;
+}
+
+#ifdef PLATFORM_NICE
+/*
+ * runningLed :: Bool
+ *
+ * Whether any LED has a program with more than one step.
+ */
+static int runningLed(void) {
+  for (unsigned i = 0; i < LED_COUNT; i++) {
+    if (ledPrograms[i].left)
+      return 1;
+  }
+  return 0;
+}
+
+/*
+ * readWaveLed :: [Byte] -> Int -> Int
+ *
+ * Copy out the oldest recorded levels as LedLevel records, first running
+ * the engine until there are as many as fit or LED_WAVE_HORIZON ticks pass.
+ */
+static ptrdiff_t readWaveLed(void *buf, size_t size) {
+  if (size < sizeof(LedLevel)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  unsigned want = size / sizeof(LedLevel);
+  if (want > LED_WAVE_SIZE)
+    want = LED_WAVE_SIZE;
+
+  for (unsigned t = 0; ledWave.count < want && t < LED_WAVE_HORIZON && runningLed(); t++)
+    tickLed();
+
+  LedLevel* out = buf;
+  unsigned n    = ledWave.count < want ? ledWave.count : want;
+  unsigned tail = (ledWave.head - ledWave.count) & (LED_WAVE_SIZE - 1);
+  for (unsigned i = 0; i < n; i++)
+    out[i] = ledWave.ring[(tail + i) & (LED_WAVE_SIZE - 1)];
+  ledWave.count -= n;
+
+  return n * sizeof(LedLevel);
+}
+#endif
+
 /*
  * readLed :: Portal -> [Byte] -> Int -> Int
  *
@@ -240,9 +697,16 @@ static ptrdiff_t readLed(Portal *p, void *buf, size_t size, Offset offset) {
     return readStaticNS(p, ledSNS, buf, size, offset);
   }
 
+  LedFidEnt fid = STATICNS_CRUMB_SELF_IDX(p->crumb);
+  if (fid == FidCtl)
+    return readCtlLed(p, buf, size, offset);
+#ifdef PLATFORM_NICE
+  if (fid == FidWave)
+    return readWaveLed(buf, size);
+#endif
+
   if (p->offset) return 0; /* eof */
 
-  LedFidEnt fid = STATICNS_CRUMB_SELF_IDX(p->crumb);
   switch (fid) {
   case FidOrange:
   case FidYellow:
@@ -264,7 +728,8 @@ static ptrdiff_t readLed(Portal *p, void *buf, size_t size, Offset offset) {
  *
  * A write to the control file of a led device sets its activity.
  * Like the read operation zero sized writes and non-zero offsets 
- * result in a non-write.
+ * result in a non-write. A '1' or '0' replaces any program with
+ * full on or off.
  */
 static ptrdiff_t writeLed(Portal *p, void *buf, size_t size, Offset offset) {
   UNUSED(offset);
@@ -272,20 +737,28 @@ static ptrdiff_t writeLed(Portal *p, void *buf, size_t size, Offset offset) {
     return 0;
   }
 
+  LedFidEnt fid = STATICNS_CRUMB_SELF_IDX(p->crumb);
+  if (fid == FidCtl) {
+    char cmd[96] = {0};
+    memcpy(cmd, buf, size < sizeof cmd - 1 ? size : sizeof cmd - 1);
+    if (ctlLed(cmd) == -1)
+      return -1;
+    return size;
+  }
+
   char c = *(char*)buf;
   if (!(c == '0' || c == '1')) {
     return 0;
   }
 
-  LedFidEnt fid = STATICNS_CRUMB_SELF_IDX(p->crumb);
   switch (fid) {
   case FidOrange:
   case FidYellow:
   case FidGreen:
   case FidBlue: {
     LedColor which = (LedColor)(fid - FidOrange);
-    LedState state = (LedState)(c - '0');
-    setLed(which, state);
+    LedStep step = { .duty = c == '1' ? 100 : 0, .millis = 0 };
+    loadLedProgram(which, ProgDuty, &step, 1);
     return 1;
   }
   default:
@@ -310,4 +783,5 @@ Dev devLed = {
 ,   .setInfo  = setInfoDev
 ,   .read     = readLed
 ,   .write    = writeLed
+,   .lazy     = 1
 };
@@ -0,0 +1,247 @@
+#include <errno.h>
+#include <manos.h>
+#include <manos/list.h>
+
+/*
+ * Devpipe - connected pairs of Portals.
+ *
+ * A pipe has no name, newPipe() hands back its two ends directly. Both
+ * share a bounded FifoQ; readers sleep while it is empty and writers
+ * while it is full. Each open end is counted, so a reader sees EOF once
+ * the last writer closes and a writer gets EPIPE once the last reader
+ * does. The Portal fid indexes the pipe table.
+ */
+
+typedef struct Pipe {
+    FifoQ*   q;
+    unsigned readers;
+    unsigned writers;
+    ListHead readQ;
+    ListHead writeQ;
+} Pipe;
+
+static Pipe* pipes[MANOS_MAXPIPE];
+
+#define CAN_READ(caps)  ((caps) == CAP_READ || (caps) == CAP_READWRITE)
+#define CAN_WRITE(caps) ((caps) == CAP_WRITE || (caps) == CAP_READWRITE)
+
+static Pipe* portalPipe(const Portal* p) {
+    if (p->crumb.fid >= MANOS_MAXPIPE)
+        return NULL;
+    return pipes[p->crumb.fid];
+}
+
+/**
+ * newPipe() - create a pipe
+ * @ends: set to the read end and the write end, both open
+ *
+ * Return: 0, or -1 with errno ENFILE when the pipe table is full or
+ * ENOMEM
+ */
+int newPipe(Portal* ends[2]) {
+    unsigned fid;
+
+    enterCriticalRegion();
+    for (fid = 0; fid < MANOS_MAXPIPE && pipes[fid]; fid++)
+        ;
+    if (fid == MANOS_MAXPIPE) {
+        leaveCriticalRegion();
+        errno = ENFILE;
+        return -1;
+    }
+    pipes[fid] = (Pipe*)-1; /* claimed */
+    leaveCriticalRegion();
+
+    Pipe* pipe = syskmalloc0(sizeof *pipe);
+    ends[0] = syskmalloc(sizeof(Portal));
+    ends[1] = syskmalloc(sizeof(Portal));
+    if (pipe)
+        pipe->q = newFifoQ(MANOS_PIPE_SIZE);
+
+    if (!pipe || !pipe->q || !ends[0] || !ends[1]) {
+        if (pipe && pipe->q) syskfree(pipe->q);
+        if (pipe)    syskfree(pipe);
+        if (ends[0]) syskfree(ends[0]);
+        if (ends[1]) syskfree(ends[1]);
+        ATOMIC(pipes[fid] = NULL);
+        errno = ENOMEM;
+        return -1;
+    }
+
+    INIT_LIST_HEAD(&pipe->readQ);
+    INIT_LIST_HEAD(&pipe->writeQ);
+    ATOMIC(pipes[fid] = pipe);
+
+    for (unsigned i = 0; i < 2; i++) {
+        mkPortal(ends[i], fromDeviceId(DEV_DEVPIPE));
+        ends[i]->crumb.flags = CRUMB_ISFILE;
+        ends[i]->crumb.fid   = fid;
+        deviceTable[ends[i]->device]->open(ends[i], i == 0 ? CAP_READ : CAP_WRITE);
+    }
+
+    return 0;
+}
+
+static Portal* attachPipe(char* path) {
+    UNUSED(path);
+    errno = ENODEV; /* pipes are only made by newPipe() */
+    return NULL;
+}
+
+static WalkTrail* walkPipe(Portal* p, char** path, unsigned n) {
+    UNUSED(p);
+    UNUSED(path);
+    UNUSED(n);
+    errno = ENOENT;
+    return NULL;
+}
+
+/* also used to take another reference on an end, as when a Proc inherits it */
+static Portal* openPipe(Portal* p, Caps caps) {
+    Pipe* pipe = portalPipe(p);
+    if (!pipe) {
+        errno = EBADF;
+        return NULL;
+    }
+
+    enterCriticalRegion();
+    if (CAN_READ(caps))
+        pipe->readers++;
+    if (CAN_WRITE(caps))
+        pipe->writers++;
+    leaveCriticalRegion();
+
+    return openDev(p, caps);
+}
+
+static void closePipe(Portal* p) {
+    Pipe* pipe = portalPipe(p);
+    if (!pipe || !(p->flags & PORTAL_ISOPEN))
+        return;
+
+    p->flags &= ~PORTAL_ISOPEN;
+
+    enterCriticalRegion();
+    if (CAN_READ(p->caps))
+        pipe->readers--;
+    if (CAN_WRITE(p->caps))
+        pipe->writers--;
+
+    /* readers see EOF, writers see EPIPE */
+    wakeUp(&pipe->readQ);
+    wakeUp(&pipe->writeQ);
+
+    int last = pipe->readers == 0 && pipe->writers == 0;
+    if (last)
+        pipes[p->crumb.fid] = NULL;
+    leaveCriticalRegion();
+
+    if (last) {
+        syskfree(pipe->q);
+        syskfree(pipe);
+    }
+}
+
+static int getInfoPipe(const Portal* p, NodeInfo* ni) {
+    Pipe* pipe = portalPipe(p);
+    if (!pipe) {
+        errno = EBADF;
+        return -1;
+    }
+
+    mkNodeInfo(p, p->crumb, "pipe", 0, 0600, ni);
+    return 0;
+}
+
+static ptrdiff_t readPipe(Portal* p, void* buf, size_t size, Offset offset) {
+    UNUSED(offset);
+    Pipe* pipe = portalPipe(p);
+    if (!pipe || !CAN_READ(p->caps)) {
+        errno = EBADF;
+        return -1;
+    }
+
+    if (size == 0)
+        return 0;
+
+    char* c = buf;
+    size_t bytes = 0;
+
+    enterCriticalRegion();
+    for (;;) {
+        while (bytes < size && dequeueFifoQ(pipe->q, c + bytes))
+            bytes++;
+
+        if (bytes) {
+            wakeUp(&pipe->writeQ);
+            leaveCriticalRegion();
+            return bytes;
+        }
+
+        if (pipe->writers == 0) {
+            leaveCriticalRegion();
+            return 0;
+        }
+
+        if (sleepOn(&pipe->readQ, 0) == -1) {
+            leaveCriticalRegion();
+            return -1;
+        }
+    }
+}
+
+static ptrdiff_t writePipe(Portal* p, void* buf, size_t size, Offset offset) {
+    UNUSED(offset);
+    Pipe* pipe = portalPipe(p);
+    if (!pipe || !CAN_WRITE(p->caps)) {
+        errno = EBADF;
+        return -1;
+    }
+
+    const char* c = buf;
+    size_t bytes = 0;
+
+    enterCriticalRegion();
+    while (bytes < size) {
+        if (pipe->readers == 0) {
+            leaveCriticalRegion();
+            errno = EPIPE;
+            return bytes ? (ptrdiff_t)bytes : -1;
+        }
+
+        size_t before = bytes;
+        while (bytes < size && enqueueFifoQ(pipe->q, c[bytes]))
+            bytes++;
+
+        if (bytes != before)
+            wakeUp(&pipe->readQ);
+
+        if (bytes < size && sleepOn(&pipe->writeQ, 0) == -1) {
+            leaveCriticalRegion();
+            return bytes ? (ptrdiff_t)bytes : -1;
+        }
+    }
+    leaveCriticalRegion();
+
+    return bytes;
+}
+
+Dev devPipe = {
+    .id       = DEV_DEVPIPE
+,   .name     = "pipe"
+,   .power    = powerDev
+,   .init     = initDev
+,   .reset    = resetDev
+,   .shutdown = shutdownDev
+,   .attach   = attachPipe
+,   .walk     = walkPipe
+,   .create   = createDev
+,   .open     = openPipe
+,   .close    = closePipe
+,   .remove   = removeDev
+,   .getInfo  = getInfoPipe
+,   .setInfo  = setInfoDev
+,   .read     = readPipe
+,   .write    = writePipe
+,   .release  = closePipe
+};
@@ -36,6 +36,7 @@
     X("ps",         FidBin,     BinPs,              CRUMB_ISFILE,   4,              0555,   "#!ps")         \
     X("fg",         FidBin,     BinFg,              CRUMB_ISFILE,   4,              0555,   "#!fg")         \
     X("fizzbuzz",   FidBin,     BinFizzbuzz,        CRUMB_ISFILE,   10,             0555,   "#!fizzbuzz")   \
+    X("env",        FidBin,     BinEnv,             CRUMB_ISFILE,   5,              0555,   "#!env")        \
     X("swpb",       FidDev,     DevSwpb,            CRUMB_ISMOUNT,  DEV_DEVSWPB,    0444,   0)              \
     X("led",        FidDev,     DevLed,             CRUMB_ISMOUNT,  DEV_DEVLED,     0444,   0)              \
     X("uart",       FidDev,     DevUart,            CRUMB_ISMOUNT,  DEV_DEVUART,    0444,   0)              \
@@ -43,8 +44,10 @@
     X("adc",        FidDev,     DevAdc,             CRUMB_ISMOUNT,  DEV_DEVADC,     0444,   0)              \
     X("timer",      FidDev,     DevTimer,           CRUMB_ISMOUNT,  DEV_DEVTIMER,   0444,   0)              \
     X("date",       FidDev,     DevDevDate,         CRUMB_ISMOUNT,  DEV_DEVDEV,     0644,   "date")         \
-    X("kprint",     FidDev,     DevDevKPrint,       CRUMB_ISMOUNT,  DEV_DEVDEV,     0222,   "kprint")       \
-    X("interrupts", FidDev,     DecDevInterrupts,   CRUMB_ISMOUNT,  DEV_DEVDEV,     0444,   "interrupts")
+    X("kprint",     FidDev,     DevDevKPrint,       CRUMB_ISMOUNT,  DEV_DEVDEV,     0644,   "kprint")       \
+    X("interrupts", FidDev,     DecDevInterrupts,   CRUMB_ISMOUNT,  DEV_DEVDEV,     0444,   "interrupts")   \
+    X("crash",      FidDev,     DevDevCrash,        CRUMB_ISMOUNT,  DEV_DEVDEV,     0644,   "crash")        \
+    X("boot",       FidDev,     DevDevBoot,         CRUMB_ISMOUNT,  DEV_DEVDEV,     0644,   "boot")
 
 #define X(p, u, s, t, z, m, c) Fid##s,
 typedef enum {
@@ -7,15 +7,23 @@
  * 
  * ./1
  * ./2
+ * ./events
  * 
- * Reading a byte from ./<n> returns the current button state of the sw button with some delay to allow for flap
+ * Reading a byte from ./<n> returns the debounced button state
  * Reading a bytes from ./<n>raw returns the actual state right from hardware
+ * Reading ./events blocks until a button changes, then returns SwpbEvent records
+ *
+ * Each button pin interrupts on either edge. The port handler masks the pin
+ * and starts a settle period; debounceSwpb(), run from the millisecond PDB
+ * tick, samples the pin once it has been quiet that long, queues an event if
+ * the state changed and unmasks the pin again. Nothing busy-waits.
  */
 
 #include <errno.h>
 #include <stdint.h>
 
 #include <manos.h>
+#include <manos/list.h>
 
 #if defined PLATFORM_NICE
 
@@ -26,6 +34,9 @@ static uint32_t __FAKE_REG = 0;
 #define PORT_PCR_MUX(x) 0
 #define PORT_PCR_PE_MASK 0
 #define PORT_PCR_PS_MASK 0
+#define PORT_PCR_IRQC(x) ((x) & 0)
+#define PORT_PCR_IRQC_MASK 0
+#define PORT_PCR_ISF_MASK 0
 #define SIM_SCGC5 __FAKE_REG
 #define SIM_SCGC5_PORTD_MASK 0
 #define SIM_SCGC5_PORTE_MASK 0
@@ -36,23 +47,6 @@ static uint32_t __FAKE_REG = 0;
 #include <arch/k70/derivative.h>
 #endif
 
-/* for now put this here */
-#if defined PLATFORM_K70CW
-void nanosleep(unsigned long int nanos);
-__asm(
-		"    .global nanosleep\n\t"
-		"nanosleep:\n\t"
-		"    adds r0,r0,#-1\n\t"
-		"    bne  nanosleep\n\t"
-		"    bx   lr"
-     );
-#else
-void nanosleep(unsigned long int nanos) {
-    while(nanos-->0)
-        ;
-    return;
-}
-#endif
 /*
  * Define names for the bits in the PDIR register. Which correspond to the selection bit for each switch.
  * The mapping comes from sheet #7 of the TWR-K70F120M schematic
@@ -67,6 +61,10 @@ void nanosleep(unsigned long int nanos) {
 #define BUTTON_ONE_PCR PORTD_PCR0
 #define BUTTON_TWO_PCR PORTE_PCR26
 
+#define SWPB_IRQC_EITHER_EDGE 0xb
+#define SWPB_DEBOUNCE_MILLIS  20
+#define SWPB_EVENTS           32 /* power of two */
+
 /*
  * Give the buttons nice names
  */
@@ -81,16 +79,50 @@ typedef enum {
  ButtonUp,
 } ButtonState;
 
+/**
+ * struct SwpbState - debounce and event state shared with the interrupts
+ * @stable:  last settled state of each button
+ * @settle:  msecs at which each button is sampled, 0 while it is idle
+ * @head:    next ring slot to fill
+ * @count:   events waiting in the ring
+ * @dropped: events overwritten unread
+ * @readers: Procs blocked reading ./events
+ * @ring:    the events
+ */
+typedef struct SwpbState {
+  ButtonState       stable[2];
+  volatile uint32_t settle[2];
+  unsigned          head;
+  volatile unsigned count;
+  uint32_t          dropped;
+  ListHead          readers;
+  SwpbEvent         ring[SWPB_EVENTS];
+} SwpbState;
+
+static SwpbState swpb;
+
+static volatile uint32_t* buttonPcr(Button which) {
+  volatile uint32_t * const pcr[] = { &BUTTON_ONE_PCR, &BUTTON_TWO_PCR };
+  return pcr[which];
+}
+
 /*
  * Sets the buttons ports to be GPIO and out flowing.
  */
 static void makeGPIOIn(Button which) {
   int gpio = 1;
-  volatile uint32_t * const buttonPcr[] = { &BUTTON_ONE_PCR, &BUTTON_TWO_PCR };
-  *(buttonPcr[which]) = PORT_PCR_MUX(gpio) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK; /* enable internal pull up/down resistor as pull up */
+  *buttonPcr(which) = PORT_PCR_MUX(gpio) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK; /* enable internal pull up/down resistor as pull up */
   USED(gpio);;
 }
 
+/*
+ * Clear any pending edge on the button pin and set whether it interrupts.
+ */
+static void armButton(Button which, int armed) {
+  volatile uint32_t* pcr = buttonPcr(which);
+  *pcr = (*pcr & ~PORT_PCR_IRQC_MASK) | PORT_PCR_ISF_MASK | PORT_PCR_IRQC(armed ? SWPB_IRQC_EITHER_EDGE : 0);
+}
+
 /*
  * Initialize the button clocks. And configure the buttons.
  */
@@ -104,6 +136,13 @@ static void initButtons(void) {
   }
 }
 
+#if defined PLATFORM_K70CW
+static void enableButtonIrqs(void) {
+  enableNvicIrq(NVIC_IRQ_PCM_PORTD, MANOS_ARCH_K70_SWPB_PRIORITY);
+  enableNvicIrq(NVIC_IRQ_PCM_PORTE, MANOS_ARCH_K70_SWPB_PRIORITY);
+}
+#endif
+
 /*
  * Returns the present button up/down state unbuffered.
  * The button logic is set low when the button is down.
@@ -115,16 +154,97 @@ static ButtonState getState(Button which) {
   return buttonState[!(*(buttonPdirReg[which]) & buttonBit[which])];
 }
 
+/*
+ * Append an event to the ring. A full ring overwrites its oldest event.
+ */
+static void putSwpbEvent(Button which, ButtonState state, uint32_t msecs) {
+  SwpbEvent* e = &swpb.ring[swpb.head];
+  e->msecs   = msecs;
+  e->button  = which + 1; /* named as the files are */
+  e->pressed = state == ButtonDown;
+  e->pad     = 0;
+  swpb.head = (swpb.head + 1) & (SWPB_EVENTS - 1);
+
+  if (swpb.count == SWPB_EVENTS)
+    swpb.dropped++;
+  else
+    swpb.count++;
+}
+
+/*
+ * An edge on a button pin: mask it and sample once it has settled.
+ */
+static void edgeSwpb(Button which) {
+  armButton(which, 0);
+  uint32_t settle = (uint32_t)systime + SWPB_DEBOUNCE_MILLIS;
+  swpb.settle[which] = settle ? settle : 1;
+}
+
+/**
+ * portdHandler() - PORTD pin interrupt, button one
+ */
+void portdHandler(void) {
+  edgeSwpb(Button1);
+}
+
+/**
+ * porteHandler() - PORTE pin interrupt, button two
+ */
+void porteHandler(void) {
+  edgeSwpb(Button2);
+}
+
+/**
+ * debounceSwpb() - advance the button debounce state machine
+ *
+ * Called from the millisecond tick. A button whose settle time has passed
+ * is re-armed, then sampled, so an edge after the sample starts another
+ * settle period rather than being lost. A changed state is queued as an
+ * event and wakes the readers of ./events.
+ */
+void debounceSwpb(void) {
+  uint32_t now = (uint32_t)systime;
+  int changed = 0;
+
+  for (unsigned i = 0; i < COUNT_OF(swpb.settle); i++) {
+    uint32_t settle = swpb.settle[i];
+    if (settle == 0 || (int32_t)(now - settle) < 0)
+      continue;
+
+    swpb.settle[i] = 0;
+    armButton((Button)i, 1);
+
+    ButtonState state = getState((Button)i);
+    if (state != swpb.stable[i]) {
+      swpb.stable[i] = state;
+      putSwpbEvent((Button)i, state, now);
+      changed = 1;
+    }
+  }
+
+  if (changed)
+    wakeUp(&swpb.readers);
+}
+
 typedef enum {
   FidDot = 0,
   FidOne,
   FidTwo,
   FidOneRaw,
-  FidTwoRaw
+  FidTwoRaw,
+  FidEvents
 } SwpbFidEnt;
 
 static void initSwpb(void) {
+  INIT_LIST_HEAD(&swpb.readers);
   initButtons();
+  swpb.stable[Button1] = getState(Button1);
+  swpb.stable[Button2] = getState(Button2);
+  armButton(Button1, 1);
+  armButton(Button2, 1);
+#if defined PLATFORM_K70CW
+  enableButtonIrqs();
+#endif
 }
 
 static StaticNS swpbSNS[] = {
@@ -136,6 +256,7 @@ static StaticNS swpbSNS[] = {
 ,   { "2",    MKSTATICNS_CRUMB(0, FidTwo,    CRUMB_ISFILE), 0, 0444, 0 }
 ,   { "1raw", MKSTATICNS_CRUMB(0, FidOneRaw, CRUMB_ISFILE), 0, 0444, 0 }
 ,   { "2raw", MKSTATICNS_CRUMB(0, FidTwoRaw, CRUMB_ISFILE), 0, 0444, 0 }
+,   { "events", MKSTATICNS_CRUMB(0, FidEvents, CRUMB_ISFILE), 0, 0444, 0 }
 
     /* sentinel */
 ,   { "", MKSTATICNS_SENTINEL_CRUMB, 0, 0, 0 }
@@ -167,6 +288,36 @@ static int getInfoSwpb(const Portal *p, NodeInfo* ni) {
   return getNodeInfoStaticNS(p, swpbSNS, WalkSelf, ni) == NULL ? -1 : 0;
 }
 
+/*
+ * Copy out as many whole events as fit in 'buf', sleeping until there is
+ * at least one.
+ */
+static ptrdiff_t readSwpbEvents(void *buf, size_t size) {
+  if (size < sizeof(SwpbEvent)) {
+    errno = EINVAL;
+    return -1;
+  }
+
+  enterCriticalRegion();
+  while (swpb.count == 0) {
+    if (sleepOn(&swpb.readers, 0) == -1) {
+      leaveCriticalRegion();
+      return -1;
+    }
+  }
+
+  SwpbEvent* out = buf;
+  unsigned want = size / sizeof(SwpbEvent);
+  unsigned n    = swpb.count < want ? swpb.count : want;
+  unsigned tail = (swpb.head - swpb.count) & (SWPB_EVENTS - 1);
+  for (unsigned i = 0; i < n; i++)
+    out[i] = swpb.ring[(tail + i) & (SWPB_EVENTS - 1)];
+  swpb.count -= n;
+  leaveCriticalRegion();
+
+  return n * sizeof(SwpbEvent);
+}
+
 static ptrdiff_t readSwpb(Portal *p, void *buf, size_t size, Offset offset) {
   if (size == 0) return 0;
   
@@ -178,10 +329,10 @@ static ptrdiff_t readSwpb(Portal *p, void *buf, size_t size, Offset offset) {
   switch(fid) {
   case FidOne:
   case FidTwo:
-    /* Non-raw read. Delay read slightly to let buttons settle. */
-	nanosleep(151); /* ~ 5us */
-	/* adjust fid to proceed to raw processing code path */
-	fid += FidTwo;
+    /* the settled state, kept up to date by debounceSwpb() */
+    *(char*)buf = '0' + swpb.stable[fid - FidOne];
+    p->offset++;
+    return 1;
   case FidOneRaw:
   case FidTwoRaw: {
 	/* get state returns a '1' when the button is up */
@@ -190,6 +341,8 @@ static ptrdiff_t readSwpb(Portal *p, void *buf, size_t size, Offset offset) {
     p->offset++;
     return 1;
   }
+  case FidEvents:
+    return readSwpbEvents(buf, size);
   default:
     errno = ENODEV;
     return -1;
@@ -222,4 +375,5 @@ Dev devSwpb = {
 ,   .setInfo  = setInfoDev
 ,   .read     = readSwpb
 ,   .write    = writeSwpb
+,   .lazy     = 1
 };
@@ -141,13 +141,8 @@ static ptrdiff_t writeTimer(Portal* p, void* buf, size_t size, Offset offset) {
     if (strcmp(timer->name, "k70PDB0") == 0) {
         char duration[21] = {0};
         memcpy(duration, buf, size > 20 ? 20 : size);
-        AlarmChain* alarm = syskmalloc0(sizeof *alarm);
-        enterCriticalRegion();
-        alarm->wakeTime = systime + atoi(duration);
-        alarm->pid = rp ? rp->pid : 0;
-        INIT_LIST_HEAD(&alarm->next);
-        listAddBefore(&alarm->next, &timer->alarms);
-        leaveCriticalRegion();
+        if (armAlarm(rp ? rp->pid : 0, atoi(duration)) == -1)
+            return -1;
         return (sizeof duration);
     }
     
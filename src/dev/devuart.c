@@ -162,42 +162,66 @@ static ptrdiff_t readUart(Portal* p, void* buf, size_t size, Offset offset) {
     }
 }
 
-static ptrdiff_t writeUart(Portal* p, void* buf, size_t size, Offset offset) {
-    UNUSED(offset);
-    if (size == 0) return 0;
+static void putsUart(Uart* uart, const char* s, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (uart->console && s[i] == '\n')
+            uart->hw->putc(uart, '\r');
+        uart->hw->putc(uart, s[i]);
+    }
+}
 
+static Uart* dataFileUart(Portal* p) {
     if (p->crumb.flags & CRUMB_ISDIR) {
         errno = EPERM;
-        return -1;
+        return NULL;
     }
 
     NodeInfo ni;
     if (getNodeInfoStaticNS(p, uartSNS, WalkSelf, &ni) == NULL) {
         errno = ENODEV;
-        return -1;
+        return NULL;
+    }
+
+    if ((UartFileType)ni.length != UartDataFile) {
+        errno = EINVAL;
+        return NULL;
     }
 
-    size_t bytes = 0;
     Uart* uart = (Uart*)ni.contents;
-    switch ((UartFileType)ni.length) {
-    case UartDataFile:
-        if (!uart->hw->putc) {
-            errno = EPERM;
-            return -1;
-        }
+    if (!uart->hw->putc) {
+        errno = EPERM;
+        return NULL;
+    }
 
-        while (bytes < size) {
-            char c = *((char*)buf + bytes);
-            if (uart->console && c == '\n')
-                uart->hw->putc(uart, '\r');
-            uart->hw->putc(uart, c);
-            bytes++;
-        }
-        return bytes;
-    default:
-        errno = EINVAL;
+    return uart;
+}
+
+static ptrdiff_t writeUart(Portal* p, void* buf, size_t size, Offset offset) {
+    UNUSED(offset);
+    if (size == 0) return 0;
+
+    Uart* uart = dataFileUart(p);
+    if (!uart)
         return -1;
+
+    putsUart(uart, buf, size);
+    return size;
+}
+
+/* one lookup for the whole span list instead of one per span */
+static ptrdiff_t writevUart(Portal* p, const IoVec* iov, unsigned n, Offset offset) {
+    UNUSED(offset);
+
+    Uart* uart = dataFileUart(p);
+    if (!uart)
+        return -1;
+
+    ptrdiff_t bytes = 0;
+    for (unsigned i = 0; i < n; i++) {
+        putsUart(uart, iov[i].base, iov[i].len);
+        bytes += iov[i].len;
     }
+    return bytes;
 }
 
 /* TODO: This is incorrect since length is overloaded! */
@@ -236,4 +260,5 @@ Dev devUart = {
 ,   .setInfo  = setInfoDev
 ,   .read     = readUart
 ,   .write    = writeUart
+,   .writev   = writevUart
 };
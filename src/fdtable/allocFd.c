@@ -0,0 +1,67 @@
+#include <errno.h>
+#include <manos.h>
+#include <string.h>
+
+#define FDTABLE_WORD_BITS 32
+#define FDTABLE_WORDS(n) ((n) / FDTABLE_WORD_BITS)
+
+/*
+ * Double the table, or create the first one. Portals and the in use
+ * bitmap share one allocation, the bitmap follows the Portal array.
+ */
+static int growFdTable(FdTable* t) {
+    unsigned size = t->size ? t->size * 2 : MANOS_MINFD;
+    if (size > MANOS_MAXFD) {
+        errno = EMFILE;
+        return -1;
+    }
+
+    Portal** portals = syskmalloc0(size * sizeof(Portal*) + FDTABLE_WORDS(size) * sizeof(uint32_t));
+    if (!portals) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    uint32_t* inUse = (uint32_t*)(portals + size);
+    if (t->portals) {
+        kmemcpy(portals, t->portals, t->size * sizeof(Portal*));
+        kmemcpy(inUse, t->inUse, FDTABLE_WORDS(t->size) * sizeof(uint32_t));
+        syskfree(t->portals);
+    }
+
+    t->portals = portals;
+    t->inUse   = inUse;
+    t->size    = size;
+    return 0;
+}
+
+/**
+ * allocFd() - install a Portal at the lowest free descriptor
+ * @t: descriptor table
+ * @p: Portal to install
+ *
+ * The bitmap is scanned a word at a time, so the search visits at most
+ * MANOS_MAXFD / 32 words no matter how many descriptors are open.
+ *
+ * Return: the descriptor, or -1 with errno EMFILE when the table is full
+ */
+int allocFd(FdTable* t, Portal* p) {
+    if (t->count == t->size && growFdTable(t) == -1)
+        return -1;
+
+    for (unsigned w = 0; w < FDTABLE_WORDS(t->size); w++) {
+        if (t->inUse[w] == 0xffffffff)
+            continue;
+
+        unsigned bit = __builtin_ctz(~t->inUse[w]);
+        int fd = (w * FDTABLE_WORD_BITS) + bit;
+        t->inUse[w] |= (1u << bit);
+        t->portals[fd] = p;
+        t->count++;
+        return fd;
+    }
+
+    ASSERT(0 && "allocFd() count and bitmap disagree");
+    errno = EMFILE;
+    return -1;
+}
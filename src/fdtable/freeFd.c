@@ -0,0 +1,21 @@
+#include <manos.h>
+
+/**
+ * freeFd() - release a descriptor
+ * @t:  descriptor table
+ * @fd: descriptor to release
+ *
+ * The Portal is handed back to the caller to close and free.
+ *
+ * Return: the Portal which was installed at @fd, or NULL
+ */
+Portal* freeFd(FdTable* t, int fd) {
+    Portal* p = lookupFd(t, fd);
+    if (!p)
+        return NULL;
+
+    t->portals[fd] = NULL;
+    t->inUse[fd / 32] &= ~(1u << (fd % 32));
+    t->count--;
+    return p;
+}
@@ -0,0 +1,15 @@
+#include <manos.h>
+
+/**
+ * lookupFd() - find the Portal behind a descriptor
+ * @t:  descriptor table
+ * @fd: descriptor
+ *
+ * Return: the Portal, or NULL if @fd is not open
+ */
+Portal* lookupFd(const FdTable* t, int fd) {
+    if (fd < 0 || (unsigned)fd >= t->size)
+        return NULL;
+
+    return t->portals[fd];
+}
@@ -0,0 +1,28 @@
+#include <manos.h>
+
+/**
+ * releaseFdTable() - free every open Portal in a descriptor table
+ * @t: descriptor table
+ *
+ * Only set bits in the bitmap are visited, and the walk stops once the
+ * last open descriptor is found, so a Proc with few open files is torn
+ * down quickly. The table storage is kept for the next user of the Proc.
+ * Devices which count their open Portals are told through Dev.release.
+ */
+void releaseFdTable(FdTable* t) {
+    for (unsigned w = 0; t->count > 0 && w < t->size / 32; w++) {
+        uint32_t bits = t->inUse[w];
+        while (bits) {
+            unsigned bit = __builtin_ctz(bits);
+            int fd = (w * 32) + bit;
+            Portal* p = t->portals[fd];
+            if (p->device < MANOS_MAXDEV && deviceTable[p->device]->release)
+                deviceTable[p->device]->release(p);
+            syskfree(p);
+            t->portals[fd] = NULL;
+            t->count--;
+            bits &= bits - 1;
+        }
+        t->inUse[w] = 0;
+    }
+}
@@ -3,7 +3,8 @@
 /**
  * downHeapQ() - maintain the heap invariant after removing a heap item
  * @q:           the heap
- * @lowIndex:    controls the recursive depth of the heaping
+ * @startIndex:  item to sift down
+ * @bottomIndex: last item in the heap
  *
  * Return:
  *  @q
@@ -22,7 +23,7 @@ HeapQ* downHeapQ(HeapQ* q, size_t startIndex, size_t bottomIndex) {
         else
             maxIndex = (q->buf[leftIndex] <= q->buf[rightIndex]) ? rightIndex : leftIndex;
 
-        if (q->buf[startIndex] <= q->buf[maxIndex]) {
+        if (q->buf[startIndex] < q->buf[maxIndex]) {
             uint32_t tmp = q->buf[startIndex];
             q->buf[startIndex] = q->buf[maxIndex];
             q->buf[maxIndex] = tmp;
@@ -70,7 +71,7 @@ int enqueueHeapQ(HeapQ* q, uint32_t x) {
 }
 
 /**
- * dequeueHeapQ() - dequeue lowest value from heap
+ * dequeueHeapQ() - dequeue highest value from heap
  * @q:              heap
  * @x:              pointer to hold value
  *
@@ -79,9 +80,14 @@ int enqueueHeapQ(HeapQ* q, uint32_t x) {
  *  0 - x is invalid, queue empty
  */
 int dequeueHeapQ(HeapQ* q, uint32_t* x) {
+    if (q->n == 0)
+        return 0;
+
     *x = q->buf[0];
     q->n--;
-    q->buf[0] = q->buf[q->n];
-    downHeapQ(q, 0, q->n - 1);
-    return (q->n > 0);
+    if (q->n > 0) {
+        q->buf[0] = q->buf[q->n];
+        downHeapQ(q, 0, q->n - 1);
+    }
+    return 1;
 }
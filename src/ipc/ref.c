@@ -1,6 +1,6 @@
 #include <manos.h>
 
-int getReg(Ref* ref) {
+int getRef(Ref* ref) {
     syslock(&ref->lock);
     int x = ref->count;
     sysunlock(&ref->lock);
@@ -4,6 +4,14 @@
  * Single threaded allocator. Stores free chunks in segregated lists.
  * Uses bitmap to protect memory space.
  * Coalesces only when needed for performance.
+ *
+ * Memory comes from one or more disjoint regions, each with its own
+ * bins and bitmap, so a chunk never spans two. Callers may hint which
+ * region to try first.
+ *
+ * Bulk regions are handed out in pages by a buddy allocator, see pages.c.
+ * Requests of a page or more take whole blocks of pages, smaller ones
+ * are chunks from arenas of pages, each arena a region of its own.
  */
 #include <errno.h>
 #include <inttypes.h>
@@ -12,6 +20,8 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "pages.h"
+
 /*
  * Define some constants for padding and aligning data.
  * Memory from malloc will be double-word aligned.
@@ -80,6 +90,15 @@ typedef struct ChunkBin {
  */
 #define MIN_ALLOC_BYTES (sizeof(ChunkHeader) + sizeof(ChunkTag))
 
+/*
+ * The bitmap keeps a bit for each BITMAP_GRAIN bytes of heap. Payloads
+ * are at least MIN_ALLOC_BYTES apart, so no two share a bit as long as
+ * the grain is no larger. On the K70 the two are equal.
+ */
+#define BITMAP_GRAIN 16
+#define assert_bitmap_grain(e) enum { assert_bg = sizeof(char[1 - 2*!(e)]) }
+assert_bitmap_grain(BITMAP_GRAIN <= MIN_ALLOC_BYTES);
+
 /*
  * Macros to access parts of the chunks.
  * A chunk Pred is the chunk immediately preceeding the current chunk in memory.
@@ -117,26 +136,16 @@ typedef struct ChunkBin {
 
 /*
  * Set up some needed values about the address space.
- * For the NICE platform these come from a local header.
- * For the K70, this will need to be configured by the assembler
- * most likely
+ * The regions come from a platform header, as HEAP_REGIONS.
  */
 #if defined PLATFORM_NICE
 #include "ram.h"
-static char *ram0 = NULL;           /* DWORD aligned start of system ram */
-static char *ramHighAddress = NULL; /* top of ram offset from ram0       */
 #elif defined PLATFORM_K70CW
 #include "ramk70.h"
-static char *ram0 = NULL;
-static char *ramHighAddress = NULL;
 #else
 #error "No Platform Support"
 #endif
 
-#ifndef ALLOCATION_BITMAP_SIZE
-#error Cannot compile without ALLOCATION_BITMAP_SIZE being defined
-#endif
-
 /*
  * SOme more macros setting up various sizes and boundaries in the allocator
  */
@@ -144,7 +153,11 @@ static char *ramHighAddress = NULL;
 #define MAX_BINS 128
 #define MAX_RANGE_BINS (MAX_BINS - 1)
 #define MAX_FAST_BIN 512
-#define MAX_RANGE_BIN (1<<26)         /* K70 will have at most 1<<27 addresses */
+#define MAX_FAST_HINT 256 /* MemAny requests up to this try the fast region first */
+#define LARGE_ALLOC_BYTES PAGE_BYTES /* requests this big take pages from a pool */
+#define ARENA_ORDER 4 /* arenas of 16 pages feed the bins of a pool */
+#define ARENA_BYTES (PAGE_BYTES << ARENA_ORDER)
+#define ARENA_SEARCH 4 /* arenas tried before another is made */
 
 /*
  * AllocHeader
@@ -160,25 +173,62 @@ static char *ramHighAddress = NULL;
 typedef struct AllocHeader {
   uint32_t lastAllocSize; /* track previous allocation to determine if we should preallocate */
   ChunkBin bins[MAX_BINS];
-  char bitmap[ALLOCATION_BITMAP_SIZE];
+  char bitmap[];          /* sized to the region by initRegion() */
 } AllocHeader;
 
 /*
- * Two values which are needed at runtime, and must be computed then.
- * 'heap' is the base of the heap.
- * 'numChunkOffsets' is the number of MIN_ALLOC_BYTES chunks the memory can 
+ * HeapRegion = (Ptr, Ptr, AllocHeader)
+ *
+ * One span of RAM. Its AllocHeader is at ram0, the heap follows the
+ * bitmap and runs to ramHighAddress.
+ * 'numChunkOffsets' is the number of BITMAP_GRAIN chunks the region can
  * provide. This is used by the bitmap to track allocations.
+ * 'maxRangeBin' is one more than the largest chunk, so the range bins
+ * divide up exactly the sizes the region can hold.
+ *
+ * A region with a 'pool' has no heap of its own. Its chunks come from
+ * arenas, regions sitting at the base of a block of its pages, with
+ * 'owner' pointing back to it. 'arenas' is kept most recently used first.
  */
-char *heap;
-size_t numChunkOffsets;
+typedef struct HeapRegion {
+  const char*        name;
+  MemHint            kind;
+  char*              ram0;
+  char*              ramHighAddress;
+  char*              heap;
+  AllocHeader*       header;          /* NULL if the region is too small to use */
+  size_t             bitmapSize;
+  size_t             numChunkOffsets;
+  uint32_t           maxRangeBin;
+  uint32_t           totalRAM;        /* ramHighAddress - heap */
+  uint32_t           inUse;
+  PagePool*          pool;
+  struct HeapRegion* owner;
+  ListHead           arenas;          /* of the pool */
+  ListHead           nextArena;       /* of the arena */
+} HeapRegion;
+
+#define X(k, n, start, end) { .name = n, .kind = k, .ram0 = (char*)(start), .ramHighAddress = (char*)(end) },
+static HeapRegion regions[] KERNEL_DATA = {
+  HEAP_REGIONS
+};
+#undef X
+
+static int regionsReady KERNEL_DATA = 0;
+
+uint32_t totalRAM KERNEL_DATA = 0; /* all regions */
+static uint32_t allocHWM KERNEL_DATA = 0; /* high water mark */
+static uint32_t allocCount KERNEL_DATA = 0; /* # allocations */
+static uint32_t freeCount KERNEL_DATA = 0; /* # frees */
+static uint32_t allocInUse KERNEL_DATA = 0; /* bytes allocated */
+static uint32_t allocFree KERNEL_DATA = 0; /* bytes released */
+static int32_t allocPM KERNEL_DATA = 0; /* +/- count */
 
-uint32_t totalRAM = 0; /* ramHighAddress - heap */
-static uint32_t allocHWM = 0; /* high water mark */
-static uint32_t allocCount = 0; /* # allocations */
-static uint32_t freeCount = 0; /* # frees */
-static uint32_t allocInUse = 0; /* bytes allocated */
-static uint32_t allocFree = 0; /* bytes released */
-static int32_t allocPM = 0; /* +/- count */
+/*
+ * The region being worked on. Set by each entry point before it touches
+ * any chunk, the macros below all refer to it.
+ */
+static HeapRegion* region KERNEL_DATA = NULL;
 
 /*
  * Macros to address into the bitmap.
@@ -187,18 +237,13 @@ static int32_t allocPM = 0; /* +/- count */
  * the bit to operate on.
  */
 /* #define getAddrBitmapOffset(addr) (size_t)(((numChunkOffsets * (uintptr_t)((char*)(addr) - heap)) / (uintptr_t)(totalRAM))) */
-#define getAddrBitmapOffset(addr) (size_t)(((uintptr_t)addr - (uintptr_t)heap) / MIN_ALLOC_BYTES)
+#define getAddrBitmapOffset(addr) (size_t)(((uintptr_t)addr - (uintptr_t)region->heap) / BITMAP_GRAIN)
 #define getAddrBit(addr) ((DWORD_BYTES - 1) - (getAddrBitmapOffset((addr)) & (DWORD_BYTES - 1)))
 #define getAddrByte(addr) (getAddrBitmapOffset((addr)) / DWORD_BYTES)
 
-#define setBitmap(addr) (header->bitmap[getAddrByte((addr))] |= (1 << getAddrBit((addr))))
-#define clearBitmap(addr) (header->bitmap[getAddrByte((addr))] &= ~(1 << getAddrBit((addr))))
-#define checkBitmap(addr) (header->bitmap[getAddrByte((addr))] & (1 << getAddrBit((addr))))
-
-/*
- * the header is a global value in the allocator
- */
-static AllocHeader* header = NULL;
+#define setBitmap(addr) (region->header->bitmap[getAddrByte((addr))] |= (1 << getAddrBit((addr))))
+#define clearBitmap(addr) (region->header->bitmap[getAddrByte((addr))] &= ~(1 << getAddrBit((addr))))
+#define checkBitmap(addr) (region->header->bitmap[getAddrByte((addr))] & (1 << getAddrBit((addr))))
 
 /*
  * Macros for addressing into the bins.
@@ -206,15 +251,15 @@ static AllocHeader* header = NULL;
  * Range bins can actually address fast bins, and subdivide then
  * entire chunk space.
  */
-#define RECENT_CHUNK_BIN (header->bins[0].dirty)
-#define REMAINDER_CHUNK_BIN (header->bins[0].clean)
+#define RECENT_CHUNK_BIN (region->header->bins[0].dirty)
+#define REMAINDER_CHUNK_BIN (region->header->bins[0].clean)
 #define isFastBinSize(sz) (((sz) < MAX_FAST_BIN) && !((sz) & (DWORD_BYTES -1)))
-#define isRangeBinSize(sz) ((sz) >= MAX_FAST_BIN && (sz) < MAX_RANGE_BIN)
-#define isTopBinSize(sz) ((sz) >= MAX_RANGE_BIN)
+#define isRangeBinSize(sz) ((sz) >= MAX_FAST_BIN && (sz) < region->maxRangeBin)
+#define isTopBinSize(sz) ((sz) >= region->maxRangeBin)
 #define fastBinIndex(sz) (((sz) - MIN_ALLOC_BYTES) / DWORD_BYTES)
-#define rangeBinIndex(sz) ((((MAX_RANGE_BINS - 1)*((sz) - MIN_ALLOC_BYTES)) / (MAX_RANGE_BIN - MIN_ALLOC_BYTES)))
+#define rangeBinIndex(sz) ((size_t)(((uint64_t)(MAX_RANGE_BINS - 1)*((sz) - MIN_ALLOC_BYTES)) / (region->maxRangeBin - MIN_ALLOC_BYTES)))
 #define getBinIndex(sz) (1 + (isFastBinSize((sz)) ? fastBinIndex((sz)) : rangeBinIndex((sz))))
-#define getBinByIndex(idx) (header->bins[(idx)])
+#define getBinByIndex(idx) (region->header->bins[(idx)])
 #define getBin(sz) (getBinByIndex(getBinIndex((sz))))
 
 /*
@@ -226,7 +271,7 @@ ChunkHeader* initChunk(void* mem, size_t size) {
   ASSERT(IS_WORD_ALIGNED(mem) && "Attempt to initialize chunk which does not align to WORD bound");
   ASSERT(IS_WORD_ALIGNED(size) && "Attempt to initialize chunk whose size will misalign successive chunks");
   ASSERT((size >= MIN_ALLOC_BYTES) && "Attempt to initialize chunk of diminutive size");
-  ASSERT(!((char*)mem + size > ramHighAddress) && "Attempt to initialize chunk larger than RAM");
+  ASSERT(!((char*)mem + size > region->ramHighAddress) && "Attempt to initialize chunk larger than RAM");
   ChunkHeader *chunk = (ChunkHeader*)mem;
   zeroTag(chunk);
   writeSize(getTag(chunk), size);
@@ -375,8 +420,8 @@ static void assertChunk(ChunkHeader* chunk) {
     assertChunkPredAddr = pred;
     assertChunkSuccAddr = succ;
 
-    int firstChunk = ((void*)heap == (void*)chunk);
-    int lastChunk  = (((char*)chunk + getSize(chunk)) == ramHighAddress);
+    int firstChunk = ((void*)region->heap == (void*)chunk);
+    int lastChunk  = (((char*)chunk + getSize(chunk)) == region->ramHighAddress);
 
     if (firstChunk)
         sysprintln("validateChunk() first chunk 0x%08" PRIx32 "", (intptr_t)chunk);
@@ -420,51 +465,168 @@ static void assertChunk(ChunkHeader* chunk) {
 }
 
 /*
- * initRam :: ()
+ * initRegion :: HeapRegion -> ()
+ *
+ * Lays out a region: the header at its DWORD aligned base, then a bitmap
+ * with a bit for every BITMAP_GRAIN bytes of heap, then the heap as one
+ * clean chunk. The bitmap size is solved from the region size:
  *
- * On platforms where the starting address of allocatable memory
- * is not able to be aligned on a double word boundary the base
- * of the ram must be adjusted at runtime.
+ * Let M be the bytes after the fixed part of the header.
+ * Let k be BITMAP_GRAIN.
+ * Let a byte hold 8 bits.
+ * The bitmap takes b bytes and covers the other M - b, so
+ * M - b <= 8kb, b = ceil(M / (8k + 1)), rounded up to DWORD_BYTES.
+ *
+ * A zeroed tag just before the heap and just after it reads as an
+ * allocated neighbour, so the first and last chunks never look past
+ * their region. A region too small for a chunk is left unused.
  */
-static void initRam(void) {
-  if (ram0 == NULL) {
-    ram0 = (char*)SDRAM_START;
-    ramHighAddress = (char*)SDRAM_END;
+static void initRegion(HeapRegion* r) {
+  char* end = (char*)((uintptr_t)r->ramHighAddress & ~(uintptr_t)(DWORD_BYTES - 1));
 
-    /* Zero out the header RAM */
-    kmemset(ram0, 0, sizeof *header);
-    
-    /* Overlay the header at the base of ram */
-    header = (struct AllocHeader*)ram0;
+  r->ram0 = DWORD_ALIGN_PTR(r->ram0);
+  r->header = NULL;
+  if (end <= r->ram0 || (size_t)(end - r->ram0) < sizeof(AllocHeader) + 4 * MIN_ALLOC_BYTES)
+    return;
 
-    /* invalidate bins */
-    for (unsigned i = 0; i < MAX_BINS; i++) {
-        header->bins[i].dirty = BAD_PTR;
-        header->bins[i].clean = BAD_PTR;
-    }
+  size_t m = (size_t)(end - r->ram0) - sizeof(AllocHeader);
+  r->bitmapSize = DWORD_PAD((m + 8 * BITMAP_GRAIN) / (8 * BITMAP_GRAIN + 1));
 
-    /* align things for the heap. Since a chunk has a WORD sized tag at boths ends
-     * and our allocator is required to return pointers which align on DOUBLE WORD
-     * boundaries we need to push the start of the heap to a WORD aligned address
-     * so that the first chunk user data will be on a DOUBLE WORD address.
-     */
-    heap = ram0 + WORD_PAD(sizeof(struct AllocHeader));
-    
-    totalRAM = (uint32_t)(ramHighAddress - heap);
-    
-    /* invalidate the heap */
-    kmemset(heap, 0xfa, totalRAM);
-    numChunkOffsets = totalRAM / MIN_ALLOC_BYTES;
+  /* align things for the heap. Since a chunk has a WORD sized tag at boths ends
+   * and our allocator is required to return pointers which align on DOUBLE WORD
+   * boundaries we need to push the start of the heap to a WORD aligned address
+   * so that the first chunk user data will be on a DOUBLE WORD address.
+   */
+  r->heap = DWORD_ALIGN_PTR(r->ram0 + sizeof(AllocHeader) + r->bitmapSize) + WORD_BYTES;
+  if (r->heap + MIN_ALLOC_BYTES + WORD_BYTES > end)
+    return;
 
-    ChunkHeader* firstChunk = initChunk(heap, totalRAM);
-    getBinByIndex(MAX_BINS - 1).clean = firstChunk;
-    firstChunk->prev = &getBinByIndex(MAX_BINS - 1).clean;
-    
-    allocFree = getSize(firstChunk);
+  r->totalRAM = (uint32_t)((end - WORD_BYTES - r->heap) & ~(DWORD_BYTES - 1));
+  r->ramHighAddress = r->heap + r->totalRAM;
+  r->numChunkOffsets = r->totalRAM / BITMAP_GRAIN;
+  r->maxRangeBin = r->totalRAM + 1;
+  r->inUse = 0;
+
+  /* Zero out the header RAM, and overlay the header at the base of the region */
+  kmemset(r->ram0, 0, sizeof(AllocHeader) + r->bitmapSize);
+  r->header = (AllocHeader*)r->ram0;
+
+  /* invalidate bins */
+  for (unsigned i = 0; i < MAX_BINS; i++) {
+      r->header->bins[i].dirty = BAD_PTR;
+      r->header->bins[i].clean = BAD_PTR;
+  }
+
+  kmemset(r->heap - WORD_BYTES, 0, WORD_BYTES);
+  kmemset(r->ramHighAddress, 0, WORD_BYTES);
+
+  /* invalidate the heap */
+  kmemset(r->heap, 0xfa, r->totalRAM);
+
+  region = r;
+  ChunkHeader* firstChunk = initChunk(r->heap, r->totalRAM);
+  getBinByIndex(MAX_BINS - 1).clean = firstChunk;
+  firstChunk->prev = &getBinByIndex(MAX_BINS - 1).clean;
+}
+
+/*
+ * initPool :: HeapRegion -> ()
+ *
+ * Lays a page pool over a bulk region. Arenas are made as they are
+ * needed, so nothing is written to the pages here.
+ */
+static void initPool(HeapRegion* r) {
+  r->header = NULL;
+  r->pool = initPagePool(r->ram0, r->ramHighAddress);
+  INIT_LIST_HEAD(&r->arenas);
+  if (r->pool) {
+    r->heap = r->pool->base;
+    r->totalRAM = r->pool->npages * PAGE_BYTES;
+    r->ramHighAddress = r->heap + r->totalRAM;
+    r->inUse = 0;
+  }
+}
+
+/*
+ * initRam :: ()
+ *
+ * Lays out every region the first time the allocator is used.
+ */
+static void initRam(void) {
+  if (!regionsReady) {
+    for (unsigned i = 0; i < COUNT_OF(regions); i++) {
+      HeapRegion* r = &regions[i];
+      if (r->kind == MemBulk)
+        initPool(r);
+      else
+        initRegion(r);
+      if (r->header || r->pool) {
+        allocFree += r->totalRAM;
+        totalRAM += r->totalRAM;
+      }
+    }
+    regionsReady = 1;
   }
   return;
 }
 
+/*
+ * newArena :: HeapRegion -> Maybe HeapRegion
+ *
+ * Takes a block of ARENA_BYTES from the pool of 'owner' and makes it a
+ * region, at the front of the arenas of 'owner'.
+ */
+static HeapRegion* newArena(HeapRegion* owner) {
+  HeapRegion* a = allocPages(owner->pool, ARENA_ORDER, PAGE_ARENA);
+  if (!a)
+    return NULL;
+
+  kmemset(a, 0, sizeof *a);
+  a->name = owner->name;
+  a->kind = owner->kind;
+  a->ram0 = (char*)(a + 1);
+  a->ramHighAddress = (char*)a + ARENA_BYTES;
+  a->owner = owner;
+  initRegion(a);
+  ASSERT(a->header && "newArena() arena too small for a heap");
+  listAddAfter(&a->nextArena, &owner->arenas);
+  return a;
+}
+
+/*
+ * freeArena :: HeapRegion -> ()
+ *
+ * Gives an arena with nothing allocated back to the pool of its owner.
+ */
+static void freeArena(HeapRegion* a) {
+  ASSERT(a->inUse == 0 && "freeArena() arena still in use");
+  listUnlink(&a->nextArena);
+  freePages(a->owner->pool, a);
+}
+
+/*
+ * findRegion :: Ptr -> Maybe HeapRegion
+ *
+ * The region whose heap holds 'ptr', or NULL. Inside a pool this is the
+ * arena 'ptr' is in, else the pool region itself for a block of pages.
+ * An arena is a block of order ARENA_ORDER, so its first page is found
+ * by rounding the page index down.
+ */
+static HeapRegion* findRegion(void* ptr) {
+  for (unsigned i = 0; i < COUNT_OF(regions); i++) {
+    HeapRegion* r = &regions[i];
+    if (!(r->header || r->pool) || (char*)ptr < r->heap || (char*)ptr >= r->ramHighAddress)
+      continue;
+    if (r->pool) {
+      char* base = r->heap + (((char*)ptr - r->heap) & ~(uintptr_t)(ARENA_BYTES - 1));
+      if (pageDesc(r->pool, base) == (PAGE_ARENA | ARENA_ORDER))
+        return (HeapRegion*)base;
+    }
+    return r;
+  }
+  return NULL;
+}
+
 /*
  * unlinkChunk :: [ChunkHeader] -> [ChunkHeader]
  *
@@ -703,7 +865,7 @@ split:
 
 
   size_t sizeRest = getSize(rest);
-  if (header->lastAllocSize == size) {
+  if (region->header->lastAllocSize == size) {
     for (int i = 0; i < MAX_PRE_ALLOCATIONS && sizeRest > size && (sizeRest - size) >= MIN_ALLOC_BYTES; i++) {
       ChunkHeader* pre = splitChunk(rest, size, &rest);
       binChunk(pre, BinRecent);
@@ -718,7 +880,65 @@ exit:
   return chunk;
 }
 
-static void* __kmalloc(size_t size, int pid) {
+/*
+ * allocateInArenas :: HeapRegion -> Integer -> ChunkHeader
+ *
+ * Tries the most recently used arenas of a pool, then a new one,
+ * leaving 'region' at the arena the chunk came from.
+ */
+static ChunkHeader* allocateInArenas(HeapRegion* owner, size_t size) {
+  HeapRegion* a;
+  unsigned tried = 0;
+
+  LIST_FOR_EACH_ENTRY(a, &owner->arenas, nextArena) {
+    if (tried++ == ARENA_SEARCH)
+      break;
+    region = a;
+    ChunkHeader* chunk = allocateChunk(size);
+    if (chunk != BAD_PTR) {
+      listUnlink(&a->nextArena);
+      listAddAfter(&a->nextArena, &owner->arenas);
+      return chunk;
+    }
+  }
+
+  if (size > ARENA_BYTES / 2 || !(region = newArena(owner)))
+    return BAD_PTR;
+  return allocateChunk(size);
+}
+
+/*
+ * allocateInRegions :: Integer -> Integer -> MemHint -> Ptr -> ChunkHeader
+ *
+ * Tries the regions of the hinted kind, then the others, leaving
+ * 'region' at the one the chunk came from. A pool gives 'bytes' of
+ * LARGE_ALLOC_BYTES or more whole pages, returned through 'large'.
+ */
+static ChunkHeader* allocateInRegions(size_t bytes, size_t size, MemHint hint, void** large) {
+  for (int pass = 0; pass < 2; pass++) {
+    for (unsigned i = 0; i < COUNT_OF(regions); i++) {
+      HeapRegion* r = &regions[i];
+      if (!(r->header || r->pool) || (r->kind == hint) != (pass == 0))
+        continue;
+
+      ChunkHeader* chunk = BAD_PTR;
+      region = r;
+      if (r->pool && bytes >= LARGE_ALLOC_BYTES) {
+        if ((*large = allocPages(r->pool, pagesOrder(bytes), PAGE_LARGE)))
+          return BAD_PTR;
+      } else if (r->pool) {
+        chunk = allocateInArenas(r, size);
+      } else {
+        chunk = allocateChunk(size);
+      }
+      if (chunk != BAD_PTR)
+        return chunk;
+    }
+  }
+  return BAD_PTR;
+}
+
+static void* __kmalloc(size_t size, int pid, MemHint hint) {
   void* mem = NULL;
   size_t newSize = size + (2 * sizeof(ChunkTag));
 
@@ -728,12 +948,28 @@ static void* __kmalloc(size_t size, int pid) {
     newSize += (MIN_ALLOC_BYTES - newSize);
   }
 
-  ChunkHeader* chunk = allocateChunk(DWORD_PAD(newSize));
+  if (hint == MemAny)
+    hint = size <= MAX_FAST_HINT ? MemFast : MemBulk;
+
+  void* large = NULL;
+  ChunkHeader* chunk = allocateInRegions(size, DWORD_PAD(newSize), hint, &large);
 
-  if (chunk != BAD_PTR) {
+  if (large) {
+    uint32_t bytes = (uint32_t)PAGE_BYTES << pagesOrder(size);
+    mem = large;
+    allocInUse += bytes;
+    region->inUse += bytes;
+    allocFree -= bytes;
+    allocPM++;
+    allocCount++;
+    if (allocInUse > allocHWM)
+      allocHWM = allocInUse;
+
+    kmemset(mem, 0, size);
+  } else if (chunk != BAD_PTR) {
     mem = getPayload(chunk);
 
-    header->lastAllocSize = getSize(chunk);
+    region->header->lastAllocSize = getSize(chunk);
 
     /* store the PID of the caller in the previously reserved byte just before the footer */
     getTag(chunk).pid = pid;
@@ -747,13 +983,16 @@ static void* __kmalloc(size_t size, int pid) {
     ASSERT(!checkBitmap(mem) && "Memory error. Cannot allocate adress already allocated.");
     
     /* DEBUG: Validate each 16k stride */
-    for (char* iter = mem; iter < ((char*)mem + size); iter += MIN_ALLOC_BYTES) {
+    for (char* iter = mem; iter < ((char*)mem + size); iter += BITMAP_GRAIN) {
         ASSERT(!checkBitmap(iter) && "CORRUPT REGION DETECTED! DOUBLE ALLOCATION ERROR");
     }
 
     setBitmap(mem);
     
     allocInUse += getSize(chunk);
+    region->inUse += getSize(chunk);
+    if (region->owner)
+      region->owner->inUse += getSize(chunk);
     allocFree -= getSize(chunk);
     allocPM++;
     allocCount++;
@@ -768,29 +1007,35 @@ static void* __kmalloc(size_t size, int pid) {
 }
 
 /*
- * kmalloc :: Integer -> Ptr
+ * syskmalloc :: Integer -> Ptr
  *
  * allocate chunk of at least 'size' size.
  * Returned pointer will be double word aligned.
  * If size is 0, a chunk of MIN_ALLOC_BYTES is returned.
+ * User mode allocates through kmalloc(), the syscall in front of this.
  */
-void* kmalloc(size_t size) {
+void* syskmalloc(size_t size) {
     enterCriticalRegion();
-    void* mem = __kmalloc(size, getpid());
+    void* mem = __kmalloc(size, getpid(), MemAny);
     leaveCriticalRegion();
     return mem;
 }
 
-void* syskmalloc(size_t size) {
+void* syskmalloc0(size_t size) {
     enterCriticalRegion();
-    void* mem = __kmalloc(size, getpid());
+    void* mem = __kmalloc(size, 0, MemAny);
     leaveCriticalRegion();
     return mem;
 }
 
-void* syskmalloc0(size_t size) {
+/*
+ * syskmallocHint :: Integer -> MemHint -> Ptr
+ *
+ * like syskmalloc0, but trying the region 'hint' names first.
+ */
+void* syskmallocHint(size_t size, MemHint hint) {
     enterCriticalRegion();
-    void* mem = __kmalloc(size, 0);
+    void* mem = __kmalloc(size, 0, hint);
     leaveCriticalRegion();
     return mem;
 }
@@ -806,22 +1051,43 @@ void __kfree(void* ptr) {
    */
   int isAligned = !((uintptr_t)ptr & (DWORD_BYTES - 1)); /* check the low bits are zero */
   if (isAligned) {
+    /*
+     * Safetey check #3: We only allocate addresses between the heap and ramHighAddress
+     * of a region
+     */
+    region = findRegion(ptr);
+    ASSERT(region && "Memory error. Address out of allocator zone");
+    if (!region)
+      return;
+
+    if (region->pool) {
+      ASSERT((pageDesc(region->pool, ptr) & PAGE_LARGE) && "Memory error. Cannot free pages not allocated by malloc");
+      if (pageDesc(region->pool, ptr) & PAGE_LARGE) {
+        uint32_t bytes = freePages(region->pool, ptr);
+        allocInUse -= bytes;
+        region->inUse -= bytes;
+        allocFree += bytes;
+        freeCount++;
+        allocPM--;
+      }
+      return;
+    }
+
     /*
      * Safetey check #2: A valid pointer from malloc will have its address recorded in
      * the bitmap. This is the address that is given to the malloc caller.
      */
     ASSERT(checkBitmap(ptr) && "Memory error. Cannot free address not allocated by malloc");
-   
-    /*
-     * Safetey check #3: We only allocate addresses between heap and ramHighAddress
-     */
-    ASSERT(((char*)ptr >= heap) && ((char*)ptr <= ramHighAddress) && "Memory error. Address out of allocator zone");
+
     if (checkBitmap(ptr)) {
       ChunkHeader* chunk = (ChunkHeader*)((uintptr_t)ptr - sizeof(ChunkTag));
       assertChunk(chunk);
 
       size_t chunkSize = getSize(chunk);
       allocInUse -= chunkSize;
+      region->inUse -= chunkSize;
+      if (region->owner)
+        region->owner->inUse -= chunkSize;
       allocFree += chunkSize;
       freeCount++;
       allocPM--;
@@ -835,25 +1101,25 @@ void __kfree(void* ptr) {
       enterCriticalRegion();
       binChunk(chunk, BinRecent);
       leaveCriticalRegion();
+
+      /* an arena freed up goes to the front, or back to its pool when
+       * empty and there are others to allocate from */
+      if (region->owner) {
+        HeapRegion* owner = region->owner;
+        listUnlink(&region->nextArena);
+        listAddAfter(&region->nextArena, &owner->arenas);
+        if (region->inUse == 0 && region->nextArena.next != &owner->arenas)
+          freeArena(region);
+      }
     }
   }
 }
 
-/*
- * kfree :: Ptr -> ()
- *
- * free allocated chunk. If ptr is NULL or not from malloc, this is a noop.
- */
-void kfree(void* ptr) {
-    enterCriticalRegion();
-    __kfree(ptr);
-    leaveCriticalRegion();
-}
-
 /**
  * syskfree :: Pre -> ()
  *
- * like kfree, but callable from handler
+ * free allocated chunk. If ptr is NULL or not from malloc, this is a noop.
+ * User mode frees through kfree(), the syscall in front of this.
  */
 void syskfree(void* ptr) {
     enterCriticalRegion();
@@ -878,7 +1144,7 @@ static void hexdump(void* buf, size_t length) {
         fprintln(rp->tty, "  %s", ascii);
       }
 
-      fprint(rp->tty, " %.8" PRIxPTR " ", (uintptr_t)heap + i);
+      fprint(rp->tty, " %.8" PRIxPTR " ", (uintptr_t)region->heap + i);
     }
 
     fprint(rp->tty, " %.2x", (uint8_t)p[i]);
@@ -944,49 +1210,104 @@ void dumpChunk(ChunkHeader* chunk, int doHexdump) {
 }
 
 /*
- * kmallocDump :: FILE* -> ()
+ * kmallocStats :: KmallocStats* -> ()
  *
- * Dumps the current state of the allocator and its data structures to 'out'
+ * Summarise the allocator into 'stats'. Reads only counters, so it is
+ * safe from a fault handler.
  */
-void kmallocDump(void) {
-  initRam(); /* incase we haven't initialized the memory already */
+void kmallocStats(KmallocStats *stats) {
+  stats->total  = totalRAM;
+  stats->inUse  = allocInUse;
+  stats->hwm    = allocHWM;
+  stats->allocs = allocCount;
+  stats->frees  = freeCount;
+}
 
-  fputstr(rp->tty, "**** YAMalloc Memory Dump ****\n\n");
-  fputstr(rp->tty, "General Info:\n\n");
-  fprintln(rp->tty, "    Addr ram0:    0x%08" PRIxPTR "", (uintptr_t)ram0);
-  fprintln(rp->tty, "    Addr ramHigh: 0x%08" PRIxPTR "", (uintptr_t)ramHighAddress);
-  fprintln(rp->tty, "    Min. Allocation size (B): %d", MIN_ALLOC_BYTES);
+/*
+ * kmallocRegionStats :: Integer -> KmallocStats* -> Maybe CStr
+ *
+ * Summarise region 'idx' into 'stats'. Counts of allocations and the
+ * high water mark are kept for the whole allocator only, and are left 0.
+ * Returns the region name, or NULL past the last region.
+ */
+const char* kmallocRegionStats(unsigned idx, KmallocStats *stats) {
+  if (idx >= COUNT_OF(regions))
+    return NULL;
+
+  initRam();
+  kmemset(stats, 0, sizeof *stats);
+  stats->total = regions[idx].totalRAM;
+  stats->inUse = regions[idx].inUse;
+  return regions[idx].name;
+}
+
+/*
+ * kmallocRegionMeta :: Integer -> Ptr -> Ptr -> Integer
+ *
+ * The bytes [*start, *end) at the base of region 'idx' that only the
+ * allocator writes: its AllocHeader and bitmap, or the PagePool and page
+ * descriptors of a pool. Empty for a region too small to use. Chunk tags,
+ * arenas and the free lists of a pool live among the allocations and are
+ * not part of it. Returns 0, or -1 past the last region.
+ */
+int kmallocRegionMeta(unsigned idx, uintptr_t* start, uintptr_t* end) {
+  if (idx >= COUNT_OF(regions))
+    return -1;
+
+  initRam();
+  HeapRegion* r = &regions[idx];
+  *start = (uintptr_t)r->ram0;
+  if (r->header)
+    *end = (uintptr_t)(r->heap - WORD_BYTES); /* the first chunk tag is below the heap */
+  else if (r->pool)
+    *end = (uintptr_t)r->pool->base;
+  else
+    *end = *start;
+  return 0;
+}
+
+/*
+ * dumpRegion :: HeapRegion -> ()
+ *
+ * Dumps a region and its data structures. The parameter shadows the
+ * region being worked on, so a dump from user mode writes no allocator
+ * state and the macros above still address the region dumped.
+ */
+static void dumpRegion(HeapRegion* region) {
+  fprintln(rp->tty, "** Region %s", region->name);
+  fprintln(rp->tty, "    Addr ram0:    0x%08" PRIxPTR "", (uintptr_t)region->ram0);
+  fprintln(rp->tty, "    Addr ramHigh: 0x%08" PRIxPTR "", (uintptr_t)region->ramHighAddress);
   fputstr(rp->tty, "\n");
   fputstr(rp->tty, "Allocator Header Info:\n\n");
-  fprintln(rp->tty, "    # Chunk Offsets In Bitmap: %d", numChunkOffsets);
-  fprintln(rp->tty, "    Size of bin area (B) : %d", sizeof(header->bins[0]) * MAX_BINS);
-  fprintln(rp->tty, "    Size of Bitmap (B)   : %d", ALLOCATION_BITMAP_SIZE);
+  fprintln(rp->tty, "    # Chunk Offsets In Bitmap: %d", region->numChunkOffsets);
+  fprintln(rp->tty, "    Size of bin area (B) : %d", sizeof(region->header->bins[0]) * MAX_BINS);
+  fprintln(rp->tty, "    Size of Bitmap (B)   : %d", region->bitmapSize);
   fprintln(rp->tty, "    Size of Header (B)   : %d", sizeof(struct AllocHeader));
-  fprintln(rp->tty, "    Addr of header (should be ram0): 0x%08" PRIxPTR "", (uintptr_t)header);
-  fprintln(rp->tty, "    Addr of bin 0                  : 0x%08" PRIxPTR "", (uintptr_t)header->bins);
-  fprintln(rp->tty, "    Addr of bin 127                : 0x%08" PRIxPTR "", (uintptr_t)header->bins + MAX_BINS);
-  fprintln(rp->tty, "    Addr of bitmap start           : 0x%08" PRIxPTR "", (uintptr_t)header->bitmap);
-  fprintln(rp->tty, "    Addr of bitmap end             : 0x%08" PRIxPTR "", (uintptr_t)header->bitmap + ALLOCATION_BITMAP_SIZE);
-  fprintln(rp->tty, "    Addr of header end             : 0x%08" PRIxPTR "", (uintptr_t)((char*)header + sizeof(struct AllocHeader)));
-  fprintln(rp->tty, "    Addr of heap start : 0x%08" PRIxPTR "", (uintptr_t)heap);
-  fprintln(rp->tty, "    Size of heap (B)   : %" PRIuPTR "", (uintptr_t)(totalRAM));
-  fprintln(rp->tty, "    Last address is DWORD aligned : %s", (IS_DWORD_ALIGNED(ramHighAddress) ? "yes" : "no"));
+  fprintln(rp->tty, "    Addr of header (should be ram0): 0x%08" PRIxPTR "", (uintptr_t)region->header);
+  fprintln(rp->tty, "    Addr of bin 0                  : 0x%08" PRIxPTR "", (uintptr_t)region->header->bins);
+  fprintln(rp->tty, "    Addr of bin 127                : 0x%08" PRIxPTR "", (uintptr_t)region->header->bins + MAX_BINS);
+  fprintln(rp->tty, "    Addr of bitmap start           : 0x%08" PRIxPTR "", (uintptr_t)region->header->bitmap);
+  fprintln(rp->tty, "    Addr of bitmap end             : 0x%08" PRIxPTR "", (uintptr_t)region->header->bitmap + region->bitmapSize);
+  fprintln(rp->tty, "    Addr of header end             : 0x%08" PRIxPTR "", (uintptr_t)((char*)region->header + sizeof(struct AllocHeader) + region->bitmapSize));
+  fprintln(rp->tty, "    Addr of heap start : 0x%08" PRIxPTR "", (uintptr_t)region->heap);
+  fprintln(rp->tty, "    Size of heap (B)   : %" PRIuPTR "", (uintptr_t)(region->totalRAM));
+  fprintln(rp->tty, "    Last address is DWORD aligned : %s", (IS_DWORD_ALIGNED(region->ramHighAddress) ? "yes" : "no"));
   fputstr(rp->tty, "\n");
   fputstr(rp->tty, "Bitmap Info:\n\n");
 
 #if 0
-  for (int i = 0; i < ALLOCATION_BITMAP_SIZE; i++) {
+  for (int i = 0; i < region->bitmapSize; i++) {
     if (!(i % 10)) {
       if (i != 0) {
         fputstr(rp->tty, "\n");
       }
 
-      fprint(rp->tty, " %.8" PRIxPTR " ", (uintptr_t)header->bitmap + i);
+      fprint(rp->tty, " %.8" PRIxPTR " ", (uintptr_t)region->header->bitmap + i);
     } else if (i != 0) {
       fputstr(rp->tty, " ");
     }
 
-    char c = header->bitmap[i];
+    char c = region->header->bitmap[i];
     for (int j = 8; j > 0; j--) {
       fputchar(rp->tty, '.' + (3 * ((c >> (j - 1)) & 1))); /* unset print '.', set print '1' (hence the multiple of 3) */
     }
@@ -996,14 +1317,14 @@ void kmallocDump(void) {
 
   fputstr(rp->tty, "Heap Info:\n\n");
 
-  for (uintptr_t i = (uintptr_t)heap; i < (uintptr_t)ramHighAddress; ) {
+  for (uintptr_t i = (uintptr_t)region->heap; i < (uintptr_t)region->ramHighAddress; ) {
     fprintln(rp->tty, "** Chunk Offset 0x%08" PRIxPTR "", i);
     struct ChunkHeader *chunk = (struct ChunkHeader*)i;
 
     if (getSize(chunk) == 0)
       break;
 
-    if ((i + getSize(chunk)) > (uintptr_t)ramHighAddress) {
+    if ((i + getSize(chunk)) > (uintptr_t)region->ramHighAddress) {
       fprintln(rp->tty, "** Chunk has potentially corrupt size of %" PRIu32 "", getSize(chunk));
       break;
     }
@@ -1061,20 +1382,63 @@ void kmallocDump(void) {
 }
 
 /*
- * This function is a debug routine that is meant to verify the correctness of the
- * bitmap set/check functions used by the allocator.
+ * dumpPool :: HeapRegion -> ()
  *
- * It is a response to a issue seen only on the k70 where two allocations appeared
- * to map to the same bit even though their addresses were > 16 bytes from each 
- * other (something that testing off the device has shown should be an impossibility)
+ * Dumps a pool region: its free blocks of pages and each of its arenas
+ */
+static void dumpPool(HeapRegion* r) {
+  PagePool* pool = r->pool;
+  HeapRegion* a;
+
+  fprintln(rp->tty, "** Pool %s", r->name);
+  fprintln(rp->tty, "    Addr page 0 : 0x%08" PRIxPTR "", (uintptr_t)pool->base);
+  fprintln(rp->tty, "    # Pages     : %" PRIu32 " (%" PRIu32 " free)", pool->npages, pool->freePages);
+  for (unsigned k = 0; k < PAGE_ORDERS; k++) {
+    unsigned n = 0;
+    ListHead* l;
+    for (l = pool->free[k].next; l != &pool->free[k]; l = l->next)
+      n++;
+    if (n)
+      fprintln(rp->tty, "    Free blocks of %u pages: %u", 1u << k, n);
+  }
+  fputstr(rp->tty, "\n");
+
+  LIST_FOR_EACH_ENTRY(a, &r->arenas, nextArena)
+    dumpRegion(a);
+}
+
+/*
+ * kmallocDump :: FILE* -> ()
  *
- * The premise here is to make a pass over all possible 16 byte address boundaries in
- * the memory space (from heap to heap + totalRAM) and check and set the appropriate 
- * bit. If the bit has been previously set we output the address in stars.
+ * Dumps the current state of the allocator and its data structures to 'out'
  */
-void kmallocBitmapFunctionIntegrityCheck(void) {
-    char bitmap[ALLOCATION_BITMAP_SIZE] = {0}; /* Initialize bitmap to all clear */
-    for (uintptr_t addr = (uintptr_t)heap; addr < (uintptr_t)(heap + totalRAM); addr += MIN_ALLOC_BYTES) {
+void kmallocDump(void) {
+  initRam(); /* incase we haven't initialized the memory already */
+
+  fputstr(rp->tty, "**** YAMalloc Memory Dump ****\n\n");
+  fputstr(rp->tty, "General Info:\n\n");
+  fprintln(rp->tty, "    Min. Allocation size (B): %d", MIN_ALLOC_BYTES);
+  fprintln(rp->tty, "    Size of all heaps (B)   : %" PRIu32 "", totalRAM);
+  fputstr(rp->tty, "\n");
+
+  for (unsigned i = 0; i < COUNT_OF(regions); i++) {
+    if (regions[i].header) {
+      dumpRegion(&regions[i]);
+    } else if (regions[i].pool) {
+      dumpPool(&regions[i]);
+    }
+  }
+}
+
+/*
+ * checkRegionBitmap :: HeapRegion -> Ptr -> ()
+ *
+ * Walks the heap of one region for kmallocBitmapFunctionIntegrityCheck()
+ */
+static void checkRegionBitmap(HeapRegion* region, char* bitmap) {
+    kmemset(bitmap, 0, region->bitmapSize); /* Initialize bitmap to all clear */
+
+    for (uintptr_t addr = (uintptr_t)region->heap; addr < (uintptr_t)(region->heap + region->totalRAM); addr += BITMAP_GRAIN) {
         size_t offset = getAddrBitmapOffset(addr);
         unsigned byte = getAddrByte(addr);
         unsigned bit  = getAddrBit(addr);
@@ -1088,3 +1452,45 @@ void kmallocBitmapFunctionIntegrityCheck(void) {
         bitmap[byte] |= (1 << bit);
     }
 }
+
+/*
+ * This function is a debug routine that is meant to verify the correctness of the
+ * bitmap set/check functions used by the allocator.
+ *
+ * It is a response to a issue seen only on the k70 where two allocations appeared
+ * to map to the same bit even though their addresses were > 16 bytes from each 
+ * other (something that testing off the device has shown should be an impossibility)
+ *
+ * The premise here is to make a pass over all possible 16 byte address boundaries in
+ * each region and arena (from heap to heap + totalRAM) and check and set the appropriate
+ * bit. If the bit has been previously set we output the address in stars.
+ *
+ * One scratch bitmap serves every region, taken before the walk so that
+ * allocating it cannot reorder the arenas under it.
+ */
+void kmallocBitmapFunctionIntegrityCheck(void) {
+    size_t bitmapSize = ARENA_BYTES / (8 * BITMAP_GRAIN) + DWORD_BYTES;
+
+    initRam();
+    for (unsigned i = 0; i < COUNT_OF(regions); i++) {
+        if (regions[i].header && regions[i].bitmapSize > bitmapSize)
+            bitmapSize = regions[i].bitmapSize;
+    }
+
+    char* bitmap = syskmallocHint(bitmapSize, MemBulk);
+    if (!bitmap) {
+        fputstr(rp->tty, "no memory for a bitmap\n");
+        return;
+    }
+
+    for (unsigned i = 0; i < COUNT_OF(regions); i++) {
+        if (regions[i].header) {
+            checkRegionBitmap(&regions[i], bitmap);
+        } else if (regions[i].pool) {
+            HeapRegion* a;
+            LIST_FOR_EACH_ENTRY(a, &regions[i].arenas, nextArena)
+                checkRegionBitmap(a, bitmap);
+        }
+    }
+    syskfree(bitmap);
+}
@@ -0,0 +1,74 @@
+#include <manos.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __GNUC__
+typedef uint32_t __attribute__((__may_alias__)) u32;
+#endif
+
+/**
+ * kmemcpy() - copy memory between regions which do not overlap
+ * @dest: destination
+ * @src:  source
+ * @n:    bytes to copy
+ *
+ * When @dest and @src share their alignment within a word, the heads
+ * are copied bytewise up to a word boundary and the bulk goes 32 bytes
+ * at a time, as an LDM/STM pair of eight registers on the K70. Anything
+ * else is copied a byte at a time, four to an iteration.
+ *
+ * Copying forward is also safe when @dest lies below an overlapping
+ * @src, which kmemmove() relies on.
+ *
+ * Return: @dest
+ */
+void* kmemcpy(void* dest, const void* src, size_t n) {
+    unsigned char* d = dest;
+    const unsigned char* s = src;
+
+#ifdef __GNUC__
+    if ((((uintptr_t)d ^ (uintptr_t)s) & 3) == 0) {
+        for (; n && ((uintptr_t)d & 3); n--)
+            *d++ = *s++;
+
+#ifdef PLATFORM_K70CW
+        for (; n >= 32; n -= 32) {
+            __asm volatile (
+                "ldmia %[s]!, {r3-r6, r8-r10, r12}\n\t"
+                "stmia %[d]!, {r3-r6, r8-r10, r12}\n\t"
+                : [d] "+r" (d), [s] "+r" (s)
+                :
+                : "r3", "r4", "r5", "r6", "r8", "r9", "r10", "r12", "memory");
+        }
+#else
+        for (; n >= 32; n -= 32, d += 32, s += 32) {
+            ((u32*)d)[0] = ((const u32*)s)[0];
+            ((u32*)d)[1] = ((const u32*)s)[1];
+            ((u32*)d)[2] = ((const u32*)s)[2];
+            ((u32*)d)[3] = ((const u32*)s)[3];
+            ((u32*)d)[4] = ((const u32*)s)[4];
+            ((u32*)d)[5] = ((const u32*)s)[5];
+            ((u32*)d)[6] = ((const u32*)s)[6];
+            ((u32*)d)[7] = ((const u32*)s)[7];
+        }
+#endif
+
+        for (; n >= 4; n -= 4, d += 4, s += 4)
+            *(u32*)d = *(const u32*)s;
+    }
+#endif
+
+    for (; n >= 4; n -= 4) {
+        d[0] = s[0];
+        d[1] = s[1];
+        d[2] = s[2];
+        d[3] = s[3];
+        d += 4;
+        s += 4;
+    }
+
+    for (; n; n--)
+        *d++ = *s++;
+
+    return dest;
+}
@@ -0,0 +1,76 @@
+#include <manos.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __GNUC__
+typedef uint32_t __attribute__((__may_alias__)) u32;
+#endif
+
+/**
+ * kmemmove() - copy memory between regions which may overlap
+ * @dest: destination
+ * @src:  source
+ * @n:    bytes to copy
+ *
+ * A forward copy is safe whenever @dest does not start inside the
+ * source, so that case is handed to kmemcpy(). Otherwise the copy runs
+ * backwards from the end, a word at a time (LDMDB/STMDB of eight
+ * registers on the K70) when the two share their alignment.
+ *
+ * Return: @dest
+ */
+void* kmemmove(void* dest, const void* src, size_t n) {
+    unsigned char* d = dest;
+    const unsigned char* s = src;
+
+    if (d == s || n == 0)
+        return dest;
+
+    if (d < s || d >= s + n)
+        return kmemcpy(dest, src, n);
+
+    d += n;
+    s += n;
+
+#ifdef __GNUC__
+    if ((((uintptr_t)d ^ (uintptr_t)s) & 3) == 0) {
+        for (; n && ((uintptr_t)d & 3); n--)
+            *--d = *--s;
+
+#ifdef PLATFORM_K70CW
+        for (; n >= 32; n -= 32) {
+            __asm volatile (
+                "ldmdb %[s]!, {r3-r6, r8-r10, r12}\n\t"
+                "stmdb %[d]!, {r3-r6, r8-r10, r12}\n\t"
+                : [d] "+r" (d), [s] "+r" (s)
+                :
+                : "r3", "r4", "r5", "r6", "r8", "r9", "r10", "r12", "memory");
+        }
+#else
+        for (; n >= 32; n -= 32) {
+            d -= 32;
+            s -= 32;
+            ((u32*)d)[7] = ((const u32*)s)[7];
+            ((u32*)d)[6] = ((const u32*)s)[6];
+            ((u32*)d)[5] = ((const u32*)s)[5];
+            ((u32*)d)[4] = ((const u32*)s)[4];
+            ((u32*)d)[3] = ((const u32*)s)[3];
+            ((u32*)d)[2] = ((const u32*)s)[2];
+            ((u32*)d)[1] = ((const u32*)s)[1];
+            ((u32*)d)[0] = ((const u32*)s)[0];
+        }
+#endif
+
+        for (; n >= 4; n -= 4) {
+            d -= 4;
+            s -= 4;
+            *(u32*)d = *(const u32*)s;
+        }
+    }
+#endif
+
+    for (; n; n--)
+        *--d = *--s;
+
+    return dest;
+}
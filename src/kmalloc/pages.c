@@ -0,0 +1,143 @@
+/**
+ * pages.c - a buddy page allocator for the large objects of kmalloc
+ *
+ * Hands out blocks of a power of two pages. Freeing a block merges it
+ * with its buddy for as long as the buddy is free too, so memory given
+ * back by large objects comes back contiguous.
+ */
+#include <manos.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "pages.h"
+
+#define pageIndex(pool, p) ((uint32_t)(((char*)(p) - (pool)->base) >> PAGE_SHIFT))
+#define pageAddr(pool, i) ((pool)->base + ((size_t)(i) << PAGE_SHIFT))
+
+/*
+ * pushFree :: PagePool -> Integer -> Integer -> ()
+ *
+ * Puts the block at page 'i' on the free list of 'order'.
+ */
+static void pushFree(PagePool* pool, uint32_t i, unsigned order) {
+  pool->desc[i] = PAGE_FREE | order;
+  listAddBefore((ListHead*)pageAddr(pool, i), &pool->free[order]);
+}
+
+/*
+ * initPagePool :: Ptr -> Ptr -> Maybe PagePool
+ *
+ * Lays a pool over [start, end): the PagePool, a descriptor per page,
+ * then as many whole pages as are left, freed in the largest blocks
+ * their alignment allows. Returns NULL when not even a page is left.
+ */
+PagePool* initPagePool(char* start, char* end) {
+  PagePool* pool = (PagePool*)(((uintptr_t)start + 7) & ~(uintptr_t)7);
+  char* desc = (char*)(pool + 1);
+  if (end <= desc || (size_t)(end - desc) < 2 * PAGE_BYTES)
+    return NULL;
+
+  uint32_t npages = (uint32_t)((size_t)(end - desc) / (PAGE_BYTES + 1));
+  pool->desc = (uint8_t*)desc;
+  pool->base = (char*)(((uintptr_t)desc + npages + PAGE_BYTES - 1) & ~(uintptr_t)(PAGE_BYTES - 1));
+  if (pool->base + PAGE_BYTES > end)
+    return NULL;
+
+  uint32_t fit = (uint32_t)((size_t)(end - pool->base) >> PAGE_SHIFT);
+  pool->npages    = fit < npages ? fit : npages;
+  pool->freePages = pool->npages;
+  kmemset(pool->desc, 0, pool->npages);
+  for (unsigned k = 0; k < PAGE_ORDERS; k++)
+    INIT_LIST_HEAD(&pool->free[k]);
+
+  for (uint32_t i = 0; i < pool->npages; ) {
+    unsigned k = PAGE_ORDERS - 1;
+    while ((i & ((1u << k) - 1)) || i + (1u << k) > pool->npages)
+      k--;
+    pushFree(pool, i, k);
+    i += 1u << k;
+  }
+
+  return pool;
+}
+
+/*
+ * pagesOrder :: Integer -> Integer
+ *
+ * The order of the smallest block holding 'bytes'.
+ */
+unsigned pagesOrder(size_t bytes) {
+  unsigned order = 0;
+  while (order < PAGE_ORDERS && ((size_t)PAGE_BYTES << order) < bytes)
+    order++;
+  return order;
+}
+
+/*
+ * allocPages :: PagePool -> Integer -> Integer -> Maybe Ptr
+ *
+ * Takes a block of 'order', marked 'kind', splitting a larger one when
+ * none is free. The halves not used go back on the free lists.
+ */
+void* allocPages(PagePool* pool, unsigned order, unsigned kind) {
+  unsigned k = order;
+  while (k < PAGE_ORDERS && listIsEmpty(&pool->free[k]))
+    k++;
+  if (k >= PAGE_ORDERS)
+    return NULL;
+
+  ListHead* block = pool->free[k].next;
+  listUnlink(block);
+  uint32_t i = pageIndex(pool, block);
+
+  while (k > order) {
+    k--;
+    pushFree(pool, i + (1u << k), k);
+  }
+
+  pool->desc[i] = kind | order;
+  pool->freePages -= 1u << order;
+  return pageAddr(pool, i);
+}
+
+/*
+ * freePages :: PagePool -> Ptr -> Integer
+ *
+ * Gives back the block starting at 'mem', merging it with its buddy
+ * while the buddy is free and whole. Returns the bytes freed.
+ */
+size_t freePages(PagePool* pool, void* mem) {
+  uint32_t i = pageIndex(pool, mem);
+  unsigned order = pool->desc[i] & PAGE_ORDER_MASK;
+  size_t bytes = (size_t)PAGE_BYTES << order;
+
+  ASSERT((pool->desc[i] & (PAGE_LARGE | PAGE_ARENA)) && "freePages() not an allocated block");
+  pool->desc[i] = 0;
+  pool->freePages += 1u << order;
+
+  while (order < PAGE_ORDERS - 1) {
+    uint32_t buddy = i ^ (1u << order);
+    if (buddy + (1u << order) > pool->npages || pool->desc[buddy] != (PAGE_FREE | order))
+      break;
+    listUnlink((ListHead*)pageAddr(pool, buddy));
+    pool->desc[buddy] = 0;
+    i &= ~(1u << order);
+    order++;
+  }
+
+  pushFree(pool, i, order);
+  return bytes;
+}
+
+/*
+ * pageDesc :: PagePool -> Ptr -> Integer
+ *
+ * The descriptor of the page at 'mem', 0 when 'mem' is not the first
+ * byte of a block or is outside the pool.
+ */
+unsigned pageDesc(const PagePool* pool, const void* mem) {
+  const char* p = mem;
+  if (p < pool->base || p >= pageAddr(pool, pool->npages) || ((uintptr_t)(p - pool->base) & (PAGE_BYTES - 1)))
+    return 0;
+  return pool->desc[pageIndex(pool, p)];
+}
@@ -0,0 +1,45 @@
+#ifndef MANOS_KMALLOC_PAGES_H
+#define MANOS_KMALLOC_PAGES_H
+
+#include <manos/list.h>
+
+/*
+ * Page allocator for large objects, see pages.c
+ */
+
+#define PAGE_SHIFT 12
+#define PAGE_BYTES (1 << PAGE_SHIFT)
+#define PAGE_ORDERS 16 /* blocks of 1 to 1<<15 pages, 128MiB holds 1<<15 */
+
+/*
+ * A page descriptor is a byte. The first page of a block holds what the
+ * block is and its order, every other page holds 0.
+ */
+#define PAGE_FREE       0x80
+#define PAGE_LARGE      0x40 /* a kmalloc allocation */
+#define PAGE_ARENA      0x20 /* feeds the small-object bins */
+#define PAGE_ORDER_MASK 0x1f
+
+/*
+ * PagePool = (Ptr, Integer, [[Block]], [Desc])
+ *
+ * Buddy allocator over a region. The pool and its descriptors sit at
+ * the base of the region, the pages follow. A block of order k is 1<<k
+ * pages starting at a page index divisible by 1<<k, and its buddy is
+ * the block whose index differs in bit k alone.
+ */
+typedef struct PagePool {
+  char*    base;              /* page 0 */
+  uint32_t npages;
+  uint32_t freePages;
+  ListHead free[PAGE_ORDERS]; /* free blocks by order, linked through their first page */
+  uint8_t* desc;              /* a descriptor per page */
+} PagePool;
+
+PagePool* initPagePool(char*, char*);
+void* allocPages(PagePool*, unsigned, unsigned);
+size_t freePages(PagePool*, void*);
+unsigned pageDesc(const PagePool*, const void*);
+unsigned pagesOrder(size_t);
+
+#endif /* ! MANOS_KMALLOC_PAGES_H */
@@ -1,42 +1,20 @@
-#define SDRAM_SIZE 133695488 /* 128 * 1024 * 1024 - LCD_SDRAM_SIZE */
-#define SDRAM_END ((SDRAM_START + SDRAM_SIZE - 1) & ~3) /* WORD ALIGN Upper address */
-
-/**
- * This can be computed at runtime using the following method
- *
- * Let M be the size of the addressable memory in bytes.
- * Let k be the size of the minimum addressable chunk.
- * Let h be the size of the allocators header.
- * Let a byte hold 8 bits.
- * Solve m = 1/(8k + 1) * 8k(M - h)
- * Solve b = m / 8k, ALLOCATION_BITMAP_SIZE = b
- * Round to double-word to ensure enough bytes -> b + 7 & ~7
+/*
+ * The upper SRAM left over by the linker, see ._sram_heap in the linker
+ * scripts, and the SDRAM above the LCD frame buffers.
  */
-#define ALLOCATION_BITMAP_SIZE 1036392 /* M = HEAP_SIZE, k = MIN_ALLOC_BYTES, h = 1028 */
+extern char __sram_heap_start[];
+extern char __sram_heap_end[];
+
+#define SDRAM_SIZE 133173248 /* 128 * 1024 * 1024 - LCD_SDRAM_FRAMES * LCD_SDRAM_SIZE */
+#define SDRAM_END (SDRAM_START + SDRAM_SIZE)
 
 /*
- * Note that this header assumes that MIN_ALLOC_BYTES == 16, and the
- * value of ALLOCATION_BITMAP_SIZE was computed with that assumption.
- * This is dangerous, if MIN_ALLOC_BYTES ever changes, and it might,
- * since it is equal to the sizeof struct ChunkHeader.
- *
- * (Note too it assumes MIN_ALLOC_BYTES will be defined for us)
+ * HEAP_REGIONS - X(kind, name, start, end)
  *
- * So below is a bit of C trickery gleaned from the internet
- * (Here: http://scaryreasoner.wordpress.com/2009/02/28/checking-sizeof-at-compile-time/)
- * (And more trickery here: http://www.pixelbeat.org/programming/gcc/static_assert.html)
- *
- * this code prevents compilation if the size assumption changes.
+ * Each region gets its own bins and a bitmap sized to it at runtime,
+ * see initRegion(). MemBulk regions are managed in pages instead, see
+ * initPool().
  */
-
-#ifndef MIN_ALLOC_BYTES
-#error include ramk70.h after MIN_ALLOC_BYTES is defined
-#endif
-
-/* ASSERT MIN_ALLOC_BYTES == 16 */
-#define assert_min_alloc_bytes(e) enum { assert_mab = sizeof(char[1 - 2*!(e)]) }
-assert_min_alloc_bytes(MIN_ALLOC_BYTES == 16);
-
-/* ASSERT ALLOCATION_BITMAP_SIZE is multiple of DWORD_BYTES */
-#define assert_allocation_bitmap_size(e) enum { assert_abs = sizeof(char[1 - 2*!(e)]) }
-assert_allocation_bitmap_size(ALLOCATION_BITMAP_SIZE % DWORD_BYTES == 0);
+#define HEAP_REGIONS                                                    \
+    X(MemFast, "sram",  __sram_heap_start, __sram_heap_end)             \
+    X(MemBulk, "sdram", (char*)SDRAM_START, (char*)SDRAM_END)
@@ -0,0 +1,109 @@
+#include <errno.h>
+#include <limits.h>
+#include <manos.h>
+#include <manos/list.h>
+#include <string.h>
+
+static Timer* alarmTimer(void) {
+    for (Timer* timer = hotpluggedTimers; timer; timer = timer->next) {
+        if (strcmp(timer->name, "k70PDB0") == 0)
+            return timer;
+    }
+    return NULL;
+}
+
+static int lastAlarmId;
+
+static int queueAlarm(Pid pid, long millis, int wake) {
+    Timer* timer = alarmTimer();
+    if (!timer) {
+        errno = ENODEV;
+        return -1;
+    }
+
+    AlarmChain* alarm = syskmalloc0(sizeof *alarm);
+    if (!alarm) {
+        errno = ENOMEM;
+        return -1;
+    }
+
+    enterCriticalRegion();
+    alarm->wakeTime = systime + millis;
+    alarm->pid = pid;
+    alarm->id = lastAlarmId = lastAlarmId == INT_MAX ? 1 : lastAlarmId + 1;
+    alarm->wake = wake;
+    INIT_LIST_HEAD(&alarm->next);
+    listAddBefore(&alarm->next, &timer->alarms);
+    int id = alarm->id;
+    leaveCriticalRegion();
+    return id;
+}
+
+/**
+ * armAlarm() - post SigAlarm to a Proc after a delay
+ * @pid:    Proc to signal
+ * @millis: delay in milliseconds
+ *
+ * Return: an id for cancelAlarm(), or -1 if there is no alarm timer or
+ * no memory
+ */
+int armAlarm(Pid pid, long millis) {
+    return queueAlarm(pid, millis, 0);
+}
+
+/**
+ * armWakeAlarm() - ready a waiting Proc after a delay
+ * @pid:    Proc to wake
+ * @millis: delay in milliseconds
+ *
+ * For the kernel's own timeouts. No signal is posted, so a Proc that
+ * catches SigAlarm never sees them and they take no signal queue slot.
+ *
+ * Return: an id for cancelAlarm(), or -1 if there is no alarm timer or
+ * no memory
+ */
+int armWakeAlarm(Pid pid, long millis) {
+    return queueAlarm(pid, millis, 1);
+}
+
+/**
+ * cancelAlarm() - drop one pending alarm
+ * @id: as returned by armAlarm(), an alarm that already fired is ignored
+ */
+void cancelAlarm(int id) {
+    Timer* timer = alarmTimer();
+    if (!timer)
+        return;
+
+    AlarmChain* iter;
+    enterCriticalRegion();
+    LIST_FOR_EACH_ENTRY(iter, &timer->alarms, next) {
+        if (iter->id == id) {
+            listUnlink(&iter->next);
+            syskfree(iter);
+            break;
+        }
+    }
+    leaveCriticalRegion();
+}
+
+/**
+ * cancelAlarms() - drop every pending alarm for a Proc
+ * @pid: Proc whose alarms are cancelled
+ */
+void cancelAlarms(Pid pid) {
+    Timer* timer = alarmTimer();
+    if (!timer)
+        return;
+
+    AlarmChain* iter;
+    AlarmChain* save;
+    enterCriticalRegion();
+    LIST_FOR_EACH_ENTRY_SAFE(iter, save, &timer->alarms, next) {
+        if (iter->pid == pid) {
+            listUnlink(&iter->next);
+            syskfree(iter);
+        }
+    }
+    leaveCriticalRegion();
+}
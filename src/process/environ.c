@@ -0,0 +1,102 @@
+#include <errno.h>
+#include <manos.h>
+#include <manos/list.h>
+#include <string.h>
+
+/**
+ * mkEnviron() - allocate an empty environment snapshot
+ * @count: most entries it will hold
+ * @bytes: string storage, including a '=' and a NUL per entry
+ *
+ * The snapshot is one allocation, entries then strings, and is handed
+ * back holding a single reference. The shell builds these in user mode,
+ * so it allocates with kmalloc(), as releaseEnviron() frees.
+ *
+ * Return: the Environ, or NULL with errno ENOMEM
+ */
+Environ* mkEnviron(unsigned count, size_t bytes) {
+    size_t head = sizeof(Environ) + (count + 1) * sizeof(char*);
+    Environ* e = kmalloc(head + bytes);
+    if (!e) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    INIT_REF(&e->refs);
+    incRef(&e->refs);
+    e->count = 0;
+    e->size  = bytes;
+    e->end   = (char*)e + head;
+    for (unsigned i = 0; i <= count; i++)
+        e->envp[i] = NULL;
+    return e;
+}
+
+/**
+ * appendEnviron() - add a "name=value" entry to a snapshot being built
+ * @e:        snapshot from mkEnviron()
+ * @name:     variable name
+ * @nameLen:  bytes in @name
+ * @value:    variable value
+ * @valueLen: bytes in @value
+ *
+ * Return: the new entry, or NULL with errno ENOMEM when @e is full
+ */
+char* appendEnviron(Environ* e, const char* name, size_t nameLen, const char* value, size_t valueLen) {
+    size_t bytes = nameLen + valueLen + 2;
+    if (bytes > e->size) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    char* s = e->end;
+    kmemcpy(s, name, nameLen);
+    s[nameLen] = '=';
+    kmemcpy(s + nameLen + 1, value, valueLen);
+    s[bytes - 1] = '\0';
+
+    e->envp[e->count++] = s;
+    e->end  += bytes;
+    e->size -= bytes;
+    return s;
+}
+
+/**
+ * holdEnviron() - take a reference on a snapshot
+ * @e: snapshot, may be NULL
+ *
+ * Return: @e
+ */
+Environ* holdEnviron(Environ* e) {
+    if (e)
+        incRef(&e->refs);
+    return e;
+}
+
+/**
+ * releaseEnviron() - drop a reference, freeing the snapshot with the last
+ * @e: snapshot, may be NULL
+ */
+void releaseEnviron(Environ* e) {
+    if (e && decRef(&e->refs) == 0)
+        kfree(e);
+}
+
+/**
+ * lookupEnviron() - find a variable in a snapshot
+ * @e:    snapshot, may be NULL
+ * @name: variable name
+ *
+ * Return: the value, or NULL if @name is not set
+ */
+const char* lookupEnviron(const Environ* e, const char* name) {
+    if (!e)
+        return NULL;
+
+    size_t n = strlen(name);
+    for (unsigned i = 0; i < e->count; i++) {
+        if (strncmp(e->envp[i], name, n) == 0 && e->envp[i][n] == '=')
+            return e->envp[i] + n + 1;
+    }
+    return NULL;
+}
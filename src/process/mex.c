@@ -0,0 +1,233 @@
+#include <errno.h>
+#include <manos.h>
+#include <manos/list.h>
+#include <string.h>
+
+/*
+ * Mex - relocatable executables.
+ *
+ * A file is a MexHeader, the text, the initialised data, then the
+ * relocation words. Text is shared by every Proc running the image and
+ * is relocated once, when the file is first loaded. Images are built so
+ * text never holds a data address: data is reached through r9, the
+ * static base, as gcc does with -msingle-pic-base. Each Proc gets its
+ * own data and bss, copied from a template whose text addresses are
+ * already filled in, so a spawn only patches the words holding data
+ * addresses.
+ *
+ * Loaded images are cached by file and version, so a repeated exec of
+ * the same file neither reads nor relocates it. The cache holds a
+ * reference on each image; when full, the least recently used image no
+ * Proc is running is dropped.
+ */
+
+static MexImage* mexCache[MANOS_MAXMEX];
+static uint32_t mexClock;
+
+/**
+ * holdMex() - take a reference on an image
+ * @image: image, may be NULL
+ *
+ * Return: @image
+ */
+MexImage* holdMex(MexImage* image) {
+    if (image)
+        incRef(&image->refs);
+    return image;
+}
+
+/**
+ * releaseMex() - drop a reference, freeing the image with the last
+ * @image: image, may be NULL
+ */
+void releaseMex(MexImage* image) {
+    if (image && decRef(&image->refs) == 0) {
+        syskfree(image->text);
+        syskfree(image);
+    }
+}
+
+/**
+ * findMex() - look up the cached image of a file
+ * @ni: the file, as from getInfo
+ *
+ * A file whose length or mtime changed since it was loaded misses.
+ *
+ * Return: the image with a reference held, or NULL
+ */
+MexImage* findMex(const NodeInfo* ni) {
+    MexImage* image = NULL;
+
+    enterCriticalRegion();
+    for (unsigned i = 0; i < MANOS_MAXMEX; i++) {
+        MexImage* m = mexCache[i];
+        if (m && m->device == ni->device && m->fid == ni->crumb.fid &&
+            m->length == ni->length && m->mtime == ni->mtime) {
+            m->lastUse = ++mexClock;
+            image = holdMex(m);
+            break;
+        }
+    }
+    leaveCriticalRegion();
+
+    return image;
+}
+
+/*
+ * Give the cache a reference on image, replacing a stale copy of the same
+ * file or else the least recently used image nothing is running. The
+ * image goes uncached when every slot is busy.
+ */
+static void cacheMex(MexImage* image) {
+    MexImage* victim = NULL;
+
+    enterCriticalRegion();
+    unsigned slot;
+    for (slot = 0; slot < MANOS_MAXMEX; slot++) {
+        MexImage* m = mexCache[slot];
+        if (m && m->device == image->device && m->fid == image->fid)
+            break;
+    }
+
+    if (slot == MANOS_MAXMEX) {
+        for (slot = 0; slot < MANOS_MAXMEX && mexCache[slot]; slot++)
+            ;
+    }
+
+    if (slot == MANOS_MAXMEX) {
+        for (unsigned i = 0; i < MANOS_MAXMEX; i++) {
+            MexImage* m = mexCache[i];
+            if (getRef(&m->refs) == 1 && (slot == MANOS_MAXMEX || m->lastUse < mexCache[slot]->lastUse))
+                slot = i;
+        }
+    }
+
+    if (slot < MANOS_MAXMEX) {
+        victim = mexCache[slot];
+        image->lastUse = ++mexClock;
+        mexCache[slot] = holdMex(image);
+    }
+    leaveCriticalRegion();
+
+    releaseMex(victim);
+}
+
+/**
+ * loadMex() - relocate an executable file and cache the image
+ * @ni:   the file, as from getInfo
+ * @file: its contents
+ * @len:  bytes at @file
+ *
+ * Return: the image with a reference held, or NULL with errno ENOEXEC
+ * when @file is not a well formed image or ENOMEM
+ */
+MexImage* loadMex(const NodeInfo* ni, const void* file, size_t len) {
+    const MexHeader* h = file;
+
+    if (len < sizeof *h || h->magic != MEX_MAGIC || h->textSize == 0 ||
+        h->entry >= h->textSize || h->textSize > len || h->dataSize > len ||
+        h->bssSize >= UINT32_MAX - h->dataSize || /* instanceMex() sizes data + bss + 1 */
+        h->nrelocs > len / sizeof(uint32_t) ||
+        sizeof *h + h->textSize + h->dataSize + h->nrelocs * sizeof(uint32_t) != len) {
+        errno = ENOEXEC;
+        return NULL;
+    }
+
+    const char* text     = (const char*)(h + 1);
+    const char* data     = text + h->textSize;
+    const uint32_t* reloc = (const uint32_t*)(data + h->dataSize);
+
+    unsigned nfixups = 0;
+    for (uint32_t i = 0; i < h->nrelocs; i++) {
+        uint32_t offset = reloc[i] & MEX_RELOC_OFFSET;
+        uint32_t size   = reloc[i] & MEX_RELOC_DATA ? h->dataSize : h->textSize;
+        if ((offset & 3) || size < sizeof(uint32_t) || offset > size - sizeof(uint32_t) ||
+            (reloc[i] & (MEX_RELOC_DATA | MEX_RELOC_TODATA)) == MEX_RELOC_TODATA) {
+            errno = ENOEXEC; /* misplaced, or text pointing at per-Proc data */
+            return NULL;
+        }
+        if (reloc[i] & MEX_RELOC_TODATA)
+            nfixups++;
+    }
+
+    MexImage* image = syskmalloc(sizeof *image + nfixups * sizeof(uint32_t) + h->dataSize);
+    char* loaded    = syskmalloc(h->textSize);
+    if (!image || !loaded) {
+        syskfree(image);
+        syskfree(loaded);
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    INIT_REF(&image->refs);
+    incRef(&image->refs);
+    image->device    = ni->device;
+    image->fid       = ni->crumb.fid;
+    image->length    = ni->length;
+    image->mtime     = ni->mtime;
+    image->lastUse   = 0;
+    image->text      = loaded;
+    image->entry     = h->entry;
+    image->stackSize = h->stackSize;
+    image->dataSize  = h->dataSize;
+    image->bssSize   = h->bssSize;
+    image->nfixups   = 0;
+    image->fixups    = (uint32_t*)(image + 1);
+    image->data      = (char*)(image->fixups + nfixups);
+
+    kmemcpy(image->text, text, h->textSize);
+    kmemcpy(image->data, data, h->dataSize);
+
+    uint32_t textBase = (uint32_t)(uintptr_t)image->text;
+    for (uint32_t i = 0; i < h->nrelocs; i++) {
+        uint32_t offset = reloc[i] & MEX_RELOC_OFFSET;
+        if (reloc[i] & MEX_RELOC_TODATA) {
+            image->fixups[image->nfixups++] = offset; /* patched per Proc */
+            continue;
+        }
+
+        char* segment = reloc[i] & MEX_RELOC_DATA ? image->data : image->text;
+        uint32_t word;
+        kmemcpy(&word, segment + offset, sizeof word);
+        word += textBase;
+        kmemcpy(segment + offset, &word, sizeof word);
+    }
+
+#ifdef PLATFORM_K70CW
+    __asm volatile ("dsb\n\tisb" ::: "memory"); /* fetch the new text, not stale prefetch */
+#endif
+
+    cacheMex(image);
+    return image;
+}
+
+/**
+ * instanceMex() - make the data region of a Proc running an image
+ * @image: the image
+ *
+ * The region is the initialised data followed by the zeroed bss, with
+ * the words holding data addresses pointed into it. Its address is the
+ * Proc's static base.
+ *
+ * Return: the region, or NULL with errno ENOMEM
+ */
+void* instanceMex(const MexImage* image) {
+    char* region = syskmalloc(image->dataSize + image->bssSize + 1); /* never 0 bytes */
+    if (!region) {
+        errno = ENOMEM;
+        return NULL;
+    }
+
+    kmemcpy(region, image->data, image->dataSize);
+    memset(region + image->dataSize, 0, image->bssSize);
+
+    uint32_t dataBase = (uint32_t)(uintptr_t)region;
+    for (unsigned i = 0; i < image->nfixups; i++) {
+        uint32_t word;
+        kmemcpy(&word, region + image->fixups[i], sizeof word);
+        word += dataBase;
+        kmemcpy(region + image->fixups[i], &word, sizeof word);
+    }
+
+    return region;
+}
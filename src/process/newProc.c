@@ -1,8 +1,6 @@
+#include <errno.h>
 #include <manos.h>
 #include <manos/list.h>
-#include <string.h>
-
-uint64_t canary = 0xdecade0fc0ffecab;
 
 ProcGroup* newProcGroup(int pgid) {
     ProcGroup* pgrp = syskmalloc0(sizeof *pgrp);
@@ -27,68 +25,194 @@ void joinProcGroup(ProcGroup* pgrp, Proc* p) {
 void abortProc(Proc* p) {
     wakeWaiting(p);
     listUnlinkAndInit(&p->nextWaitQ);
-    for (unsigned i = 0; i < COUNT_OF(p->descriptorTable); i++) {
-        kfree(p->descriptorTable[i]);
-    }
+    releaseFdTable(&p->fds);
 }
 
-void recycleProc(Proc* p) {
-    p->state = ProcDead;
-    kmemset(p->descriptorTable, 0, sizeof (p->descriptorTable));
+/*
+ * Give back everything p holds but its slot, which a zombie keeps until
+ * its parent has collected the exit status.
+ */
+static void releaseProc(Proc* p) {
+    releaseFdTable(&p->fds);
+    cancelAlarms(p->pid);
+    syskfree(p->slash);
+    syskfree(p->dot);
+    p->slash = NULL;
+    p->dot = NULL;
     INIT_LIST_HEAD(&p->waitQ);
-    INIT_LIST_HEAD(&p->nextWaitQ);
+    listUnlinkAndInit(&p->nextWaitQ);
     INIT_LIST_HEAD(&p->nextRunQ);
     INIT_LIST_HEAD(&p->nextFreelist);
-    p->sigPending = 0;
+    flushSignals(p);
     p->sigMask    = 0;
+    kmemset(p->sigHandlers, 0, sizeof p->sigHandlers);
+    p->sigSp        = 0;
+    p->sigReturning = 0;
     leaveProcGroup(p->pgrp);
     p->pgrp = 0;
-    p->ppid = 0;
+    releaseEnviron(p->env);
+    p->env = NULL;
+    releaseMex(p->image);
+    p->image = NULL;
+    syskfree(p->data);
+    p->data = NULL;
     p->sp = 0;
-    syslock(&freelistLock);
+    freeStack(p);
+}
+
+/**
+ * freeProc() - return a released Proc's slot to the freelist
+ * @p: Proc, already released
+ */
+void freeProc(Proc* p) {
+    enterCriticalRegion();
+    p->state = ProcDead;
+    p->ppid = 0;
+    listUnlinkAndInit(&p->nextSibling);
     listAddBefore(&p->nextFreelist, &procFreelist);
     procTable[p->pid] = 0;
-    sysunlock(&freelistLock);
+    wakeUpOne(&procSpawnQ);
+    leaveCriticalRegion();
+}
+
+void recycleProc(Proc* p) {
+    p->state = ProcDead;
+    releaseProc(p);
+    freeProc(p);
 }
 
-Proc* newProc(void) {
+/**
+ * exitProc() - reap a dead Proc
+ * @p: Proc, dead and off procRunQ
+ *
+ * Its children are orphaned, their zombies freed. With a parent to
+ * report to, p becomes a zombie on the parent's list and the parent is
+ * woken; otherwise it is recycled at once. Either way waitpid() later
+ * finds it without a search.
+ */
+void exitProc(Proc* p) {
+    Proc* c;
+    Proc* save;
+
+    enterCriticalRegion();
+    LIST_FOR_EACH_ENTRY_SAFE(c, save, &p->children, nextSibling) {
+        listUnlinkAndInit(&c->nextSibling);
+        c->ppid = 0;
+    }
+    LIST_FOR_EACH_ENTRY_SAFE(c, save, &p->zombies, nextSibling) {
+        freeProc(c);
+    }
+
+    Proc* parent = p->ppid ? procTable[p->ppid] : NULL;
+    if (!parent) {
+        recycleProc(p);
+    } else {
+        releaseProc(p);
+        p->state = ProcZombie;
+        listUnlink(&p->nextSibling);
+        listAddBefore(&p->nextSibling, &parent->zombies);
+        wakeUp(&parent->childQ);
+    }
+    leaveCriticalRegion();
+}
+
+/**
+ * newProc() - take a Proc from the freelist
+ * @stackSize: stack bytes, 0 for the default
+ *
+ * Never blocks, see spawnProc() for a caller willing to wait.
+ *
+ * Return: the Proc, or NULL with errno EAGAIN when every slot is in use
+ */
+Proc* newProc(size_t stackSize) {
     Proc* p;
 
-    syslock(&freelistLock);
-    while (listIsEmpty(&procFreelist)) {
-        sysunlock(&freelistLock);
-        /* TODO: sleep() */
-        syslock(&freelistLock);
+    enterCriticalRegion();
+    if (listIsEmpty(&procFreelist)) {
+        leaveCriticalRegion();
+        errno = EAGAIN;
+        return NULL;
     }
     p = CONTAINER_OF((&procFreelist)->next, Proc, nextFreelist);
     listUnlink(&p->nextFreelist);
-    sysunlock(&freelistLock);
+    leaveCriticalRegion();
 
     p->state = ProcSpawning;
     INIT_LIST_HEAD(&p->waitQ);
     INIT_LIST_HEAD(&p->nextWaitQ);
     INIT_LIST_HEAD(&p->nextRunQ);
     INIT_LIST_HEAD(&p->nextFreelist);
+    INIT_LIST_HEAD(&p->children);
+    INIT_LIST_HEAD(&p->zombies);
+    INIT_LIST_HEAD(&p->nextSibling);
+    INIT_LIST_HEAD(&p->childQ);
     if (!p->pid) /* reuse existing pids -- only 127 available */
         p->pid = incRef(&nextPid);
     ASSERT(p->pid != 0 && "newProc() pid has id 0");
-    if (!p->stack) {
-        char* stack = syskmalloc0(MANOS_ARCH_K70_STACK_SIZE + (4 * sizeof(uint32_t))); /* kernel owns proc stack memory always -- since it is reused */
-        p->canary1 = (uint64_t*)stack;
-        memcpy(p->canary1, &canary, sizeof canary);
-        stack = stack + sizeof(canary);
-        p->canary2 = (uint64_t*)(stack + MANOS_ARCH_K70_STACK_SIZE);
-        memcpy(p->canary2, &canary, sizeof(canary));
-        p->stack = (uint32_t*)stack;
-        ASSERT(*p->canary1 == *p->canary2 && "newProc() canaries are not equal");
+    if (!p->signalQ) /* kept when the Proc is recycled */
+        p->signalQ = newHeapQ(MANOS_MAXSIGPENDING);
+    if (!p->signalQ || !allocStack(p, stackSize)) {
+        ATOMIC(listAddBefore(&p->nextFreelist, &procFreelist));
+        errno = ENOMEM;
+        return NULL;
     }
     p->pgrp = newProcGroup(p->pid);
-    p->ppid = rp ? rp->pid : 0;
-    p->sigPending = 0;
+    p->exitStatus   = 0;
+    p->waitReported = 0;
+    p->env  = NULL;
+    p->image = NULL;
+    p->data  = NULL;
+    flushSignals(p);
     p->sigMask    = 0;
+    kmemset(p->sigHandlers, 0, sizeof p->sigHandlers);
+    p->sigSp        = 0;
+    p->sigReturning = 0;
     ASSERT(procTable[p->pid] == NULL && "newProc() existing proc in table");
+    enterCriticalRegion();
     procTable[p->pid] = p;
+    p->ppid = rp ? rp->pid : 0;
+    if (rp)
+        listAddBefore(&p->nextSibling, &rp->children);
+    leaveCriticalRegion();
 
     return p;
 }
 
+
+/**
+ * spawnProc() - take a Proc from the freelist, waiting for one if needed
+ * @stackSize: stack bytes, 0 for the default
+ * @millis:    how long to wait, 0 waits forever, negative never waits
+ *
+ * Waiters sleep on procSpawnQ and freeProc() wakes one of them per
+ * slot it returns to the freelist.
+ *
+ * Return: the Proc, or NULL with errno EAGAIN or ETIMEDOUT
+ */
+Proc* spawnProc(size_t stackSize, long millis) {
+    uint64_t deadline = systime + millis;
+    Proc* p;
+
+    while ((p = newProc(stackSize)) == NULL && errno == EAGAIN) {
+        long remaining = 0;
+        if (millis > 0) {
+            if (systime >= deadline) {
+                errno = ETIMEDOUT;
+                return NULL;
+            }
+            remaining = deadline - systime;
+        }
+
+        if (millis < 0)
+            return NULL;
+
+        /* a slot freed since newProc() looked must not be slept through */
+        enterCriticalRegion();
+        int ret = listIsEmpty(&procFreelist) ? sleepOn(&procSpawnQ, remaining) : 0;
+        leaveCriticalRegion();
+        if (ret == -1)
+            return NULL;
+    }
+
+    return p;
+}
@@ -1,3 +1,4 @@
+#include <errno.h>
 #include <manos.h>
 
 /**
@@ -40,6 +41,154 @@ int setSignalUnblock(uint32_t mask, uint32_t* oldMask) {
     if (oldMask)
         *oldMask = rp->sigMask;
 
-    rp->sigMask |= rp->sigMask & ~mask;
+    rp->sigMask &= ~mask;
     return 0;
 }
+
+/*
+ * Signals queue in a HeapQ keyed by urgency then bit number, so a Proc
+ * being stopped and signalled at once sees the stop first, and nothing
+ * pending is lost. Repeated alarms each take a slot and are delivered
+ * as many times as they were posted; the others coalesce.
+ */
+#define SIG_KEY(sig)    ((sigUrgency[sigBit(sig)] << 8) | sigBit(sig))
+#define SIG_OF_KEY(key) ((ProcSig)(1u << ((key) & 0xff)))
+
+static const uint32_t sigUrgency[MANOS_NSIG] = {
+    4   /* SigAbort */
+,   2   /* SigContinue */
+,   3   /* SigStop */
+,   1   /* SigAlarm */
+};
+
+static unsigned sigBit(ProcSig sig) {
+    unsigned bit = 0;
+    while (bit < MANOS_NSIG - 1 && !((uint32_t)sig & (1u << bit)))
+        bit++;
+    return bit;
+}
+
+static uint32_t queuedSignals(const HeapQ* q) {
+    uint32_t pending = 0;
+    for (size_t i = 0; i < q->n; i++)
+        pending |= SIG_OF_KEY(q->buf[i]);
+    return pending;
+}
+
+/**
+ * queueSignal() - add a signal to a Proc's queue
+ * @p:   Proc to signal
+ * @sig: one signal
+ *
+ * Call inside a critical region.
+ *
+ * Return: 0, or -1 with errno EAGAIN when the queue is full
+ */
+int queueSignal(Proc* p, ProcSig sig) {
+    if ((p->sigPending & sig) && sig != SigAlarm)
+        return 0;
+
+    if (!enqueueHeapQ(p->signalQ, SIG_KEY(sig))) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    p->sigPending |= sig;
+    return 0;
+}
+
+/**
+ * takeSignal() - remove the most urgent deliverable signal
+ * @p:    Proc to take from
+ * @held: signals to leave queued
+ *
+ * Call inside a critical region.
+ *
+ * Return: the signal, or 0 when none can be delivered
+ */
+ProcSig takeSignal(Proc* p, uint32_t held) {
+    uint32_t skipped[MANOS_MAXSIGPENDING];
+    unsigned nskipped = 0;
+    ProcSig sig = 0;
+
+    uint32_t key;
+    while (dequeueHeapQ(p->signalQ, &key)) {
+        if (!(SIG_OF_KEY(key) & held)) {
+            sig = SIG_OF_KEY(key);
+            break;
+        }
+        skipped[nskipped++] = key;
+    }
+
+    while (nskipped)
+        enqueueHeapQ(p->signalQ, skipped[--nskipped]);
+
+    p->sigPending = queuedSignals(p->signalQ);
+    return sig;
+}
+
+/**
+ * flushSignals() - drop every queued signal
+ * @p: Proc to clear
+ */
+void flushSignals(Proc* p) {
+    if (p->signalQ)
+        clearHeapQ(p->signalQ);
+    p->sigPending = 0;
+    p->sigCaught  = 0;
+}
+
+/**
+ * setSignalHandler() - catch a signal in the running Proc
+ * @sig:     SigContinue or SigAlarm, which still wake the Proc. Only
+ *           alarms armed through /dev/timer post SigAlarm, the kernel's
+ *           own timeouts do not
+ * @handler: called with the signal on the Proc's stack, NULL to stop
+ *           catching
+ * @old:     holds the previous handler (if not NULL)
+ *
+ * The handler runs the next time the Proc is switched in from thread
+ * mode, and returns into ksigreturn().
+ *
+ * Return: 0, or -1 with errno EINVAL, SigAbort and SigStop can not be
+ * caught
+ */
+int setSignalHandler(ProcSig sig, SigHandler handler, SigHandler* old) {
+    if (sig != SigContinue && sig != SigAlarm) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    unsigned bit = sigBit(sig);
+    if (old)
+        *old = rp->sigHandlers[bit];
+
+    rp->sigHandlers[bit] = handler;
+    return 0;
+}
+
+/**
+ * caughtSignals() - the signals a Proc has handlers for
+ * @p: Proc to look at
+ *
+ * Return: bitmask of caught signals
+ */
+uint32_t caughtSignals(const Proc* p) {
+    uint32_t caught = 0;
+    for (unsigned bit = 0; bit < MANOS_NSIG; bit++) {
+        if (p->sigHandlers[bit])
+            caught |= 1u << bit;
+    }
+    return caught;
+}
+
+/**
+ * signalHandler() - the handler a Proc has for a signal
+ * @p:   Proc to look at
+ * @sig: one signal
+ *
+ * Return: the handler, or NULL
+ */
+SigHandler signalHandler(const Proc* p, ProcSig sig) {
+    return p->sigHandlers[sigBit(sig)];
+}
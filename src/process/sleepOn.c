@@ -0,0 +1,65 @@
+#include <errno.h>
+#include <manos.h>
+#include <manos/list.h>
+#include <arch/k70/derivative.h>
+
+/**
+ * sleepOn() - block the running Proc on a wait queue
+ * @q:      wait queue, woken with wakeUp() or wakeUpOne()
+ * @millis: give up after this many milliseconds, 0 to wait forever
+ *
+ * Only valid from a system call. A caller that checks for a condition
+ * inside a critical region can sleep without leaving it: the Proc is on
+ * @q before interrupts come back on, so a wakeUp() between the check and
+ * the sleep is not lost. The region is given up for the switch and held
+ * again when sleepOn() returns. The SVC handler runs below the scheduler
+ * priority, so the yield switches away as soon as interrupts are enabled
+ * and the call resumes once the Proc is woken or its timeout, which is
+ * not a signal, runs out.
+ *
+ * Return: 0 when woken, -1 with errno ETIMEDOUT when the time ran out
+ */
+int sleepOn(ListHead* q, long millis) {
+#ifdef PLATFORM_K70CW
+    if (!rp) {
+        errno = EAGAIN;
+        return -1;
+    }
+
+    enterCriticalRegion();
+    int held = criticalRegionCount - 1; /* the caller's own region, if any */
+    int alarm = 0;
+    if (millis > 0 && (alarm = armWakeAlarm(rp->pid, millis)) == -1) {
+        leaveCriticalRegion();
+        return -1;
+    }
+
+    ASSERT(listIsEmpty(&rp->nextWaitQ) && "sleepOn() running process already waiting");
+    listAddBefore(&rp->nextWaitQ, q);
+    rp->state = ProcWaiting;
+    YIELD();
+    criticalRegionCount = 1;
+    leaveCriticalRegion();
+
+    /* a waker unlinks us, anything else that readied us was the alarm */
+    enterCriticalRegion();
+    int timedOut = !listIsEmpty(&rp->nextWaitQ);
+    listUnlinkAndInit(&rp->nextWaitQ);
+    if (alarm)
+        cancelAlarm(alarm);
+    criticalRegionCount += held;
+    leaveCriticalRegion();
+
+    if (timedOut) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    return 0;
+#else
+    /* nothing else runs on the host, so no one could wake us */
+    UNUSED(q);
+    UNUSED(millis);
+    errno = EAGAIN;
+    return -1;
+#endif
+}
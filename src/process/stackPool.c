@@ -0,0 +1,217 @@
+#include <manos.h>
+#include <string.h>
+
+#define STACK_PAINT      0xa5
+#define STACK_PAINT_WORD 0xa5a5a5a5
+#define STACK_CLASSES    5 /* 2K, 4K, 8K, 16K, 32K */
+
+static uint64_t canary = 0xdecade0fc0ffecab;
+
+/*
+ * Free stacks are kept per size class, linked through their first word
+ * (where canary1 lives while the stack is in use).
+ */
+static struct {
+    void*    head;
+    unsigned count;
+} stackPool[STACK_CLASSES];
+
+static unsigned stackClass(size_t size) {
+    unsigned c = 0;
+    size_t classSize = MANOS_ARCH_K70_MIN_STACK_SIZE;
+    while (classSize < size && c < STACK_CLASSES - 1) {
+        classSize <<= 1;
+        c++;
+    }
+    return c;
+}
+
+static size_t stackClassSize(unsigned c) {
+    return MANOS_ARCH_K70_MIN_STACK_SIZE << c;
+}
+
+#ifdef PLATFORM_K70CW
+#define STACK_ARENA_SIZE MANOS_ARCH_K70_STACK_ARENA
+#else
+#define STACK_ARENA_SIZE 0 /* no MPU on the host, stacks come from the heap */
+#endif
+
+#define STACK_ALIGN   32 /* MPU region granule */
+#define STACK_ROUND(n) (((n) + STACK_ALIGN - 1) & ~(uintptr_t)(STACK_ALIGN - 1))
+
+/*
+ * Stacks are carved from one block so the MPU can withhold it from
+ * user mode and grant each Proc just its own stack. Carved stacks are
+ * never freed, only pooled; once the arena is used up stacks come from
+ * the heap and go unfenced.
+ */
+static struct {
+    uintptr_t start;
+    uintptr_t next;
+    uintptr_t end;
+} stackArena;
+
+static char* carveStack(size_t bytes) {
+    char* stack = NULL;
+
+    if (STACK_ARENA_SIZE == 0)
+        return NULL;
+
+    if (!stackArena.start) {
+        /* a block of pages, so already aligned for the MPU */
+        char* block = syskmallocHint(STACK_ARENA_SIZE, MemBulk);
+        if (!block)
+            return NULL;
+        enterCriticalRegion();
+        stackArena.start = STACK_ROUND((uintptr_t)block);
+        stackArena.next  = stackArena.start;
+        stackArena.end   = ((uintptr_t)block + STACK_ARENA_SIZE) & ~(uintptr_t)(STACK_ALIGN - 1);
+        leaveCriticalRegion();
+    }
+
+    bytes = STACK_ROUND(bytes);
+    enterCriticalRegion();
+    if (stackArena.end - stackArena.next >= bytes) {
+        stack = (char*)stackArena.next;
+        stackArena.next += bytes;
+    }
+    leaveCriticalRegion();
+
+    return stack;
+}
+
+static int inStackArena(const void* stack) {
+    return (uintptr_t)stack >= stackArena.start && (uintptr_t)stack < stackArena.end;
+}
+
+/**
+ * getStackArena() - bounds of the block Proc stacks are carved from
+ * @start: set to the first byte
+ * @end:   set to one past the last byte
+ *
+ * Return: 0, or -1 when there is no arena
+ */
+int getStackArena(uintptr_t* start, uintptr_t* end) {
+    if (!stackArena.start)
+        return -1;
+    *start = stackArena.start;
+    *end   = stackArena.end;
+    return 0;
+}
+
+/**
+ * getStackRegion() - the memory a Proc may write as its stack
+ * @p:     Proc to look at
+ * @start: set to the first byte, aligned to STACK_ALIGN
+ * @end:   set to the last byte
+ *
+ * The region covers the stack and its canaries.
+ *
+ * Return: 0, or -1 when the stack is not carved from the arena
+ */
+int getStackRegion(const Proc* p, uintptr_t* start, uintptr_t* end) {
+    if (!p->stack || !inStackArena(p->canary1))
+        return -1;
+    *start = (uintptr_t)p->canary1;
+    *end   = STACK_ROUND((uintptr_t)(p->canary2 + 1)) - 1;
+    return 0;
+}
+
+/**
+ * allocStack() - give a Proc a painted stack
+ * @p:    Proc to receive the stack
+ * @size: requested stack size in bytes, 0 for MANOS_ARCH_K70_STACK_SIZE
+ *
+ * The size is rounded up to a power of two class between
+ * MANOS_ARCH_K70_MIN_STACK_SIZE and MANOS_ARCH_K70_STACK_SIZE. The
+ * stack is bracketed by canaries and painted so stackHighWater() can
+ * measure it later.
+ *
+ * Return: the Proc, or NULL if no memory is available
+ */
+Proc* allocStack(Proc* p, size_t size) {
+    if (size == 0 || size > MANOS_ARCH_K70_STACK_SIZE)
+        size = MANOS_ARCH_K70_STACK_SIZE;
+
+    unsigned c = stackClass(size);
+    size = stackClassSize(c);
+
+    char* stack = NULL;
+    enterCriticalRegion();
+    if (stackPool[c].head) {
+        stack = stackPool[c].head;
+        stackPool[c].head = *(void**)stack;
+        stackPool[c].count--;
+    }
+    leaveCriticalRegion();
+
+    if (!stack)
+        stack = carveStack(size + (2 * sizeof canary));
+
+    if (!stack) {
+        /* kernel owns proc stack memory always -- since it is pooled */
+        stack = syskmalloc(size + (2 * sizeof canary));
+        if (!stack)
+            return NULL;
+    }
+
+    p->canary1 = (uint64_t*)stack;
+    memcpy(p->canary1, &canary, sizeof canary);
+    stack = stack + sizeof canary;
+    p->canary2 = (uint64_t*)(stack + size);
+    memcpy(p->canary2, &canary, sizeof canary);
+    kmemset(stack, STACK_PAINT, size);
+    p->stack = (uint32_t*)stack;
+    p->stackSize = size;
+    ASSERT(*p->canary1 == *p->canary2 && "allocStack() canaries are not equal");
+    return p;
+}
+
+/**
+ * freeStack() - return a Proc stack to the pool
+ * @p: Proc giving up its stack
+ */
+void freeStack(Proc* p) {
+    if (!p->stack)
+        return;
+
+    void* stack = p->canary1;
+    unsigned c = stackClass(p->stackSize);
+    p->stack = NULL;
+    p->canary1 = NULL;
+    p->canary2 = NULL;
+    p->stackSize = 0;
+
+    enterCriticalRegion();
+    if (stackPool[c].count < MANOS_ARCH_K70_STACK_POOL || inStackArena(stack)) {
+        *(void**)stack = stackPool[c].head;
+        stackPool[c].head = stack;
+        stackPool[c].count++;
+        stack = NULL;
+    }
+    leaveCriticalRegion();
+
+    if (stack)
+        syskfree(stack);
+}
+
+/**
+ * stackHighWater() - measure the deepest stack use of a Proc
+ * @p: Proc to measure
+ *
+ * Stacks grow down, so paint left intact at the low end has never been
+ * touched.
+ *
+ * Return: the most bytes of stack the Proc has used
+ */
+size_t stackHighWater(const Proc* p) {
+    if (!p->stack)
+        return 0;
+
+    size_t words = p->stackSize / sizeof(uint32_t);
+    size_t untouched = 0;
+    while (untouched < words && p->stack[untouched] == STACK_PAINT_WORD)
+        untouched++;
+
+    return p->stackSize - (untouched * sizeof(uint32_t));
+}
@@ -1,17 +1,89 @@
+#include <errno.h>
 #include <manos.h>
 #include <manos/list.h>
 #include <arch/k70/derivative.h>
 
-void syswaitpid(int pid) {
-    if (pid < 0 || pid > MANOS_MAXPROC)
-        return;
+/*
+ * Collect a child for syswaitpid(), in a critical region. Exited children
+ * are already on rp's zombie list, so taking one is O(1); only a search
+ * for stopped children walks the live ones.
+ *
+ * Return: the child's pid, 0 if none is ready, or -1 with errno ECHILD
+ */
+static int collectChild(int pid, int* status, int options) {
+    Proc* c = NULL;
+
+    if (pid == -1) {
+        if (!listIsEmpty(&rp->zombies)) {
+            c = CONTAINER_OF(rp->zombies.next, Proc, nextSibling);
+        } else if (listIsEmpty(&rp->children)) {
+            errno = ECHILD;
+            return -1;
+        } else if (options & WAIT_UNTRACED) {
+            Proc* s;
+            LIST_FOR_EACH_ENTRY(s, &rp->children, nextSibling) {
+                if (s->state == ProcStopped && !s->waitReported) {
+                    c = s;
+                    break;
+                }
+            }
+        }
+    } else {
+        c = procTable[pid];
+        if (!c || c->ppid != rp->pid) {
+            errno = ECHILD;
+            return -1;
+        }
+    }
+
+    if (!c)
+        return 0;
+
+    if (c->state == ProcZombie) {
+        int cpid = c->pid;
+        if (status)
+            *status = c->exitStatus;
+        freeProc(c);
+        return cpid;
+    }
+
+    if ((options & WAIT_UNTRACED) && c->state == ProcStopped && !c->waitReported) {
+        if (status)
+            *status = WAIT_STOPPED;
+        c->waitReported = 1;
+        return c->pid;
+    }
+
+    return 0;
+}
+
+/**
+ * syswaitpid() - wait for a child to exit
+ * @pid:     the child, or -1 for any child
+ * @status:  set to the child's exit code or WAIT_KILLED, may be NULL
+ * @options: WAIT_NOHANG to return at once, WAIT_UNTRACED to also report
+ *           a child that stopped, once, with WAIT_STOPPED
+ *
+ * A child exiting wakes its parent, so nothing polls. The check and the
+ * sleep share a critical region, so that wake up can not be missed.
+ *
+ * Return: the child's pid, 0 with WAIT_NOHANG when none is ready, or -1
+ * with errno ECHILD when there is no such child
+ */
+int syswaitpid(int pid, int* status, int options) {
+    if (pid == 0 || pid < -1 || pid >= MANOS_MAXPROC) {
+        errno = ECHILD;
+        return -1;
+    }
 
-    Proc* p;
     enterCriticalRegion();
-    p = procTable[pid];
-    ASSERT(listIsEmpty(&rp->nextWaitQ) && "syswaitpid() running process already waiting");
-    listAddAfter(&rp->nextWaitQ, &p->waitQ);
-    rp->state = ProcWaiting;
-    YIELD();
+    int ret;
+    while ((ret = collectChild(pid, status, options)) == 0 && !(options & WAIT_NOHANG)) {
+        if (sleepOn(&rp->childQ, 0) == -1) {
+            ret = -1;
+            break;
+        }
+    }
     leaveCriticalRegion();
+    return ret;
 }
@@ -1,12 +1,43 @@
 #include <manos.h>
 #include <manos/list.h>
 
-void wakeWaiting(Proc* p) {
+/**
+ * wakeUp() - ready every Proc sleeping on a wait queue
+ * @q: wait queue
+ */
+void wakeUp(ListHead* q) {
     Proc* waiting;
     Proc* save;
 
-    LIST_FOR_EACH_ENTRY_SAFE(waiting, save, &p->waitQ, nextWaitQ) {
+    LIST_FOR_EACH_ENTRY_SAFE(waiting, save, q, nextWaitQ) {
         listUnlinkAndInit(&waiting->nextWaitQ);
         waiting->state = ProcReady;
     }
 }
+
+/**
+ * wakeUpOne() - ready the longest sleeping Proc on a wait queue
+ * @q: wait queue
+ */
+void wakeUpOne(ListHead* q) {
+    if (listIsEmpty(q))
+        return;
+
+    Proc* waiting = CONTAINER_OF(q->next, Proc, nextWaitQ);
+    listUnlinkAndInit(&waiting->nextWaitQ);
+    waiting->state = ProcReady;
+}
+
+/**
+ * wakeProc() - ready a Proc if it is waiting
+ * @pid: Proc to wake, a stopped or running one is left as it is
+ */
+void wakeProc(Pid pid) {
+    Proc* p = pid > 0 && pid < MANOS_MAXPROC ? procTable[pid] : NULL;
+    if (p && p->state == ProcWaiting)
+        p->state = ProcReady;
+}
+
+void wakeWaiting(Proc* p) {
+    wakeUp(&p->waitQ);
+}
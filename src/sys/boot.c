@@ -0,0 +1,198 @@
+#include <errno.h>
+#include <manos.h>
+#include <manos/list.h>
+#include <string.h>
+#include <arch/k70/derivative.h>
+
+/*
+ * Boot profile.
+ *
+ * main() and the Procs it starts mark each phase of a boot as it ends,
+ * from reset to the first shell prompt and the deferred bring-up after
+ * it. /dev/boot reads the marks back as text. Time is taken from the
+ * cycle counter main() starts, so the work of the startup code before
+ * main() is not counted; the host has no cycle counter and reads 0.
+ */
+
+#define X(p, n) n,
+static const char* bootNames[] = {
+    BOOT_PHASES
+};
+#undef X
+
+static struct {
+    uint32_t micros[BootPhaseCount]; /* since main() was entered */
+    uint32_t marked;                 /* a bit per phase */
+    uint32_t lastCycles;             /* CYCLE_COUNT() at the newest mark */
+    BootPhase last;
+} boot;
+
+static LIST_HEAD(bootQ); /* Procs in bootWait() */
+
+/**
+ * bootMark() - record that a boot phase has ended
+ * @phase: the phase
+ *
+ * Only the first mark of a phase counts, so a second shell does not move
+ * the prompt. Marks must come within a wrap of the cycle counter of each
+ * other, about 35s, which a boot does. Up to the clocks mark the core
+ * runs from its reset clock, and the cycles are scaled to match.
+ */
+void bootMark(BootPhase phase) {
+    uint32_t now = CYCLE_COUNT();
+
+    enterCriticalRegion();
+    if (!(boot.marked & (1u << phase))) {
+        uint32_t rate = (boot.marked & (1u << BootClocks)) ? MANOS_ARCH_K70_CYCLES_PER_MILLIS
+                                                           : MANOS_ARCH_K70_RESET_CYCLES_PER_MILLIS;
+        boot.micros[phase] = boot.micros[boot.last] + (uint32_t)((uint64_t)(now - boot.lastCycles) * 1000 / rate);
+        boot.marked |= 1u << phase;
+        boot.lastCycles = now;
+        boot.last = phase;
+        wakeUp(&bootQ);
+    }
+    leaveCriticalRegion();
+}
+
+/**
+ * bootMarked() - has a boot phase ended
+ * @phase: the phase
+ *
+ * Return: 1 if @phase has been marked, else 0
+ */
+int bootMarked(BootPhase phase) {
+    return (boot.marked >> phase) & 1;
+}
+
+/**
+ * bootWait() - sleep until a boot phase has ended
+ * @phase:  the phase
+ * @millis: give up after this many milliseconds, 0 to wait forever
+ *
+ * bootMark() wakes the waiters, so nothing polls while the boot is being
+ * profiled. Only valid from a system call, user mode calls kbootwait().
+ *
+ * Return: 0 once @phase is marked, -1 with errno ETIMEDOUT if it was not
+ * marked in time
+ */
+int bootWait(BootPhase phase, long millis) {
+    uint64_t deadline = systime + millis;
+    int ret = 0;
+
+    enterCriticalRegion();
+    while (ret == 0 && !bootMarked(phase)) {
+        long remaining = 0;
+        if (millis > 0) {
+            if (systime >= deadline) {
+                errno = ETIMEDOUT;
+                ret = -1;
+                break;
+            }
+            remaining = deadline - systime;
+        }
+        ret = sleepOn(&bootQ, remaining);
+    }
+    leaveCriticalRegion();
+    return ret;
+}
+
+/**
+ * bootMarkName() - mark a boot phase by name, as written to /dev/boot
+ * @name: the phase name, a trailing newline is ignored
+ * @size: bytes at @name
+ *
+ * Return: 0, or -1 with errno EINVAL for a name that is not a phase
+ */
+int bootMarkName(const char* name, size_t size) {
+    while (size && (name[size - 1] == '\n' || name[size - 1] == 0))
+        size--;
+
+    for (unsigned i = 0; i < BootPhaseCount; i++) {
+        if (strlen(bootNames[i]) == size && strncmp(bootNames[i], name, size) == 0) {
+            bootMark((BootPhase)i);
+            return 0;
+        }
+    }
+
+    errno = EINVAL;
+    return -1;
+}
+
+/**
+ * readBoot() - the boot profile as text
+ * @buf:    destination
+ * @size:   bytes available at @buf
+ * @offset: position in the text to start from
+ *
+ * A line per phase: its name, milliseconds since main() when it ended and
+ * how long it took after the phase marked before it. A phase not yet
+ * marked shows a dash.
+ *
+ * Return: bytes copied
+ */
+size_t readBoot(char* buf, size_t size, Offset offset) {
+    char text[BootPhaseCount * 40];
+    size_t len = 0;
+    uint32_t prev = 0;
+
+    for (unsigned i = 0; i < BootPhaseCount; i++) {
+        ptrdiff_t n;
+        if (bootMarked((BootPhase)i)) {
+            uint32_t t = boot.micros[i];
+            n = fmtSnprintf(text + len, sizeof text - len, "%-9s %6u.%03u ms  +%u.%03u\n", bootNames[i],
+                            (unsigned)(t / 1000), (unsigned)(t % 1000),
+                            (unsigned)((t - prev) / 1000), (unsigned)((t - prev) % 1000));
+            prev = t;
+        } else {
+            n = fmtSnprintf(text + len, sizeof text - len, "%-9s      -\n", bootNames[i]);
+        }
+        if (n > 0)
+            len += n;
+    }
+
+    if (offset >= len)
+        return 0;
+
+    size_t bytes = len - offset > size ? size : len - offset;
+    memcpy(buf, text + offset, bytes);
+    return bytes;
+}
+
+#define BOOT_DEFER_MAX_MILLIS 2000 /* bring the devices up anyway if no prompt comes */
+
+/**
+ * bootDeferred() - bring up the lazy devices once the shell is ready
+ * @argc: unused
+ * @argv: unused
+ *
+ * Run as a Proc of its own by main(). Sleeps until the first prompt so
+ * the shell is not held up, woken by the mark itself, then attaches each lazy device not attached yet,
+ * so a first use later does not pay for its bring-up. Device registers
+ * are off limits to user mode, the attach is left to the open syscall.
+ *
+ * Return: 0
+ */
+int bootDeferred(int argc, char * const argv[]) {
+    UNUSED(argc);
+    UNUSED(argv);
+
+    kbootwait(BootPrompt, BOOT_DEFER_MAX_MILLIS);
+
+    for (unsigned i = 0; i < COUNT_OF(deviceTable); i++) {
+        if (!deviceTable[i]->lazy)
+            continue;
+
+        char path[MANOS_MAXNAME];
+        fmtSnprintf(path, sizeof path, "/dev/%s", deviceTable[i]->name);
+        int fd = kopen(path, CAP_READ);
+        if (fd != -1)
+            kclose(fd);
+    }
+
+    int fd = kopen("/dev/boot", CAP_WRITE);
+    if (fd != -1) {
+        kwrite(fd, "deferred", 8);
+        kclose(fd);
+    }
+    return 0;
+}
@@ -2,20 +2,18 @@
 #include <manos.h>
 
 void sysclose(int fd) {
-    Portal* p = rp->descriptorTable[fd];
+    Portal* p = lookupFd(&rp->fds, fd);
 
-    if (fd < 0 || !p) {
+    if (!p) {
         errno = EBADF;
         return;
     }
 
-    if (p) {
-        if (p->device >= MANOS_MAXDEV) {
-            sysprintln("sysclose() unknown device %d", p->device);
-            return;
-        }
-        deviceTable[p->device]->close(p);
-        syskfree(p);
-        rp->descriptorTable[fd] = 0;
+    if (p->device >= MANOS_MAXDEV) {
+        sysprintln("sysclose() unknown device %d", p->device);
+        return;
     }
+    deviceTable[p->device]->close(p);
+    freeFd(&rp->fds, fd);
+    syskfree(p);
 }
@@ -0,0 +1,104 @@
+#include <manos.h>
+#include <string.h>
+
+/*
+ * Crash record.
+ *
+ * The fault handler writes what it knows about a fault into RAM the
+ * startup code leaves alone, so it can be read back from /dev/crash
+ * after the reset that follows. RAM holds garbage after power on, so a
+ * record only counts when its magic and checksum agree.
+ */
+
+static CrashRecord crash NOINIT;
+
+static uint32_t crashSum(const CrashRecord* r) {
+    const uint32_t* w = (const uint32_t*)&r->faults;
+    const uint32_t* end = (const uint32_t*)(r + 1);
+    uint32_t sum = CRASH_MAGIC;
+    while (w < end)
+        sum = ((sum << 5) | (sum >> 27)) ^ *w++;
+    return sum;
+}
+
+static int haveCrash(void) {
+    return crash.magic == CRASH_MAGIC && crash.sum == crashSum(&crash) && crash.traceLen <= CRASH_TRACE;
+}
+
+/**
+ * recordCrash() - keep a fault for reading after a reset
+ * @regs:   machine state of the fault
+ * @killed: 1 if only the running Proc is killed, 0 if the unit halts
+ *
+ * Replaces any earlier record but carries its fault count forward. Safe
+ * from a fault handler: it takes no locks and allocates nothing.
+ */
+void recordCrash(const CrashRegs* regs, int killed) {
+    uint32_t faults = haveCrash() ? crash.faults : 0;
+
+    kmemset(&crash, 0, sizeof crash);
+    crash.faults   = faults + 1;
+    crash.killed   = killed;
+    crash.systime  = systime;
+    crash.pid      = rp ? rp->pid : -1;
+    crash.regs     = *regs;
+    kmallocStats(&crash.heap);
+    crash.traceLen = tailKlog(crash.trace, CRASH_TRACE);
+    crash.sum      = crashSum(&crash);
+    crash.magic    = CRASH_MAGIC;
+}
+
+/**
+ * clearCrash() - forget the crash record
+ */
+void clearCrash(void) {
+    crash.magic = 0;
+}
+
+/**
+ * readCrash() - the crash record as text
+ * @buf:    destination
+ * @size:   bytes available at @buf
+ * @offset: position in the text to start from
+ *
+ * Return: bytes copied, 0 when no record is held
+ */
+size_t readCrash(char* buf, size_t size, Offset offset) {
+    static const char* frameNames[] = { "r0", "r1", "r2", "r3", "r12", "lr", "pc", "xpsr" };
+    char text[384 + CRASH_TRACE];
+    size_t len = 0;
+
+    if (!haveCrash())
+        return 0;
+
+#define CRASH_FMT(...) do {                                                     \
+    ptrdiff_t n = fmtSnprintf(text + len, sizeof text - len, __VA_ARGS__);      \
+    if (n > 0) len += n;                                                        \
+} while (0)
+
+    CRASH_FMT("faults %u, last at %u.%03u in pid %d, %s\n", (unsigned)crash.faults,
+              (unsigned)(crash.systime / 1000), (unsigned)(crash.systime % 1000), (int)crash.pid,
+              crash.killed ? "proc killed" : "halted");
+    CRASH_FMT("cfsr %08x hfsr %08x mmfar %08x bfar %08x mpu %08x exc %08x\n",
+              (unsigned)crash.regs.cfsr, (unsigned)crash.regs.hfsr, (unsigned)crash.regs.mmfar,
+              (unsigned)crash.regs.bfar, (unsigned)crash.regs.mpuAddr, (unsigned)crash.regs.excReturn);
+    for (unsigned i = 0; i < COUNT_OF(frameNames); i++)
+        CRASH_FMT("%s %08x%s", frameNames[i], (unsigned)crash.regs.frame[i], i % 4 == 3 ? "\n" : " ");
+    CRASH_FMT("heap %u of %u in use, hwm %u, %u allocs, %u frees\n",
+              (unsigned)crash.heap.inUse, (unsigned)crash.heap.total, (unsigned)crash.heap.hwm,
+              (unsigned)crash.heap.allocs, (unsigned)crash.heap.frees);
+    CRASH_FMT("log:\n");
+
+#undef CRASH_FMT
+
+    size_t trace = crash.traceLen < sizeof text - len ? crash.traceLen : sizeof text - len;
+    memcpy(text + len, crash.trace, trace);
+    len += trace;
+
+    if (offset >= len)
+        return 0;
+
+    size_t bytes = len - offset < size ? len - offset : size;
+    memcpy(buf, text + offset, bytes);
+    return bytes;
+}
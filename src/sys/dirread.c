@@ -15,8 +15,8 @@
  * the seconds is an array of NodeInfo
  */
 int dirread(int fd, NodeInfo** buf) {
-    Portal* p = rp->descriptorTable[fd];
-    if (fd < 0 || !p) {
+    Portal* p = lookupFd(&rp->fds, fd);
+    if (!p) {
         errno = EBADF;
         return -1;
     }
@@ -1,6 +1,7 @@
 #include <errno.h>
 #include <manos.h>
 #include <torgo/commands.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <manos/list.h>
@@ -8,16 +9,22 @@
 
 extern int __sysopen(Proc*, const char*, Caps);
 
-void __manos_exit(void) {
+/*
+ * A Cmd returns here, its return value the exit code. A Proc killed
+ * on a fault arrives with WAIT_KILLED already in exitStatus. This runs
+ * in user mode, the _exits syscall tears the Proc down.
+ */
+void __manos_exit(int status) {
 #ifdef PLATFORM_K70CW
-    abortProc(rp);
-    rp->state = ProcDead;
+    rp->exitStatus |= WAIT_CODE(status);
     _exits();
+#else
+    UNUSED(status);
 #endif
 }
 
-static void setupStack(Proc* p, Cmd cmd, int argc, char * const argv[]) {
-    uint32_t* sp = (uint32_t*)((char*)p->stack + MANOS_ARCH_K70_STACK_SIZE);
+static void setupStack(Proc* p, Cmd cmd, int argc, char * const argv[], uint32_t sb) {
+    uint32_t* sp = (uint32_t*)((char*)p->stack + p->stackSize);
 
     *(--sp) = 0x1000000;              /* XPSR */
     *(--sp) = (uint32_t)cmd;          /* PC   */
@@ -30,7 +37,7 @@ static void setupStack(Proc* p, Cmd cmd, int argc, char * const argv[]) {
     *(--sp) = 0xfffffff9;             /* interrupt LR */
     *(--sp) = 0x0b0b0b0b;             /* r11  */
     *(--sp) = 0x0a0a0a0a;             /* r10  */
-    *(--sp) = 0x09090909;             /* r9   */
+    *(--sp) = sb;                     /* r9, static base */
     *(--sp) = 0x08080808;             /* r8   */
     *(--sp) = 0x07070707;             /* r7   */
     *(--sp) = 0x06060606;             /* r6   */
@@ -41,10 +48,54 @@ static void setupStack(Proc* p, Cmd cmd, int argc, char * const argv[]) {
     p->sp = (uintptr_t)sp;
 }
 
-Proc* schedProc(Cmd cmd, int argc, char * const argv[]) {
+/*
+ * Give p its own Portal on the running Proc's descriptor fd, opened
+ * again so devices counting their users see it. Falls back to the tty.
+ */
+static int inheritFd(Proc* p, int fd) {
+    Portal* o = fd < 0 || !rp ? NULL : lookupFd(&rp->fds, fd);
+    if (!o || o->device >= MANOS_MAXDEV)
+        return p->tty;
+
+    Portal* px = syskmalloc(sizeof *px);
+    if (!px)
+        return p->tty;
+
+    mkPortal(px, o->device);
+    clonePortal(o, px);
+    if (deviceTable[px->device]->open(px, o->caps) == NULL) {
+        syskfree(px);
+        return p->tty;
+    }
+
+    int nfd = allocFd(&p->fds, px);
+    if (nfd == -1) {
+        deviceTable[px->device]->close(px);
+        syskfree(px);
+        return p->tty;
+    }
+    return nfd;
+}
+
+/*
+ * Start cmd in a new Proc. A Proc running a loaded image holds a
+ * reference on it and gets its own copy of the image data, whose address
+ * it finds in r9.
+ */
+static Proc* startProc(Cmd cmd, int argc, char * const argv[], const SpawnAttr* attr, size_t stackSize, long millis, MexImage* image) {
+    void* data = NULL;
+    if (image && (data = instanceMex(image)) == NULL)
+        return NULL;
+
+    /* may sleep, so no locks are held until we have a Proc */
+    Proc* p = spawnProc(stackSize, millis);
+    if (!p) {
+        syskfree(data);
+        return NULL;
+    }
+
     syslock(&runQLock);
     enterCriticalRegion();
-    Proc* p = newProc();
 
     p->slash = deviceTable[fromDeviceId(DEV_DEVROOT)]->attach("");
     p->dot   = deviceTable[fromDeviceId(DEV_DEVROOT)]->attach("");
@@ -53,9 +104,14 @@ Proc* schedProc(Cmd cmd, int argc, char * const argv[]) {
 #else
     p->tty   = __sysopen(p, "/dev/uart/stdio", CAP_READWRITE);
 #endif
+    p->in    = inheritFd(p, attr ? attr->in : -1);
+    p->out   = inheritFd(p, attr ? attr->out : -1);
 
-    setupStack(p, cmd, argc, argv);
-    p->argv = (char**)argv;
+    setupStack(p, cmd, argc, argv, data ? (uint32_t)(uintptr_t)data : 0x09090909);
+    p->argv  = (char**)argv;
+    p->env   = holdEnviron(attr && attr->env ? attr->env : rp ? rp->env : NULL);
+    p->image = holdMex(image);
+    p->data  = data;
     listAddBefore(&p->nextRunQ, &procRunQ);
     p->state = ProcReady;
     
@@ -64,14 +120,41 @@ Proc* schedProc(Cmd cmd, int argc, char * const argv[]) {
     return p;
 }
 
+Proc* schedProc(Cmd cmd, int argc, char * const argv[], const SpawnAttr* attr, size_t stackSize, long millis) {
+    return startProc(cmd, argc, argv, attr, stackSize, millis, NULL);
+}
+
+/*
+ * Start a Proc running a loaded image, returning its pid or -1.
+ */
+static int spawnMex(MexImage* image, int argc, char * const argv[], const SpawnAttr* attr, long millis) {
+    Cmd entry = (Cmd)(uintptr_t)(image->text + image->entry);
+    Proc* p = startProc(entry, argc, argv, attr, image->stackSize, millis, image);
+    return p ? p->pid : -1;
+}
+
 /*
  * This is a hack syscall which 'executes' a file.
- * These files must be mode 0555 and have their contents
- * begin with #!<x> where <x> will map to a builtin
+ * These files must be mode 0555 and either be a relocatable image,
+ * see loadMex(), or have their contents begin with #!<x> where <x>
+ * will map to a builtin. An image already loaded from the same file
+ * is started without reading the file again.
+ *
+ * The builtin name may be followed by a stack size in bytes,
+ * #!<x> <size>, which overrides the size in the builtin table.
+ *
+ * When every Proc slot is in use the caller sleeps for up to millis
+ * for one to be reaped, see spawnProc().
+ *
+ * attr, which may be NULL, picks the child's environment and standard
+ * input and output. The child takes a reference on the environment, or
+ * on the caller's own when none is given, so passing a snapshot on
+ * costs no copying; the descriptors are opened again in the child, so
+ * the caller may close its copies as soon as this returns.
  *
  * TOTAL HACK!
  */
-int sysexecv(const char *path, char * const argv[]) {
+int sysspawn(const char *path, char * const argv[], const SpawnAttr* attr, long millis) {
     int argc;
     int ret = -1;
     char *buf = NULL;
@@ -121,14 +204,44 @@ int sysexecv(const char *path, char * const argv[]) {
             goto error;
         }
 
+        MexImage* image = findMex(&ni);
+        if (image) {
+            ret = spawnMex(image, argc, argv, attr, millis);
+            releaseMex(image);
+            goto error;
+        }
+
         if (deviceTable[p->device]->open(p, CAP_READ) == NULL)
             goto error;
 
         buf = syskmalloc(ni.length + 1);
-        if (deviceTable[p->device]->read(p, buf, ni.length, 0) == -1)
-            return -1;
+        if (!buf) {
+            deviceTable[p->device]->close(p);
+            errno = ENOMEM;
+            goto error;
+        }
+
+        size_t got = 0;
+        while (got < ni.length) {
+            ptrdiff_t n = deviceTable[p->device]->read(p, buf + got, ni.length - got, got);
+            if (n <= 0)
+                break;
+            got += n;
+        }
 
         deviceTable[p->device]->close(p);
+        if (got < ni.length) {
+            errno = EIO;
+            goto error;
+        }
+
+        if (ni.length >= sizeof(MexHeader) && ((MexHeader*)buf)->magic == MEX_MAGIC) {
+            if ((image = loadMex(&ni, buf, ni.length)) != NULL) {
+                ret = spawnMex(image, argc, argv, attr, millis);
+                releaseMex(image);
+            }
+            goto error;
+        }
 
         char* c = buf;
         if (c[0] != '#' || c[1] != '!') {
@@ -137,10 +250,21 @@ int sysexecv(const char *path, char * const argv[]) {
         }
 
         c += 2;
+        buf[ni.length] = 0;
+        size_t stackSize = 0;
+        char* space = strchr(c, ' ');
+        if (space) {
+            *space = 0;
+            stackSize = strtoul(space + 1, NULL, 0);
+        }
+
         for (unsigned i = 0; i < COUNT_OF(builtinCmds); i++) {
             if (strcmp(builtinCmds[i].cmdName, c) == 0) {
-                Proc* p = schedProc(builtinCmds[i].cmd, argc, argv);
-                ret = p->pid;
+                if (stackSize == 0)
+                    stackSize = builtinCmds[i].stackSize;
+                Proc* p = schedProc(builtinCmds[i].cmd, argc, argv, attr, stackSize, millis);
+                if (p)
+                    ret = p->pid;
                 break;
             }
         }
@@ -152,3 +276,7 @@ error:
     if (buf) syskfree(buf);
     return ret;
 }
+
+int sysexecv(const char *path, char * const argv[]) {
+    return sysspawn(path, argv, NULL, 0);
+}
@@ -1,7 +1,7 @@
 #include <manos.h>
 
-extern void __manos_exit(void);
+extern void __manos_exit(int);
 
 void exits(void) {
-    __manos_exit();
+    __manos_exit(0);
 }
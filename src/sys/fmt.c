@@ -1,48 +1,157 @@
 #include <errno.h>
 #include <manos.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <string.h>
-#include <stdlib.h>
 
 char intToHexLC[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
 
-/* converts i into a string representation */
-static int uintToStr(char* buf, size_t n, int hex, uint32_t i) {
-    if (n == 0) return 0;
+/* "00" .. "99", so digits come out two at a time */
+static const char digitPairs[200] = {
+    '0','0','0','1','0','2','0','3','0','4','0','5','0','6','0','7','0','8','0','9'
+,   '1','0','1','1','1','2','1','3','1','4','1','5','1','6','1','7','1','8','1','9'
+,   '2','0','2','1','2','2','2','3','2','4','2','5','2','6','2','7','2','8','2','9'
+,   '3','0','3','1','3','2','3','3','3','4','3','5','3','6','3','7','3','8','3','9'
+,   '4','0','4','1','4','2','4','3','4','4','4','5','4','6','4','7','4','8','4','9'
+,   '5','0','5','1','5','2','5','3','5','4','5','5','5','6','5','7','5','8','5','9'
+,   '6','0','6','1','6','2','6','3','6','4','6','5','6','6','6','7','6','8','6','9'
+,   '7','0','7','1','7','2','7','3','7','4','7','5','7','6','7','7','7','8','7','9'
+,   '8','0','8','1','8','2','8','3','8','4','8','5','8','6','8','7','8','8','8','9'
+,   '9','0','9','1','9','2','9','3','9','4','9','5','9','6','9','7','9','8','9','9'
+};
 
-    if (i == 0) {
-        *(buf + n - 1) = '0';
-        return 1;
+/*
+ * uint32ToDec :: char* -> uint32_t -> char*
+ *
+ * Writes the decimal digits of i backwards, ending just before end, and
+ * returns the first digit. Division by 100 is a multiply by its
+ * reciprocal (exact for every 32 bit i), so no divide instruction is
+ * needed and two digits come out per step.
+ */
+static char* uint32ToDec(char* end, uint32_t i) {
+    while (i >= 100) {
+        uint32_t q = (uint32_t)(((uint64_t)i * 0x51eb851fu) >> 37); /* i / 100 */
+        uint32_t r = i - q * 100;
+        end -= 2;
+        end[0] = digitPairs[2 * r];
+        end[1] = digitPairs[2 * r + 1];
+        i = q;
     }
 
-    int base = hex ? 16 : 10;
-    char* c = buf + n - 1;
-    int x = n;
-
-    while (x && i) {
-        uint32_t r = i % base;
-        i /= base;
+    if (i >= 10) {
+        end -= 2;
+        end[0] = digitPairs[2 * i];
+        end[1] = digitPairs[2 * i + 1];
+    } else {
+        *--end = '0' + i;
+    }
+    return end;
+}
 
-        if (hex) { 
-            *c = intToHexLC[r];
-        } else {
-            *c = r + '0';
-        }
-        c--;
-        x--;
+/*
+ * uint64ToDec :: char* -> uint64_t -> char*
+ *
+ * As uint32ToDec. Values past 32 bits are split into nine digit chunks,
+ * so at most two 64 bit divisions are made.
+ */
+static char* uint64ToDec(char* end, uint64_t i) {
+    while (i > UINT32_MAX) {
+        uint64_t q = i / 1000000000u;
+        char* start = uint32ToDec(end, (uint32_t)(i - q * 1000000000u));
+        while (start > end - 9)
+            *--start = '0';
+        end = start;
+        i = q;
     }
-    
-    return n - x;
+    return uint32ToDec(end, (uint32_t)i);
 }
 
-/* although we aren't likely to encounter 64-bit integers it costs little to
- * allow for such sizing. Max value in a 64-bit integer will be 20 digits long
- * so our buffer for storing integers will be size accordingly
+/*
+ * uint64ToHex :: char* -> uint64_t -> char*
+ *
+ * Writes the lower case hex digits of i backwards, ending just before
+ * end, and returns the first digit.
  */
+static char* uint64ToHex(char* end, uint64_t i) {
+    do {
+        *--end = intToHexLC[i & 0xf];
+        i >>= 4;
+    } while (i);
+    return end;
+}
+
+/* a 64-bit integer is at most 20 digits long */
 #define INTBUF_SIZE 20
 
 /*
- * (worst printf implementation ever)
+ * Out is where formatted output goes. end is the last byte which may
+ * take output, the one after is kept for the terminating NUL; a NULL
+ * end is unbounded.
+ */
+typedef struct Out {
+    char* p;
+    char* end;
+} Out;
+
+static inline size_t outRoom(const Out* o, size_t want) {
+    if (!o->end)
+        return want;
+    size_t room = o->end - o->p;
+    return want < room ? want : room;
+}
+
+/* spans are short, a byte loop beats a call to memcpy or memset */
+static inline void outBytes(Out* o, const char* s, size_t n) {
+    n = outRoom(o, n);
+    char* p = o->p;
+    while (n--)
+        *p++ = *s++;
+    o->p = p;
+}
+
+static inline void outFill(Out* o, char c, size_t n) {
+    n = outRoom(o, n);
+    char* p = o->p;
+    while (n--)
+        *p++ = c;
+    o->p = p;
+}
+
+#define FMT_ZERO  0x1 /* '0' flag */
+#define FMT_LEFT  0x2 /* '-' flag */
+#define FMT_PREC  0x4 /* precision given */
+
+/*
+ * outInt :: Out* -> char -> const char* -> size_t -> int -> unsigned -> unsigned -> ()
+ *
+ * Emits the digits s[0..n) with an optional sign, padded out to width and
+ * to precision digits per the flags.
+ */
+static void outInt(Out* o, char sign, const char* s, size_t n, int flags, unsigned width, unsigned precision) {
+    size_t zeros = (flags & FMT_PREC) && precision > n ? precision - n : 0;
+    size_t total = (sign != 0) + zeros + n;
+    size_t pad   = width > total ? width - total : 0;
+
+    if (pad && !(flags & FMT_LEFT) && !((flags & FMT_ZERO) && !(flags & FMT_PREC))) {
+        outFill(o, ' ', pad);
+        pad = 0;
+    }
+
+    if (sign)
+        outBytes(o, &sign, 1);
+
+    if (pad && !(flags & FMT_LEFT)) { /* zero padding */
+        outFill(o, '0', pad);
+        pad = 0;
+    }
+
+    outFill(o, '0', zeros);
+    outBytes(o, s, n);
+    outFill(o, ' ', pad);
+}
+
+/*
+ * (slightly less worst printf implementation ever)
  * printf style formatting to a buffer of size n. This is the backbone of
  * the printf style functions.
  *
@@ -52,11 +161,12 @@ static int uintToStr(char* buf, size_t n, int hex, uint32_t i) {
  *
  * Language is:
  *
- * %[flag][width][.precision][type]
+ * %[flag][width][.precision][length][type]
  *
  * flag can be:
  *
  * '0' -- zero pad output
+ * '-' -- left justify output
  *
  * width can be:
  *
@@ -64,136 +174,161 @@ static int uintToStr(char* buf, size_t n, int hex, uint32_t i) {
  *
  * precision can be
  *
- * any int
+ * any int, the minimum digits of an integer or the most bytes of a string
+ *
+ * length can be:
+ *
+ * l  -- long
+ * ll -- long long
  *
  * type can be:
  *
  * d -- int
  * u -- unsigned
- * l -- long
- * ul -- unsigned long
- * x -- int, printed in hex
+ * x -- unsigned, printed in hex
  * s -- NULL terminated string
+ *
+ * Literal text is copied in the same pass that scans for holes, and a
+ * hole with no flags, width or precision skips the padding logic.
+ *
+ * At most n - 1 bytes are written, then a NUL. Returns the bytes written,
+ * not counting the NUL.
  */
 static ptrdiff_t fmtVsnprintfInternal(char buf[], size_t n, int useN, const char* fmt, va_list ap) {
-    char intBuf[INTBUF_SIZE + 1] = {0};
+    if (useN && n == 0)
+        return 0;
+
+    Out o = { .p = buf, .end = useN ? buf + n - 1 : NULL };
     const char* c = fmt;
-    char* p = buf;
+    char intBuf[INTBUF_SIZE];
+    char* intEnd = intBuf + INTBUF_SIZE;
+
+    while (*c && (!o.end || o.p < o.end)) {
+        /* literal text up to the next hole, copied as it is scanned */
+        if (*c != '%') {
+            char* p = o.p;
+            size_t room = outRoom(&o, SIZE_MAX);
+            while (*c && *c != '%' && room--)
+                *p++ = *c++;
+            o.p = p;
+            continue;
+        }
+
+        const char* x = c + 1; /* skip '%' */
+        if (*x == '%') {
+            outBytes(&o, "%", 1);
+            c = x + 1;
+            continue;
+        }
+
+        /* 1: handle flags */
+        int flags = 0;
+        for (;; x++) {
+            if (*x == '0')
+                flags |= FMT_ZERO;
+            else if (*x == '-')
+                flags |= FMT_LEFT;
+            else
+                break;
+        }
+
+        /* 2: handle width */
+        unsigned width = 0;
+        while (*x >= '0' && *x <= '9')
+            width = width * 10 + (*x++ - '0');
 
-    while (n && *c) {
-        const char* x = c;
+        /* 2a: handle precision */
+        unsigned precision = 0;
+        if (*x == '.') {
+            flags |= FMT_PREC;
+            x++;
+            while (*x >= '0' && *x <= '9')
+                precision = precision * 10 + (*x++ - '0');
+        }
 
-        /* scan for format delimiter */
-        while ((n || !useN) && *x && *x != '%') {
-            *p++ = *x;
+        /* 3: handle length */
+        int longModifiers = 0;
+        while (*x == 'l') {
+            longModifiers++;
             x++;
-            n--;
         }
 
-        c = x;
+        /* 4: handle type */
+        char sign = 0;
+        uint64_t u = 0;
+        char* s;
+        switch (*x) {
+        case 'd':
+            {
+                int64_t i;
+                if (longModifiers >= 2)
+                    i = va_arg(ap, long long);
+                else if (longModifiers == 1)
+                    i = va_arg(ap, long);
+                else
+                    i = va_arg(ap, int);
 
-        if (*x == '%') { 
-            if (*(x + 1) == '%') {
-                *p++ = '%';
-                c = x + 2;
-                n--;
-                continue;
+                if (i < 0) {
+                    sign = '-';
+                    u = -(uint64_t)i;
+                } else {
+                    u = i;
+                }
             }
-            x++;
-            /* 1: handle flags */
-           switch (*x) {
-           case '0':
-               kmemset(intBuf, '0', INTBUF_SIZE);
-               x++;
-               break;
-           }
-           c = x;
-
-           /* 2: handle width */
-           unsigned width = 0;
-           while (*x >= '0' && *x <= '9')
-               x++;
-
-           width = atoi(c);
-           c = x;
-
-           int hasPrecision = 0;
-           unsigned precision = 0;
-           /* 2a: handle precision */
-           if (*x == '.') {
-               hasPrecision = 1;
-               x++;
-               c = x;
-
-               while (*x >= '0' && *x <= '9')
-                   x++;
-
-               precision = atoi(c);
-           }
-
-           c = x;
-
-           int longModifiers = 0;
-           size_t bytes = 0;
-           char* s;
-           /* 3: handle type */
-restartOnLongModifier:
-           switch (*x) {
-           case 'l':
-               x++;
-               longModifiers++;
-               goto restartOnLongModifier;
-           case 'd':
-           case 'u':
-               bytes = uintToStr(intBuf, INTBUF_SIZE, 0, va_arg(ap, uint32_t));
-               if (bytes < width) bytes = width;
-               if (useN && bytes > n) bytes = n;
-               memcpy(p, intBuf + INTBUF_SIZE - bytes, bytes);
-               n -= bytes;
-               p += bytes;
-               c = x + 1;
-               break;
-           case 'x':
-               bytes = uintToStr(intBuf, INTBUF_SIZE, 1, va_arg(ap, uint32_t));
-               if (bytes < width) bytes = width;
-               if (useN && bytes > n) bytes = n;
-               memcpy(p, intBuf + INTBUF_SIZE - bytes, bytes);
-               n -= bytes;
-               p += bytes;
-               c = x + 1;
-               break;
-           case 's':
-               s = va_arg(ap, char*);
-               bytes = strlen(s);
-               if (hasPrecision && precision < bytes) bytes = precision;
-               if (width > bytes) {
-                   width -= bytes;
-                   while (width && (n || !useN)) {
-                       *p = ' ';
-                       p++;
-                       n--;
-                       width--;
-                   }
-               }
-               if (useN && !n) break;
-               if (useN && bytes > n) bytes = n;
-               memcpy(p, s, bytes);
-               n -= bytes;
-               p += bytes;
-               c = x + 1;
-               break;
-           }
+            s = u > UINT32_MAX ? uint64ToDec(intEnd, u) : uint32ToDec(intEnd, (uint32_t)u);
+            break;
+        case 'u':
+        case 'x':
+            if (longModifiers >= 2)
+                u = va_arg(ap, unsigned long long);
+            else if (longModifiers == 1)
+                u = va_arg(ap, unsigned long);
+            else
+                u = va_arg(ap, unsigned);
+
+            if (*x == 'x')
+                s = uint64ToHex(intEnd, u);
+            else
+                s = u > UINT32_MAX ? uint64ToDec(intEnd, u) : uint32ToDec(intEnd, (uint32_t)u);
+            break;
+        case 's':
+            s = va_arg(ap, char*);
+            {
+                size_t bytes = 0;
+                while (s[bytes] && (!(flags & FMT_PREC) || bytes < precision))
+                    bytes++;
+                size_t pad   = width > bytes ? width - bytes : 0;
+                if (!(flags & FMT_LEFT))
+                    outFill(&o, ' ', pad);
+                outBytes(&o, s, bytes);
+                if (flags & FMT_LEFT)
+                    outFill(&o, ' ', pad);
+            }
+            c = x + 1;
+            continue;
+        default:
+            /* unknown hole, print it as is */
+            outBytes(&o, c, (*x ? x + 1 : x) - c);
+            c = *x ? x + 1 : x;
+            continue;
         }
+
+        if (!flags && !width && !sign)
+            outBytes(&o, s, intEnd - s);
+        else
+            outInt(&o, sign, s, intEnd - s, flags, width, precision);
+        c = x + 1;
     }
-    *p = 0;
-    return p - buf;
+
+    *o.p = 0;
+    return o.p - buf;
 }
 
 ptrdiff_t fmtVsnprintf(char buf[], size_t n, const char* fmt, va_list ap) {
     return fmtVsnprintfInternal(buf, n, 1, fmt, ap);
 }
 
-ptrdiff_t fmtSnprintf(char buf[], size_t n, const char* fmt, ...) {
+ptrdiff_t (fmtSnprintf)(char buf[], size_t n, const char* fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
     ptrdiff_t bytes = fmtVsnprintf(buf, n, fmt, ap);
@@ -201,10 +336,32 @@ ptrdiff_t fmtSnprintf(char buf[], size_t n, const char* fmt, ...) {
     return bytes;
 }
 
+/**
+ * fmtCopy() - the fmtSnprintf() of a format with no holes
+ * @buf: destination
+ * @n:   bytes available at @buf
+ * @s:   text to copy
+ * @len: bytes of text at @s
+ *
+ * Used by the fmtSnprintf() macro when the format is known at compile
+ * time to hold no '%'. Truncates and terminates as fmtSnprintf() does.
+ *
+ * Return: bytes written, not counting the NUL
+ */
+ptrdiff_t fmtCopy(char buf[], size_t n, const char* s, size_t len) {
+    if (n == 0)
+        return 0;
+
+    Out o = { .p = buf, .end = buf + n - 1 };
+    outBytes(&o, s, len);
+    *o.p = 0;
+    return o.p - buf;
+}
+
 ptrdiff_t fmtSprintf(char buf[], const char* fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
-    ptrdiff_t bytes = fmtVsnprintfInternal(buf, strlen(buf), 0, fmt, ap);
+    ptrdiff_t bytes = fmtVsnprintfInternal(buf, 0, 0, fmt, ap);
     va_end(ap);
     return bytes;
 }
@@ -2,8 +2,8 @@
 #include <manos.h>
 
 int sysgetInfoFd(int fd, NodeInfo* ni) {
-    Portal* p = rp->descriptorTable[fd];
-    if (fd < 0 || !p) {
+    Portal* p = lookupFd(&rp->fds, fd);
+    if (!p) {
         errno = EBADF;
         return -1;
     }
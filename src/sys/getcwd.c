@@ -1,7 +1,7 @@
 #include <manos.h>
 #include <string.h>
 
-char* getcwd(char* buf, size_t n) {
+char* sysgetcwd(char* buf, size_t n) {
     Portal* p = syswalk(rp->dot, 0, 0);
     NodeInfo ni;
     deviceTable[p->device]->getInfo(p, &ni);
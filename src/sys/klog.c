@@ -0,0 +1,332 @@
+#include <manos.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Kernel log.
+ *
+ * Printing appends a record to a ring and returns. A console with a
+ * transmit interrupt is kicked and pulls the text out of the ring with
+ * takeKlog() as it has room; any other console is fed a few bytes at a
+ * time by the scheduler interrupts. Either way a slow console never
+ * stalls whoever printed. Urgent records, and everything printed before
+ * the scheduler runs, are pushed out at once. The ring also keeps the
+ * history read back from /dev/kprint.
+ *
+ * Positions are free running byte counts, masked into the ring.
+ */
+
+#define KLOG_SIZE   4096        /* power of two */
+#define KLOG_MAXLEN (KLOG_SIZE / 4)
+#define KLOG_CONT   0x80        /* record continues the previous line */
+#define KLOG_CHUNK  32          /* bytes copied out per critical region by putKlog() */
+
+typedef struct KlogRecord {
+    uint32_t msecs;
+    uint16_t len;
+    uint8_t  level; /* KlogLevel, or'ed with KLOG_CONT */
+    uint8_t  pad;
+} KlogRecord;
+
+#define KLOG_RECORD_SIZE(n) ((sizeof(KlogRecord) + (n) + 3) & ~3u)
+
+static struct {
+    char     ring[KLOG_SIZE];
+    uint32_t first;    /* oldest record */
+    uint32_t next;     /* where the next record goes */
+    uint32_t drain;    /* oldest record not yet fully on the console */
+    uint32_t drained;  /* text bytes of that record already on the console */
+    int      lineOpen; /* last record did not end a line */
+    int      draining;
+} klog;
+
+static void ringIn(uint32_t pos, const void* src, size_t n) {
+    const char* s = src;
+    for (size_t i = 0; i < n; i++)
+        klog.ring[(pos + i) & (KLOG_SIZE - 1)] = s[i];
+}
+
+static void ringOut(void* dst, uint32_t pos, size_t n) {
+    char* d = dst;
+    for (size_t i = 0; i < n; i++)
+        d[i] = klog.ring[(pos + i) & (KLOG_SIZE - 1)];
+}
+
+static KlogRecord recordAt(uint32_t pos) {
+    KlogRecord r;
+    ringOut(&r, pos, sizeof r);
+    return r;
+}
+
+/*
+ * Copy console text out of the ring, newlines as CR LF, at most max
+ * bytes. Call in a critical region.
+ */
+static size_t takeText(char* buf, size_t max) {
+    size_t bytes = 0;
+    while (klog.drain != klog.next) {
+        KlogRecord r = recordAt(klog.drain);
+        char c = klog.ring[(klog.drain + sizeof r + klog.drained) & (KLOG_SIZE - 1)];
+        if (bytes + (c == '\n' ? 2 : 1) > max)
+            break;
+
+        if (c == '\n')
+            buf[bytes++] = '\r';
+        buf[bytes++] = c;
+        if (++klog.drained == r.len) {
+            klog.drain  += KLOG_RECORD_SIZE(r.len);
+            klog.drained = 0;
+        }
+    }
+    return bytes;
+}
+
+/**
+ * takeKlog() - take pending log text for the console
+ * @buf: destination
+ * @max: bytes available at @buf
+ *
+ * For the transmit interrupt of a console with a kick. Never waits.
+ *
+ * Return: bytes taken, 0 when there are none or a flush is under way
+ */
+size_t takeKlog(char* buf, size_t max) {
+    size_t bytes = 0;
+
+    enterCriticalRegion();
+    if (!klog.draining)
+        bytes = takeText(buf, max);
+    leaveCriticalRegion();
+    return bytes;
+}
+
+/* push up to max bytes through putc, which may wait on the console */
+static void putKlog(size_t max) {
+    if (consoleUart == NULL || consoleUart->hw->putc == NULL)
+        return;
+
+    enterCriticalRegion();
+    if (klog.draining) {
+        leaveCriticalRegion();
+        return;
+    }
+    klog.draining = 1;
+
+    while (max) {
+        char chunk[KLOG_CHUNK];
+        size_t n = takeText(chunk, max < sizeof chunk ? max : sizeof chunk);
+        if (n == 0)
+            break;
+        max -= n;
+        leaveCriticalRegion();
+
+        /* putc may wait on the UART, which needs interrupts */
+        for (size_t i = 0; i < n; i++)
+            consoleUart->hw->putc(consoleUart, chunk[i]);
+
+        enterCriticalRegion();
+    }
+
+    klog.draining = 0;
+    leaveCriticalRegion();
+}
+
+/**
+ * drainKlog() - get pending log text moving to the console
+ * @max: most bytes to push
+ *
+ * A console with a kick only has its transmit interrupt started, and
+ * takes the text itself. Any other is fed up to @max bytes. Safe to
+ * call from interrupts; a drain already in progress wins and this
+ * returns at once.
+ */
+void drainKlog(size_t max) {
+    if (consoleUart && consoleUart->hw->kick) {
+        consoleUart->hw->kick(consoleUart);
+        return;
+    }
+    putKlog(max);
+}
+
+/**
+ * flushKlog() - copy all pending log text to the console
+ */
+void flushKlog(void) {
+    putKlog(SIZE_MAX);
+}
+
+/* the oldest records are dropped to make room, whether or not they reached the console */
+static void appendKlog(KlogLevel level, const char* s, size_t n) {
+    if (n > KLOG_MAXLEN)
+        n = KLOG_MAXLEN;
+
+    uint32_t size = KLOG_RECORD_SIZE(n);
+
+    enterCriticalRegion();
+    while (klog.next + size - klog.first > KLOG_SIZE) {
+        uint32_t old = klog.first;
+        klog.first += KLOG_RECORD_SIZE(recordAt(old).len);
+        if (klog.drain == old) {
+            klog.drain   = klog.first;
+            klog.drained = 0;
+        }
+    }
+
+    KlogRecord r = {
+        .msecs = (uint32_t)systime
+    ,   .len   = n
+    ,   .level = level | (klog.lineOpen ? KLOG_CONT : 0)
+    };
+    ringIn(klog.next, &r, sizeof r);
+    ringIn(klog.next + sizeof r, s, n);
+    klog.next    += size;
+    klog.lineOpen = s[n - 1] != '\n';
+    leaveCriticalRegion();
+}
+
+static void kickKlog(KlogLevel level) {
+#ifdef PLATFORM_NICE
+    UNUSED(level);
+    flushKlog();
+#else
+    if (level <= KlogErr || rp == NULL)
+        flushKlog();
+    else if (consoleUart && consoleUart->hw->kick)
+        consoleUart->hw->kick(consoleUart);
+#endif
+}
+
+/**
+ * klogWrite() - append a record to the kernel log
+ * @level: severity, KlogErr and worse go to the console at once
+ * @s:     text, need not end a line
+ * @n:     bytes of text, at most a quarter of the ring is kept
+ */
+void klogWrite(KlogLevel level, const char* s, size_t n) {
+    if (n == 0)
+        return;
+
+    appendKlog(level, s, n);
+    kickKlog(level);
+}
+
+static int vklog(KlogLevel level, int eol, const char* fmt, va_list ap) {
+    static char buf[KLOG_MAXLEN + 1];
+
+    enterCriticalRegion(); /* buf is shared with interrupts */
+    int ret = fmtVsnprintf(buf, KLOG_MAXLEN, fmt, ap);
+    if (ret >= 0) {
+        if (eol)
+            buf[ret++] = '\n';
+        if (ret > 0)
+            appendKlog(level, buf, ret);
+    }
+    leaveCriticalRegion();
+
+    kickKlog(level);
+    return ret;
+}
+
+/**
+ * sysklog() - format a record into the kernel log
+ * @level: severity
+ * @fmt:   format, as fmtVsnprintf()
+ *
+ * Return: bytes formatted
+ */
+int sysklog(KlogLevel level, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int ret = vklog(level, 0, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+int sysprintln(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int ret = vklog(KlogInfo, 1, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+int sysprint(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int ret = vklog(KlogInfo, 0, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
+/**
+ * readKlog() - the log history as text
+ * @buf:    destination
+ * @size:   bytes available at @buf
+ * @offset: position in the text to start from
+ *
+ * Each line is prefixed with its level and the systime it was logged at
+ * as "<level>[seconds.millis] ". Offsets move as old records are dropped.
+ *
+ * Return: bytes copied
+ */
+size_t readKlog(char* buf, size_t size, Offset offset) {
+    size_t bytes = 0;
+    Offset at = 0;
+
+    enterCriticalRegion();
+    for (uint32_t pos = klog.first; pos != klog.next && bytes < size;) {
+        KlogRecord r = recordAt(pos);
+
+        char head[32];
+        size_t headLen = 0;
+        if (!(r.level & KLOG_CONT)) {
+            ptrdiff_t n = fmtSnprintf(head, sizeof head, "<%u>[%u.%03u] ",
+                    (unsigned)r.level, (unsigned)(r.msecs / 1000), (unsigned)(r.msecs % 1000));
+            headLen = n > 0 ? (size_t)n : 0;
+        }
+
+        for (size_t i = 0; i < headLen + r.len && bytes < size; i++, at++) {
+            if (at < offset)
+                continue;
+            buf[bytes++] = i < headLen ? head[i] : klog.ring[(pos + sizeof r + i - headLen) & (KLOG_SIZE - 1)];
+        }
+
+        pos += KLOG_RECORD_SIZE(r.len);
+    }
+    leaveCriticalRegion();
+
+    return bytes;
+}
+
+/**
+ * tailKlog() - the newest records, without their prefixes
+ * @buf:  destination
+ * @size: bytes available at @buf
+ *
+ * Copies the text of as many whole records as fit, oldest first. Takes
+ * no locks beyond a critical region, so faults can call it.
+ *
+ * Return: bytes copied
+ */
+size_t tailKlog(char* buf, size_t size) {
+    size_t bytes = 0;
+
+    enterCriticalRegion();
+    size_t total = 0;
+    for (uint32_t pos = klog.first; pos != klog.next; pos += KLOG_RECORD_SIZE(recordAt(pos).len))
+        total += recordAt(pos).len;
+
+    for (uint32_t pos = klog.first; pos != klog.next;) {
+        KlogRecord r = recordAt(pos);
+        if (total <= size) {
+            ringOut(buf + bytes, pos + sizeof r, r.len);
+            bytes += r.len;
+        }
+        total -= r.len;
+        pos += KLOG_RECORD_SIZE(r.len);
+    }
+    leaveCriticalRegion();
+
+    return bytes;
+}
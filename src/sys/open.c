@@ -14,18 +14,19 @@ int __sysopen(Proc* rp, const char* path, Caps caps) {
     if((p = syswalk(isRel?rp->dot:rp->slash, pth->elems, pth->nelems)) == NULL)
         goto error;
 
-    int fd = -1;
-    for (fd = 0; fd < MANOS_MAXFD; fd++) {
-        if (rp->descriptorTable[fd] == NULL) {
-            rp->descriptorTable[fd] = deviceTable[p->device]->open(p, caps);
-            return fd;
-        }
-    }
+    Portal* o = deviceTable[p->device]->open(p, caps);
+    if (!o)
+        goto error;
 
-    if (fd == MANOS_MAXFD) {
-        errno = EMFILE;
+    int fd = allocFd(&rp->fds, o);
+    if (fd == -1) {
+        deviceTable[o->device]->close(o);
+        goto error;
     }
 
+    syskfree(pth);
+    return fd;
+
 error:
     if (pth) syskfree(pth);
     if (p) syskfree(p);
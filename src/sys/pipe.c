@@ -0,0 +1,28 @@
+#include <errno.h>
+#include <manos.h>
+
+/**
+ * syspipe() - create a pipe in the running Proc
+ * @fds: set to the read descriptor and the write descriptor
+ *
+ * Return: 0, or -1 with errno set
+ */
+int syspipe(int fds[2]) {
+    Portal* ends[2];
+    if (newPipe(ends) == -1)
+        return -1;
+
+    fds[0] = allocFd(&rp->fds, ends[0]);
+    fds[1] = fds[0] == -1 ? -1 : allocFd(&rp->fds, ends[1]);
+    if (fds[1] == -1) {
+        if (fds[0] != -1)
+            freeFd(&rp->fds, fds[0]);
+        for (unsigned i = 0; i < 2; i++) {
+            deviceTable[ends[i]->device]->close(ends[i]);
+            syskfree(ends[i]);
+        }
+        return -1;
+    }
+
+    return 0;
+}
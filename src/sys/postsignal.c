@@ -1,13 +1,35 @@
+#include <errno.h>
 #include <manos.h>
 
+/**
+ * syspostsignal() - queue signals for a Proc
+ * @pid:    Proc to signal
+ * @signal: one or more signals
+ *
+ * Masked signals stay queued until they are unmasked. Safe from
+ * interrupts.
+ *
+ * Return: 0, or -1 with errno ESRCH for no such Proc or EAGAIN when its
+ * queue is full
+ */
 int syspostsignal(Pid pid, ProcSig signal) {
-    if (pid < 0 || pid > MANOS_MAXPROC)
-        return 0;
+    if (pid <= 0 || pid >= MANOS_MAXPROC) {
+        errno = ESRCH;
+        return -1;
+    }
 
-    Proc* p;
+    int ret = 0;
     enterCriticalRegion();
-    p = procTable[pid];
-    p->sigPending |= signal & ~p->sigMask;
+    Proc* p = procTable[pid];
+    if (!p || p->state == ProcDead || p->state == ProcZombie || !p->signalQ) {
+        errno = ESRCH;
+        ret = -1;
+    } else {
+        for (uint32_t bit = 1; bit && ret == 0; bit <<= 1) {
+            if ((uint32_t)signal & bit)
+                ret = queueSignal(p, (ProcSig)bit);
+        }
+    }
     leaveCriticalRegion();
-    return 0;
+    return ret;
 }
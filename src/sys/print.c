@@ -15,13 +15,14 @@ int fputstr(int fd, const char* s) {
     return fputstrn(fd, s, strlen(s));
 }
 
+static char printBuf[4096];
+
 int vfprint(int fd, const char* fmt, va_list ap) {
-    static char buf[4096];
-    int ret = fmtVsnprintf(buf, sizeof buf, fmt, ap);
-    return fputstrn(fd, buf, ret);
+    int ret = fmtVsnprintf(printBuf, sizeof printBuf, fmt, ap);
+    return fputstrn(fd, printBuf, ret);
 }
 
-int fprint(int fd, const char* fmt, ...) {
+int (fprint)(int fd, const char* fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
     int ret = vfprint(fd, fmt, ap);
@@ -32,7 +33,13 @@ int fprint(int fd, const char* fmt, ...) {
 int fprintln(int fd, const char* fmt, ...) {
     va_list ap;
     va_start(ap, fmt);
-    int ret = vfprint(fd, fmt, ap);
+    int ret = fmtVsnprintf(printBuf, sizeof printBuf, fmt, ap);
     va_end(ap);
-    return ret + fputstrn(fd, "\n", 1);
+
+    /* line and newline go out in one system call */
+    IoVec iov[2] = {
+        { .base = printBuf, .len = ret }
+    ,   { .base = "\n",     .len = 1 }
+    };
+    return kwritev(fd, iov, COUNT_OF(iov));
 }
@@ -3,8 +3,8 @@
 #include <stddef.h>
 
 ptrdiff_t sysread(int fd, void* buf, size_t n) {
-    Portal* p = rp->descriptorTable[fd];
-    if (fd < 0 || !p) {
+    Portal* p = lookupFd(&rp->fds, fd);
+    if (!p) {
         errno = EBADF;
         return -1;
     }
@@ -0,0 +1,52 @@
+#include <errno.h>
+#include <manos.h>
+#include <stddef.h>
+
+/**
+ * sysreadv() - scatter a read across a list of spans
+ * @fd:  open descriptor
+ * @iov: spans to fill, in order
+ * @n:   number of spans, at most MANOS_MAXIOV
+ *
+ * Devices without a readv entry point are read span by span, stopping
+ * at the first short read.
+ *
+ * Return: bytes read, or -1 on error
+ */
+ptrdiff_t sysreadv(int fd, const IoVec* iov, unsigned n) {
+    Portal* p = lookupFd(&rp->fds, fd);
+    if (!p) {
+        errno = EBADF;
+        return -1;
+    }
+
+    if (n > MANOS_MAXIOV) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (p->device >= MANOS_MAXDEV) {
+        errno = ENODEV;
+        return -1;
+    }
+
+    Dev* dev = deviceTable[p->device];
+    if (dev->readv)
+        return dev->readv(p, iov, n, p->offset);
+
+    ptrdiff_t total = 0;
+    for (unsigned i = 0; i < n; i++) {
+        if (iov[i].len == 0)
+            continue;
+
+        ptrdiff_t bytes = dev->read(p, iov[i].base, iov[i].len, p->offset);
+        if (bytes < 0)
+            return total > 0 ? total : -1;
+
+        total += bytes;
+        if ((size_t)bytes < iov[i].len)
+            break;
+    }
+
+    return total;
+}
@@ -5,7 +5,7 @@
 
 static Proc badProc = {
     .state           = ProcDead
-,   .descriptorTable = {0}
+,   .fds             = {0}
 ,   .waitQ           = LIST_HEAD_INIT(badProc.waitQ)
 ,   .nextWaitQ       = LIST_HEAD_INIT(badProc.nextWaitQ)
 ,   .nextRunQ        = LIST_HEAD_INIT(badProc.nextRunQ)
@@ -18,32 +18,100 @@ static Proc badProc = {
 ,   .sp              = 0
 };
 
-static void processSignals(Proc* p) {
-    static char buf[32];
-    uint32_t newPending = 0; /* allow signals to generate signals */
-    if (p->sigPending & SigAbort) {
-        int len = fmtSnprintf(buf, sizeof buf, "\nKilled [%d]\n", p->pid);
-        syswrite(rp->tty, buf, len);
+static void deliverSignal(Proc* p, ProcSig sig) {
+    if (sig == SigAbort) {
+        sysklog(KlogWarn, "\nKilled [%d]\n", p->pid);
         wakeWaiting(p);
-        for (unsigned i = 0; i < COUNT_OF(p->descriptorTable); i++) {
-            syskfree(p->descriptorTable[i]);
-        }
+        listUnlinkAndInit(&p->nextWaitQ);
+        releaseFdTable(&p->fds);
+        p->exitStatus = WAIT_KILLED;
         p->state = ProcDead;
-    } else if (p->sigPending & SigStop) {
-        int len = fmtSnprintf(buf, sizeof buf, "\nStopped [%d]\n", p->pid);
-        syswrite(rp->tty, buf, len);
+    } else if (sig == SigStop) {
+        sysklog(KlogWarn, "\nStopped [%d]\n", p->pid);
         wakeWaiting(p);
         INIT_LIST_HEAD(&p->waitQ);
         p->state = ProcStopped;
-    } else if (p->sigPending & SigContinue) {
+        p->waitReported = 0;
+        if (p->ppid && procTable[p->ppid])
+            wakeUp(&procTable[p->ppid]->childQ);
+    } else if (sig == SigContinue) {
+        if (p->state != ProcStopped)
+            return;
         p->state = ProcReady;
-        listAddAfter(&procTable[p->ppid]->nextWaitQ, &p->waitQ);
-        procTable[p->ppid]->state = ProcWaiting;
-    } else if (p->sigPending & SigAlarm) {
+    } else if (sig == SigAlarm) {
         p->state = ProcReady;
     }
-    p->sigPending = newPending;
 }
+
+/*
+ * Deliver queued signals, most urgent first, until none can be. Masked
+ * signals stay queued, as do alarms for a stopped Proc until it is
+ * continued. A caught signal also has its default effect, and holds
+ * back further caught signals until its handler has run.
+ */
+static void processSignals(Proc* p) {
+    if (!p->signalQ)
+        return;
+
+    while (p->state != ProcDead) {
+        uint32_t held = p->sigMask;
+        if (p->state == ProcStopped)
+            held |= SigAlarm;
+        if (p->sigCaught || p->sigSp)
+            held |= caughtSignals(p);
+
+        ProcSig sig = takeSignal(p, held);
+        if (!sig)
+            return;
+
+        if (signalHandler(p, sig))
+            p->sigCaught = sig;
+        deliverSignal(p, sig);
+    }
+
+    flushSignals(p);
+}
+
+#define EXC_RETURN_THREAD (1u << 3)
+#define SIG_FRAME_WORDS   18  /* hardware frame, r4-r11, EXC_RETURN, SVCALLACT */
+#define SIG_STACK_MARGIN  256 /* bytes a handler is left at least */
+
+/*
+ * Start p's caught signal handler: a fresh context is built under the
+ * one saved, entering the handler with the signal in r0 and returning
+ * into ksigreturn(), which resumes the saved context. A Proc switched
+ * out inside a system call gets its handler once it is back in thread
+ * mode.
+ */
+static void startSignalHandler(Proc* p) {
+    uint32_t* saved = (uint32_t*)(uintptr_t)p->sp;
+    if (saved[0] != 0 || !(saved[9] & EXC_RETURN_THREAD))
+        return;
+
+    uint32_t* sp = (uint32_t*)((uintptr_t)saved & ~(uintptr_t)7); /* frames are 8 byte aligned */
+    if ((uintptr_t)(sp - SIG_FRAME_WORDS) < (uintptr_t)p->stack + SIG_STACK_MARGIN) {
+        p->sigCaught = 0; /* no room to run it */
+        return;
+    }
+
+    *(--sp) = 0x1000000;                                           /* XPSR */
+    *(--sp) = (uint32_t)(uintptr_t)signalHandler(p, p->sigCaught); /* PC   */
+    *(--sp) = (uint32_t)(uintptr_t)ksigreturn;                     /* LR   */
+    *(--sp) = 0x0c0c0c0c;                                          /* r12  */
+    *(--sp) = 0;                                                   /* r3   */
+    *(--sp) = 0;                                                   /* r2   */
+    *(--sp) = 0;                                                   /* r1   */
+    *(--sp) = (uint32_t)p->sigCaught;                              /* r0   */
+    *(--sp) = 0xfffffff9;                                          /* interrupt LR */
+    for (unsigned r = 8; r >= 1; r--)
+        *(--sp) = saved[r];                                        /* r11-r4, r9 stays the static base */
+    *(--sp) = 0x00000000;                                          /* SVCALLACT bit 0 */
+
+    p->sigSp     = p->sp;
+    p->sp        = (uint32_t)(uintptr_t)sp;
+    p->sigCaught = 0;
+}
+
 /**
  * nextRunnableProc() - return a proc to run to the caller
  *
@@ -58,16 +126,14 @@ Proc* nextRunnableProc(void) {
     enterCriticalRegion();
 
     LIST_FOR_EACH_ENTRY_SAFE(p, save, &procRunQ, nextRunQ) {
+        processSignals(p);
         if (p->state == ProcDead) {
             listUnlink(&p->nextRunQ);
-            recycleProc(p);
-        } else {
-            processSignals(p);
-            if (p->state == ProcReady) {
-                listUnlinkAndInit(&p->nextRunQ);
-                foundReady = 1;
-                break;
-            }
+            exitProc(p);
+        } else if (p->state == ProcReady) {
+            listUnlinkAndInit(&p->nextRunQ);
+            foundReady = 1;
+            break;
         }
     }
 
@@ -76,6 +142,43 @@ Proc* nextRunnableProc(void) {
     return (foundReady ? p : &badProc);
 }
 
+extern long long schedSwitchCount;
+extern long long schedFastCount;
+extern long long schedSwitchCycles;
+
+static uint32_t switchStart; /* CYCLE_COUNT() when the current switch began */
+
+/**
+ * scheduleFastPath() - decide if a context switch can be skipped
+ *
+ * Called by the scheduler interrupt before any Proc state is saved. If
+ * rp can keep running and nothing in procRunQ is ready, dead or has a
+ * signal to process, a full switch would only pick rp again.
+ *
+ * Every scheduler interrupt passes through here, so it also keeps the
+ * kernel log moving: a console with a transmit interrupt is only kicked,
+ * any other is fed a little of it.
+ *
+ * Return: 1 to resume rp untouched, 0 to go through scheduleProc()
+ */
+int __attribute__((used)) scheduleFastPath(void) {
+    drainKlog(MANOS_KLOG_DRAIN);
+    switchStart = CYCLE_COUNT();
+
+    if (!rp || rp == &badProc || rp->state != ProcRunning || rp->sigReturning ||
+        (rp->sigPending & ~rp->sigMask))
+        return 0;
+
+    Proc* p;
+    LIST_FOR_EACH_ENTRY(p, &procRunQ, nextRunQ) {
+        if (p->state == ProcReady || p->state == ProcDead || (p->sigPending & ~p->sigMask))
+            return 0;
+    }
+
+    schedFastCount++;
+    return 1;
+}
+
 /**
  * scheduleProc() - this is an arch independent scheduler routine
  *
@@ -91,9 +194,20 @@ uint32_t __attribute__((used)) scheduleProc(uint32_t sp) {
             rp->state = ProcReady;
         }
         processSignals(rp);
-        listAddBefore(&rp->nextRunQ, &procRunQ);
-        rp->sp = sp;
-    } 
+        if (rp->state == ProcDead) {
+            /* reap on exit, the stack we are on is not reused before the switch */
+            exitProc(rp);
+        } else {
+            listAddBefore(&rp->nextRunQ, &procRunQ);
+            rp->sp = sp;
+            if (rp->sigReturning) {
+                /* the handler is done, resume what it interrupted */
+                rp->sp = rp->sigSp;
+                rp->sigSp = 0;
+                rp->sigReturning = 0;
+            }
+        }
+    }
 
     rp = &badProc;
     while (rp == &badProc) {
@@ -103,22 +217,28 @@ uint32_t __attribute__((used)) scheduleProc(uint32_t sp) {
     ASSERT(*rp->canary1 == *rp->canary2 && "scheduleProc() new proc canaries are not equal");
     ASSERT(rp->sp < (uintptr_t)rp->canary2 && "scheduleProc() new proc sp below canary");
     rp->state = ProcRunning;
+    if (rp->sigCaught && !rp->sigSp)
+        startSignalHandler(rp);
+    switchMpu(rp);
+    schedSwitchCount++;
+    schedSwitchCycles += CYCLE_COUNT() - switchStart;
     RESET_SYSTICK();
     START_SYSTICK();
     return rp->sp;
 }
 
 int syssleep(long millis) {
-    char duration[21] = {0};
-    fmtSnprintf(duration, sizeof duration, "%ld", millis);
-    int fd = sysopen("/dev/timer/k70MilliTimer", CAP_WRITE);
-    ptrdiff_t status = syswrite(fd, duration, strlen(duration));
-    sysclose(fd);
-    if (status > 0) {
-        enterCriticalRegion();
-        rp->state = ProcWaiting;
-        YIELD();
+    enterCriticalRegion();
+    int alarm = armWakeAlarm(rp->pid, millis);
+    if (alarm == -1) {
         leaveCriticalRegion();
+        return -1;
     }
-    return status;
+
+    rp->state = ProcWaiting;
+    YIELD();
+    leaveCriticalRegion();
+
+    cancelAlarm(alarm); /* in case something else woke us first */
+    return 0;
 }
@@ -44,24 +44,3 @@ void sysnputs(const char* s, size_t n) {
     }
 
 }
-
-int sysprintln(const char* fmt, ...) {
-    va_list ap;
-    static char buf[1024];
-    va_start(ap, fmt);
-    int ret = fmtVsnprintf(buf, sizeof buf, fmt, ap);
-    va_end(ap);
-    sysputs(buf);
-    sysputs("\n");
-    return ret + 1;
-}
-
-int sysprint(const char* fmt, ...) {
-    va_list ap;
-    static char buf[1024];
-    va_start(ap, fmt);
-    int ret = fmtVsnprintf(buf, sizeof buf, fmt, ap);
-    va_end(ap);
-    sysputs(buf);
-    return ret;
-}
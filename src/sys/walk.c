@@ -35,6 +35,7 @@ Portal* syswalk(Portal* p, char **path, unsigned n) {
             closePortal(px);
             syskfree(px);
             ASSERT(idx != -1 && "Crumb has an unknown device id");
+            bringUpDevice(idx);
             px = deviceTable[idx]->attach(ni.contents ? ni.contents : "");
             freeWalkTrail(t);
             continue;
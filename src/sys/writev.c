@@ -0,0 +1,52 @@
+#include <errno.h>
+#include <manos.h>
+#include <stddef.h>
+
+/**
+ * syswritev() - gather a write from a list of spans
+ * @fd:  open descriptor
+ * @iov: spans to write, in order
+ * @n:   number of spans, at most MANOS_MAXIOV
+ *
+ * Devices without a writev entry point are written span by span,
+ * stopping at the first short write.
+ *
+ * Return: bytes written, or -1 on error
+ */
+ptrdiff_t syswritev(int fd, const IoVec* iov, unsigned n) {
+    Portal* p = lookupFd(&rp->fds, fd);
+    if (!p) {
+        errno = EBADF;
+        return -1;
+    }
+
+    if (n > MANOS_MAXIOV) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    if (p->device >= MANOS_MAXDEV) {
+        errno = ENODEV;
+        return -1;
+    }
+
+    Dev* dev = deviceTable[p->device];
+    if (dev->writev)
+        return dev->writev(p, iov, n, p->offset);
+
+    ptrdiff_t total = 0;
+    for (unsigned i = 0; i < n; i++) {
+        if (iov[i].len == 0)
+            continue;
+
+        ptrdiff_t bytes = dev->write(p, iov[i].base, iov[i].len, p->offset);
+        if (bytes < 0)
+            return total > 0 ? total : -1;
+
+        total += bytes;
+        if ((size_t)bytes < iov[i].len)
+            break;
+    }
+
+    return total;
+}
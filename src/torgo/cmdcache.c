@@ -0,0 +1,272 @@
+/**
+ * cmdcache.c
+ * Compiled command cache.
+ *
+ * Remembers the commands each source line parsed into, so a line which
+ * is run again (a loop in a script, a repeated command) skips the
+ * parser, and where each command name was found on the search path, so
+ * spawning it skips the path walk. Lines parse the same whatever the
+ * environment, so they are never stale; targets are flushed by the
+ * shell when PATH changes or on 'rehash'.
+ */
+
+#include <string.h>
+
+#include <manos.h>
+
+#include <torgo/cmdcache.h>
+#include <torgo/dstring.h>
+#include <torgo/parser.h>
+
+#define CMDCACHE_BUCKETS 32 /* power of two */
+#define CMDCACHE_LINES   64 /* lines kept before the line cache is flushed */
+
+/*
+ * mkCmdTemplate :: ParseResult -> CmdTemplate
+ *
+ * Copy the tokens of a complete ParseResult into a CmdTemplate.
+ */
+CmdTemplate* mkCmdTemplate(ParseResult *result) {
+  CmdTemplate *tmpl = kmalloc(sizeof *tmpl);
+  if (! tmpl) return NULL;
+
+  tmpl->argc = getLengthParseResult(result);
+  tmpl->argv = kmalloc((tmpl->argc + 1) * sizeof *tmpl->argv);
+  tmpl->expand = kmalloc(tmpl->argc + 1);
+  tmpl->op = kmalloc(tmpl->argc + 1);
+  tmpl->next = NULL;
+  if (! tmpl->argv || ! tmpl->expand || ! tmpl->op) {
+    kfree(tmpl->argv);
+    kfree(tmpl->expand);
+    kfree(tmpl->op);
+    kfree(tmpl);
+    return NULL;
+  }
+
+  ParseTokenIterator *tokens = getParseTokenIteratorParseResult(result);
+  int i;
+  for (i = 0; i < tmpl->argc; i++) {
+    tmpl->op[i] = isOpParseTokenIterator(tokens);
+    const String *token = getNextParseTokenIterator(tokens);
+    tmpl->argv[i] = copyString(token);
+    if (! tmpl->argv[i]) break;
+    tmpl->expand[i] = ! tmpl->op[i] && memchr(token->str, '$', token->size) != NULL;
+  }
+  freeParseTokenIterator(tokens);
+
+  if (i < tmpl->argc) {
+    tmpl->argc = i;
+    freeCmdTemplate(tmpl);
+    return NULL;
+  }
+
+  return tmpl;
+}
+
+/*
+ * freeCmdTemplate :: CmdTemplate -> ()
+ *
+ * Release a CmdTemplate and the commands chained after it.
+ */
+void freeCmdTemplate(CmdTemplate *tmpl) {
+  while (tmpl) {
+    CmdTemplate *next = tmpl->next;
+    for (int i = 0; i < tmpl->argc; i++)
+      freeString(tmpl->argv[i]);
+    kfree(tmpl->argv);
+    kfree(tmpl->expand);
+    kfree(tmpl->op);
+    kfree(tmpl);
+    tmpl = next;
+  }
+}
+
+/*
+ * CacheEntry = (String, UInt32, CmdTemplate | String, CacheEntry)
+ *
+ * A cached line and its commands, or a command name and its path.
+ */
+typedef struct CacheEntry {
+  String*            key;
+  uint32_t           hash;
+  union {
+    CmdTemplate*     cmds;
+    String*          path;
+  };
+  struct CacheEntry* next;
+} CacheEntry;
+
+/*
+ * CmdCache = ([[CacheEntry]], [[CacheEntry]])
+ */
+struct CmdCache {
+  CacheEntry* lines[CMDCACHE_BUCKETS];
+  CacheEntry* targets[CMDCACHE_BUCKETS];
+  unsigned    lineCount;
+};
+
+CmdCache* mkCmdCache(void) {
+  CmdCache *cache = kmalloc(sizeof *cache);
+  if (! cache) return NULL;
+
+  memset(cache, 0, sizeof *cache);
+  return cache;
+}
+
+static void flushLinesCmdCache(CmdCache *cache) {
+  for (unsigned i = 0; i < CMDCACHE_BUCKETS; i++) {
+    while (cache->lines[i]) {
+      CacheEntry *e = cache->lines[i];
+      cache->lines[i] = e->next;
+      freeString(e->key);
+      freeCmdTemplate(e->cmds);
+      kfree(e);
+    }
+  }
+  cache->lineCount = 0;
+}
+
+/*
+ * flushTargetsCmdCache :: CmdCache -> ()
+ *
+ * Forget every resolved command target.
+ */
+void flushTargetsCmdCache(CmdCache *cache) {
+  for (unsigned i = 0; i < CMDCACHE_BUCKETS; i++) {
+    while (cache->targets[i]) {
+      CacheEntry *e = cache->targets[i];
+      cache->targets[i] = e->next;
+      freeString(e->key);
+      freeString(e->path);
+      kfree(e);
+    }
+  }
+}
+
+void freeCmdCache(CmdCache *cache) {
+  if (! cache) return;
+
+  flushLinesCmdCache(cache);
+  flushTargetsCmdCache(cache);
+  kfree(cache);
+}
+
+/*
+ * findCmdCache :: [[CacheEntry]] -> String -> CacheEntry
+ */
+static CacheEntry* findCmdCache(CacheEntry **buckets, const String *key) {
+  uint32_t hash = hashString(key);
+  for (CacheEntry *e = buckets[hash & (CMDCACHE_BUCKETS - 1)]; e; e = e->next) {
+    if (e->hash == hash && matchString(e->key, key))
+      return e;
+  }
+  return NULL;
+}
+
+/*
+ * insertCmdCache :: [[CacheEntry]] -> String -> CacheEntry
+ *
+ * Link a new entry for 'key', which must not already be present.
+ */
+static CacheEntry* insertCmdCache(CacheEntry **buckets, const String *key) {
+  CacheEntry *e = kmalloc(sizeof *e);
+  if (! e) return NULL;
+
+  e->key = copyString(key);
+  if (! e->key) {
+    kfree(e);
+    return NULL;
+  }
+
+  CacheEntry **bucket = &buckets[(e->hash = hashString(key)) & (CMDCACHE_BUCKETS - 1)];
+  e->next = *bucket;
+  *bucket = e;
+  return e;
+}
+
+/*
+ * lookupLineCmdCache :: CmdCache -> String -> CmdTemplate
+ *
+ * The commands 'line' parsed into when last seen, or NULL.
+ */
+const CmdTemplate* lookupLineCmdCache(CmdCache *cache, const String *line) {
+  CacheEntry *e = findCmdCache(cache->lines, line);
+  return e ? e->cmds : NULL;
+}
+
+/*
+ * addLineCmdCache :: CmdCache -> String -> CmdTemplate -> CmdTemplate
+ *
+ * Remember the commands 'line' parsed into. The cache takes 'cmds', and
+ * frees them if they cannot be stored. When full the whole line cache
+ * is dropped, the working set of a script loop is small.
+ */
+const CmdTemplate* addLineCmdCache(CmdCache *cache, const String *line, CmdTemplate *cmds) {
+  if (findCmdCache(cache->lines, line)) {
+    freeCmdTemplate(cmds);
+    return NULL;
+  }
+
+  if (cache->lineCount == CMDCACHE_LINES)
+    flushLinesCmdCache(cache);
+
+  CacheEntry *e = insertCmdCache(cache->lines, line);
+  if (! e) {
+    freeCmdTemplate(cmds);
+    return NULL;
+  }
+
+  e->cmds = cmds;
+  cache->lineCount++;
+  return cmds;
+}
+
+/*
+ * lookupTargetCmdCache :: CmdCache -> String -> String
+ *
+ * The path command 'name' was resolved to, or NULL.
+ */
+const String* lookupTargetCmdCache(CmdCache *cache, const String *name) {
+  CacheEntry *e = findCmdCache(cache->targets, name);
+  return e ? e->path : NULL;
+}
+
+/*
+ * addTargetCmdCache :: CmdCache -> String -> String -> String
+ *
+ * Remember that command 'name' resolved to 'path'.
+ */
+const String* addTargetCmdCache(CmdCache *cache, const String *name, const String *path) {
+  String *copy = copyString(path);
+  if (! copy) return NULL;
+
+  CacheEntry *e = findCmdCache(cache->targets, name);
+  if (e) {
+    freeString(e->path);
+  } else if (! (e = insertCmdCache(cache->targets, name))) {
+    freeString(copy);
+    return NULL;
+  }
+
+  e->path = copy;
+  return copy;
+}
+
+/*
+ * dropTargetCmdCache :: CmdCache -> String -> ()
+ *
+ * Forget where 'name' was found, as when spawning it failed.
+ */
+void dropTargetCmdCache(CmdCache *cache, const String *name) {
+  uint32_t hash = hashString(name);
+  for (CacheEntry **link = &cache->targets[hash & (CMDCACHE_BUCKETS - 1)]; *link; link = &(*link)->next) {
+    CacheEntry *e = *link;
+    if (e->hash == hash && matchString(e->key, name)) {
+      *link = e->next;
+      freeString(e->key);
+      freeString(e->path);
+      kfree(e);
+      return;
+    }
+  }
+}
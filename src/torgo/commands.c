@@ -1,15 +1,20 @@
 #include <torgo/commands.h>
 
+/*
+ * Stack sizes stay 0, the default, until each command has been measured
+ * on the board with the high water mark 'ps' reports.
+ */
 CmdTable builtinCmds[] = {
-    { "cat", cmdCat__Main }
-,   { "ls",  cmdLs__Main }
-,   { "pwd", cmdPwd__Main }
-,   { "echo", cmdEcho__Main }
-,   { "date", cmdDate__Main }
-,   { "toast", cmdToast__Main }
-,   { "sh", torgo_main }
-,   { "lsmem", cmdLsmem__Main }
-,   { "ps", cmdPs__Main }
-,   { "fg", cmdFg__Main }
-,   { "fizzbuzz", cmdFizzbuzz__Main }
+    { "cat", cmdCat__Main, 0 }
+,   { "ls",  cmdLs__Main, 0 }
+,   { "pwd", cmdPwd__Main, 0 }
+,   { "echo", cmdEcho__Main, 0 }
+,   { "date", cmdDate__Main, 0 }
+,   { "toast", cmdToast__Main, 0 }
+,   { "sh", torgo_main, 0 }
+,   { "lsmem", cmdLsmem__Main, 0 }
+,   { "ps", cmdPs__Main, 0 }
+,   { "fg", cmdFg__Main, 0 }
+,   { "fizzbuzz", cmdFizzbuzz__Main, 0 }
+,   { "env", cmdEnv__Main, 0 }
 };
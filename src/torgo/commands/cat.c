@@ -1,15 +1,18 @@
 #include <manos.h>
 #include <inttypes.h>
 
-int cmdCat__Main(int argc, char * const argv[]) {
-    if (argc < 2) {
-        fprintln(rp->tty, "usage: cat [OPTIONS] PATH");
-        fprintln(rp->tty, "\nOPTIONS:\n");
-        fprintln(rp->tty, "  -x                Read in 4 byte chunks and print as hex");
-        fprintln(rp->tty, "  -n                Emit newlines after each read");
-        return -1;
-    }
+#define CAT_BLOCK 64 /* bytes per read, a multiple of 4 */
 
+static int usage(void) {
+    fprintln(rp->tty, "usage: cat [OPTIONS] [PATH]");
+    fprintln(rp->tty, "\nReads standard input when PATH is not given.");
+    fprintln(rp->tty, "\nOPTIONS:\n");
+    fprintln(rp->tty, "  -x                Read in 4 byte chunks and print as hex");
+    fprintln(rp->tty, "  -n                Emit newlines after each read");
+    return -1;
+}
+
+int cmdCat__Main(int argc, char * const argv[]) {
     char* path = NULL;
     int inHex = 0;
     int withNewlines = 0;
@@ -21,6 +24,8 @@ int cmdCat__Main(int argc, char * const argv[]) {
                 inHex = 1;
             } else if (*(argv[i]+1) == 'n') {
                 withNewlines = 1;
+            } else {
+                return usage();
             }
             break;
         default:
@@ -32,20 +37,50 @@ int cmdCat__Main(int argc, char * const argv[]) {
 
     int sw1 = kopen("/dev/swpb/1", CAP_READ);
 
-    NodeInfo ni;
-    int fd = kopen(path, CAP_READ);
-    kfstat(fd, &ni);
+    int fd = path ? kopen(path, CAP_READ) : rp->in;
+    if (fd < 0) {
+        fprintln(rp->tty, "Cannot read %s", path);
+        kclose(sw1);
+        return -1;
+    }
 
-    uint32_t x;
-    char c;
-    while (kread(fd, &x, inHex ? sizeof x : 1)) {
-        if (inHex)
-            fprint(rp->tty, "0x%" PRIx32 "", x);
-        else
-            fputchar(rp->tty, x);
+    /* a console read waits for the whole count, so take it a unit at a time */
+    NodeInfo ni, tty;
+    int console = kfstat(fd, &ni) == 0 && kfstat(rp->tty, &tty) == 0 && ni.device == tty.device;
+    size_t unit = inHex ? sizeof(uint32_t) : 1;
+    size_t want = console ? unit : CAT_BLOCK;
 
-        if (withNewlines) fputchar(rp->tty, '\n');
+    uint32_t block[CAT_BLOCK / sizeof(uint32_t)];
+    ptrdiff_t bytes;
+    char c;
+    while ((bytes = kread(fd, block, want)) > 0) {
+        if (inHex) {
+            for (ptrdiff_t i = 0; i < bytes / (ptrdiff_t)unit; i++) {
+                if (withNewlines)
+                    fprintln(rp->out, "0x%" PRIx32 "", block[i]);
+                else
+                    fprint(rp->out, "0x%" PRIx32 "", block[i]);
+            }
+        } else if (withNewlines) {
+            /* each byte and its newline, MANOS_MAXIOV spans per call */
+            IoVec iov[MANOS_MAXIOV];
+            unsigned n = 0;
+            ptrdiff_t i;
+            for (i = 0; i < bytes; i++) {
+                iov[n++] = (IoVec){ .base = (char*)block + i, .len = 1 };
+                iov[n++] = (IoVec){ .base = "\n",            .len = 1 };
+                if ((n == MANOS_MAXIOV || i + 1 == bytes) && kwritev(rp->out, iov, n) < 0)
+                    break;
+                if (n == MANOS_MAXIOV)
+                    n = 0;
+            }
+            if (i < bytes)
+                break; /* reader went away */
+        } else if (kwrite(rp->out, block, bytes) < 0) {
+            break; /* reader went away */
+        }
 
+        /* the stop button is checked once per block, not per byte */
         c = 0;
         kread(sw1, &c, 1);
         if (c == '0')
@@ -53,6 +88,7 @@ int cmdCat__Main(int argc, char * const argv[]) {
     }
 
     kclose(sw1);
-    kclose(fd);
+    if (path)
+        kclose(fd);
     return 0;
 }
@@ -26,6 +26,6 @@ int cmdDate__Main(int argc, char * const argv[]) {
     kread(fd, &date, sizeof date);
     kclose(fd);
 
-    fprint(rp->tty, "%s %d, %d %02d:%02d:%02d\n", months[date.month], date.day, date.year, date.hours, date.minutes, date.seconds);
+    fprint(rp->out, "%s %d, %d %02d:%02d:%02d\n", months[date.month], date.day, date.year, date.hours, date.minutes, date.seconds);
     return 0;
 }
@@ -1,4 +1,5 @@
 #include <manos.h>
+#include <string.h>
 
 /*
  * HACK ALERT. We don't have shell io redirection yet.
@@ -26,7 +27,7 @@ int cmdEcho__Main(int argc, char * const argv[]) {
         }
     }
 
-    int fd = rp->tty;
+    int fd = rp->out;
     if (out) {
         int fd2 = kopen(out, CAP_WRITE);
         if (fd2 < 0) {
@@ -36,11 +37,24 @@ int cmdEcho__Main(int argc, char * const argv[]) {
         fd = fd2;
     }
 
+    /* gather the words and separators, one system call per MANOS_MAXIOV spans */
+    IoVec iov[MANOS_MAXIOV];
+    unsigned n = 0;
     for (int i = 1; i < elems; i++) {
-        if (i > 1) fputchar(fd, ' ');
-        fputstr(fd, argv[i]);
+        if (n + 3 > COUNT_OF(iov)) { /* separator, word and the newline */
+            kwritev(fd, iov, n);
+            n = 0;
+        }
+        if (i > 1) {
+            iov[n].base = " ";
+            iov[n++].len = 1;
+        }
+        iov[n].base = argv[i];
+        iov[n++].len = strlen(argv[i]);
     }
-    fputchar(fd, '\n');
+    iov[n].base = "\n";
+    iov[n++].len = 1;
+    kwritev(fd, iov, n);
 
     if (out)
         kclose(fd);
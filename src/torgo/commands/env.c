@@ -0,0 +1,14 @@
+#include <manos.h>
+
+/*
+ * Print the environment this Proc was spawned with, one
+ * "name=value" per line.
+ */
+int cmdEnv__Main(int argc, char * const argv[]) {
+    UNUSED(argc);
+    UNUSED(argv);
+    Environ* env = rp->env;
+    for (unsigned i = 0; env && i < env->count; i++)
+        fprintln(rp->out, "%s", env->envp[i]);
+    return 0;
+}
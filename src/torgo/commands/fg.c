@@ -6,6 +6,6 @@ int cmdFg__Main(int argc, char** argv) {
         return 1;
     }
 
-    syspostsignal(atoi(argv[1]), SigContinue);
+    postsignal(atoi(argv[1]), SigContinue);
     return 0;
 }
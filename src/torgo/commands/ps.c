@@ -23,16 +23,20 @@ void printProc(Proc* p) {
     case ProcStopped:
         state = "Stop";
         break;
+    case ProcZombie:
+        state = "Zombie";
+        break;
     default:
         state = "Unknown";
         break;
     }
-    fprintln(rp->tty, "%d\t%d\t%d\t%s\t%s", p->pid, p->pgrp->pgid, p->ppid, state, p->argv[0]);
+    fprintln(rp->out, "%d\t%d\t%d\t%s\t%u/%u\t%s", p->pid, p->pgrp->pgid, p->ppid, state,
+             (unsigned)stackHighWater(p), (unsigned)p->stackSize, p->argv[0]);
 }
 
 int cmdPs__Main(int argc, char * const argv[]) {
     Proc* p;
-    fprintln(rp->tty, "PID\tPGID\tPPID\tSTATE\tCMD");
+    fprintln(rp->out, "PID\tPGID\tPPID\tSTATE\tSTACK\tCMD");
     lock(&runQLock);
     printProc(rp);
     LIST_FOR_EACH_ENTRY(p, &procRunQ, nextRunQ) {
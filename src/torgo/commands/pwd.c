@@ -5,6 +5,6 @@ int cmdPwd__Main(int argc, char * const argv[]) {
     UNUSED(argv);
     char buf[4096];
     getcwd(buf, sizeof buf);
-    fprintln(rp->tty, buf);
+    fprintln(rp->out, buf);
     return 0;
 }
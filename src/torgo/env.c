@@ -3,59 +3,136 @@
  * Shell environment
  */
 
+#include <stdint.h>
+#include <string.h>
+
 #include <manos.h>
 
 #include <torgo/env.h>
 #include <torgo/dstring.h>
 
+#define ENV_BUCKETS    32 /* power of two */
+#define INTERN_BUCKETS 64 /* power of two */
+
+/*
+ * Atom = (String, UInt32, Atom)
+ *
+ * An interned variable name. Every Env shares the one table, so two
+ * names are equal exactly when their Atoms are, and a name that was
+ * never interned cannot be set anywhere. Atoms live as long as the
+ * shell; variable names are few.
+ */
+typedef struct Atom {
+  String*      name;
+  uint32_t     hash;
+  struct Atom* next;
+} Atom;
+
+static Atom* atoms[INTERN_BUCKETS];
+
+/*
+ * findAtom :: String -> UInt32 -> Atom
+ *
+ * Lookup the Atom for 'name', NULL if it was never interned.
+ */
+static Atom* findAtom(const String *name, uint32_t hash) {
+  for (Atom *a = atoms[hash & (INTERN_BUCKETS - 1)]; a; a = a->next) {
+    if (a->hash == hash && matchString(a->name, name))
+      return a;
+  }
+  return NULL;
+}
+
+/*
+ * internAtom :: String -> UInt32 -> Atom
+ *
+ * As findAtom, but copies 'name' into a new Atom when missing.
+ */
+static Atom* internAtom(const String *name, uint32_t hash) {
+  Atom *a = findAtom(name, hash);
+  if (a) return a;
+
+  a = kmalloc(sizeof *a);
+  if (! a) return NULL;
+
+  a->name = copyString(name);
+  if (! a->name) {
+    kfree(a);
+    return NULL;
+  }
+
+  Atom **bucket = &atoms[hash & (INTERN_BUCKETS - 1)];
+  a->hash = hash;
+  a->next = *bucket;
+  *bucket = a;
+  return a;
+}
+
 /*
- * EnvVar = (String, String, EnvVar)
+ * EnvVar = (Atom, String, Int, Bool, EnvVar)
  *
  * Stores the name and value of a shell environment variable.
  * Set with the shell command "set 'name' = 'value';"
+ * The value buffer is reused in place when the new value fits.
  */
 typedef struct EnvVar {
-  String*        name;
-  String*        value;
+  Atom*          atom;
+  String         value;
+  size_t         capacity;
+  int            exported;
   struct EnvVar* next;
 } EnvVar;
 
 /*
- * mkEnvVar :: String -> String -> EnvVar
+ * setValueEnvVar :: EnvVar -> String -> Bool
  *
- * Allocate a new EnvVar, and copy the 'name' and 'value' passed into it.
+ * Replace the value of 'var', growing its buffer only when needed.
  */
-EnvVar* mkEnvVar(const String *name, const String *value) {
-  EnvVar *var = kmalloc(sizeof *var);
-  if (! var) return NULL;
+static int setValueEnvVar(EnvVar *var, const String *value) {
+  char *buf = (char*)var->value.str;
+
+  if (value->size + 1 > var->capacity) {
+    buf = kmalloc(value->size + 1);
+    if (! buf) return 0;
+    memcpy(buf, value->str, value->size);
+    kfree((void*)var->value.str);
+    var->capacity = value->size + 1;
+  } else {
+    memmove(buf, value->str, value->size);
+  }
 
-  var->name = copyString(name);
-  var->value = copyString(value);
-  var->next = NULL;
-  return var;
+  buf[value->size] = '\0';
+  var->value.str = buf;
+  var->value.size = value->size;
+  return 1;
 }
 
 /*
  * freeEnvVar :: EnvVar -> ()
  *
- * Release memory associated with the EnvVar
+ * Release memory associated with the EnvVar, the Atom is kept.
  */
-void freeEnvVar(EnvVar *var) {
-  freeString(var->name);
-  freeString(var->value);
+static void freeEnvVar(EnvVar *var) {
+  kfree((void*)var->value.str);
   kfree(var);
 }
 
 /*
- * Env = [EnvVar]
+ * Env = [[EnvVar]]
+ *
+ * Hash table of EnvVar chains keyed on interned names, so lookups
+ * compare pointers rather than strings. Setting a variable updates it
+ * where it is; nothing is shadowed.
  *
- * Maintains a list of EnvVar pairs.
- * Storage is a linked list with new values appended to
- * the front of the list. So that variables can be shadowed
- * easily (at the cost of wasted space).
+ * 'exports' caches the Environ handed to children, and is dropped
+ * whenever an exported variable changes.
  */
 struct Env {
-  struct EnvVar *vars;
+  EnvVar*  buckets[ENV_BUCKETS];
+  unsigned count;
+  unsigned exportCount;
+  size_t   exportBytes;
+  Environ* exports;
 };
 
 /*
@@ -65,21 +142,40 @@ struct Env {
  */
 Env* mkEnv(void) {
   Env *env = kmalloc(sizeof *env);
-  env->vars = NULL;
+  if (! env) return NULL;
+
+  memset(env, 0, sizeof *env);
   return env;
 }
 
+/*
+ * staleExportsEnv :: Env -> ()
+ *
+ * Forget the cached export snapshot, children holding it keep theirs.
+ */
+static void staleExportsEnv(Env *env) {
+  releaseEnviron(env->exports);
+  env->exports = NULL;
+}
+
 /*
  * clearEnv :: Env -> ()
  *
  * Clear the internal memory of the Env
  */
 void clearEnv(Env *env) {
-  while (env->vars) {
-    struct EnvVar *v = env->vars->next;
-    freeEnvVar(env->vars);
-    env->vars = v;
+  for (unsigned i = 0; i < ENV_BUCKETS; i++) {
+    while (env->buckets[i]) {
+      EnvVar *v = env->buckets[i]->next;
+      freeEnvVar(env->buckets[i]);
+      env->buckets[i] = v;
+    }
   }
+
+  env->count = 0;
+  env->exportCount = 0;
+  env->exportBytes = 0;
+  staleExportsEnv(env);
 }
 
 /*
@@ -88,86 +184,164 @@ void clearEnv(Env *env) {
  * Release the memory allocated to the Env
  */
 void freeEnv(Env *env) {
+  if (! env) return;
+
   clearEnv(env);
   kfree(env);
 }
 
 /*
- * addEnvVar :: Env -> String -> String -> String
+ * findVarEnv :: Env -> String -> EnvVar
  *
- * Adds the 'name', 'value' pair to the environment. 
- * Returns the 'name' (new address) on success. NULL on failure.
+ * Lookup the EnvVar for 'name', NULL if it is not set.
  */
-const String* addVarEnv(Env *env, const String *name, const String *value) {
-  EnvVar *var = mkEnvVar(name, value);
+static EnvVar* findVarEnv(Env *env, const String *name) {
+  uint32_t hash = hashString(name);
+  Atom *atom = findAtom(name, hash);
+  if (! atom) return NULL;
+
+  for (EnvVar *var = env->buckets[hash & (ENV_BUCKETS - 1)]; var; var = var->next) {
+    if (var->atom == atom)
+      return var;
+  }
+  return NULL;
+}
+
+/*
+ * updateVarEnv :: Env -> String -> String -> String
+ *
+ * Set 'name' to 'value', in place if 'name' is already set.
+ * Returns the stored value on success. NULL on failure.
+ */
+const String* updateVarEnv(Env *env, const String *name, const String *value) {
+  EnvVar *var = findVarEnv(env, name);
+
+  if (var) {
+    size_t oldSize = var->value.size;
+    if (! setValueEnvVar(var, value)) return NULL;
+
+    if (var->exported) {
+      env->exportBytes += value->size - oldSize;
+      staleExportsEnv(env);
+    }
+    return &var->value;
+  }
+
+  uint32_t hash = hashString(name);
+  Atom *atom = internAtom(name, hash);
+  if (! atom) return NULL;
+
+  var = kmalloc(sizeof *var);
   if (! var) return NULL;
 
-  var->next = env->vars;
-  env->vars = var;
-  return var->name;
+  var->atom = atom;
+  var->value.str = NULL;
+  var->value.size = 0;
+  var->capacity = 0;
+  var->exported = 0;
+  if (! setValueEnvVar(var, value)) {
+    kfree(var);
+    return NULL;
+  }
+
+  EnvVar **bucket = &env->buckets[hash & (ENV_BUCKETS - 1)];
+  var->next = *bucket;
+  *bucket = var;
+  env->count++;
+  return &var->value;
+}
+
+/*
+ * addVarEnv :: Env -> String -> String -> String
+ *
+ * Adds the 'name', 'value' pair to the environment, replacing any
+ * previous value. Returns the interned 'name' on success. NULL on failure.
+ */
+const String* addVarEnv(Env *env, const String *name, const String *value) {
+  if (! updateVarEnv(env, name, value)) return NULL;
+
+  return findAtom(name, hashString(name))->name;
 }
 
 /*
  * lookupVarEnv :: Env -> String -> String
  *
- * Lookup 'name' in 'env' by searching down the list of vars.
+ * Lookup 'name' in 'env'.
  * If 'name' is found, the value is returned. Otherwise NULL.
  */
 const String* lookupVarEnv(Env *env, const String *name) {
-  EnvVar *vars = env->vars;
-  while (vars) {
-    if (matchString(vars->name, name))
-      return vars->value;
-
-    vars = vars->next;
-  }
-
-  return NULL;
+  EnvVar *var = findVarEnv(env, name);
+  return var ? &var->value : NULL;
 }
 
 /*
- * updateEnvVar :: Env -> String -> String
+ * unsetVarEnv :: Env -> String -> ()
  *
- * Lookup 'name' in 'env' and replace it with the new value.
+ * Remove 'name' from vars.
  */
-const String* updateVarEnv(Env *env, const String *name, const String *value) {
-  EnvVar *stub = mkEnvVar(name, value);
-  if (! stub) return NULL;
-
-  EnvVar *vars = env->vars;
-  while (vars) {
-    if (matchString(vars->name, name)) {
-      String *old = vars->value;
-      vars->value = stub->value;
-      stub->value = old;
-      freeEnvVar(stub);
-      return value;
+void unsetVarEnv(Env *env, const String *name) {
+  uint32_t hash = hashString(name);
+  Atom *atom = findAtom(name, hash);
+  if (! atom) return;
+
+  for (EnvVar **link = &env->buckets[hash & (ENV_BUCKETS - 1)]; *link; link = &(*link)->next) {
+    EnvVar *var = *link;
+    if (var->atom != atom)
+      continue;
+
+    if (var->exported) {
+      env->exportCount--;
+      env->exportBytes -= atom->name->size + var->value.size + 2;
+      staleExportsEnv(env);
     }
+
+    *link = var->next;
+    env->count--;
+    freeEnvVar(var);
+    return;
   }
+}
+
+/*
+ * exportVarEnv :: Env -> String -> Int
+ *
+ * Mark 'name' to be passed on to children. Returns 0 on success, -1 if
+ * 'name' is not set.
+ */
+int exportVarEnv(Env *env, const String *name) {
+  EnvVar *var = findVarEnv(env, name);
+  if (! var) return -1;
 
-  stub->next = env->vars;
-  env->vars = stub;
-  return stub->value;
+  if (! var->exported) {
+    var->exported = 1;
+    env->exportCount++;
+    env->exportBytes += var->atom->name->size + var->value.size + 2;
+    staleExportsEnv(env);
+  }
+  return 0;
 }
 
 /*
- * unsetVarEnv :: Env -> String -> ()
+ * exportsEnv :: Env -> Environ
  *
- * Remove 'name' from vars. This removes all instances in the list.
+ * The exported variables as an Environ for kspawn. The snapshot is
+ * built once and shared until an exported variable changes, so each
+ * spawn after the first only takes a reference. The caller owns the
+ * returned reference and must releaseEnviron it.
  */
-void unsetVarEnv(Env *env, const String *name) {
-  EnvVar *dummy = env->vars;
-  env->vars = dummy;
-
-  while (dummy->next) {
-    if (matchString(dummy->next->name, name)) {
-      EnvVar *delete = dummy->next;
-      dummy->next = dummy->next->next;
-      freeEnvVar(delete);
-    } else {
-      dummy->next = dummy->next->next;
+Environ* exportsEnv(Env *env) {
+  if (! env->exports) {
+    Environ *e = mkEnviron(env->exportCount, env->exportBytes);
+    if (! e) return NULL;
+
+    for (unsigned i = 0; i < ENV_BUCKETS; i++) {
+      for (EnvVar *var = env->buckets[i]; var; var = var->next) {
+        if (var->exported)
+          appendEnviron(e, var->atom->name->str, var->atom->name->size, var->value.str, var->value.size);
+      }
     }
+    env->exports = e;
   }
 
-  env->vars = dummy->next;
+  return holdEnviron(env->exports);
 }
@@ -7,15 +7,20 @@
  *  char = 0x00 | 0x01 | ... | 0x0fe | 0xff
  *  blank = " " | "\t"
  *  endCmd = ";"
+ *  pipe = "|"
  *  opToken = cmdCmd
  *  operator = "\n" | opToken
- *  metachar = blank | opToken
+ *  metachar = blank | opToken | pipe
  *  quotWord = '"' {char} '"'
  *  unquoWord = {char - metachar}
  *  word = { unquotWord | quotWord }
  *  token = word | operator
  *  command = word { blank word } operator
  *
+ *  A pipe is passed through as a token of its own, "|", marked as an
+ *  operator for the shell to split the command into pipeline stages.
+ *  A quoted "|" is a plain word.
+ *
  *  The parser proceeds by reading tokens from the input until an 'operator' is reached.
  *  The collection of tokens up to that point forms a parsed command, which is returned 
  *  to the caller.
@@ -37,10 +42,14 @@
 #include <torgo/dstring.h>
 
 /*
- * ParseToken :: (String, ParseToken)
+ * ParseToken :: (String, Bool, ParseToken)
+ *
+ * 'isOp' is set on an operator, as opposed to a word which happens to
+ * spell one.
  */
 typedef struct ParseToken {
   String*            token;
+  int                isOp;
   struct ParseToken* next;
 } ParseToken;
 
@@ -83,6 +92,15 @@ const String* getNextParseTokenIterator(ParseTokenIterator *it) {
   return token;
 }
 
+/*
+ * isOpParseTokenIterator :: ParseTokenIterator -> Bool
+ *
+ * Return True if the next token of the iterator is an operator.
+ */
+int isOpParseTokenIterator(const ParseTokenIterator *it) {
+  return it && it->token && it->token->isOp;
+}
+
 typedef enum {
   ParsedCommand,
   ParseIncomplete,
@@ -146,6 +164,7 @@ const ParseResult* mkParsedCommand(const ParseToken *tokens) {
   while (tok0) {
     ParseToken *tok = kmalloc(sizeof *tok);
     tok->token = copyString(tok0->token);
+    tok->isOp = tok0->isOp;
     tok->next = pc->data.complete.tokens;
     pc->data.complete.tokens = tok;
     pc->data.complete.length++;
@@ -420,6 +439,7 @@ const ParseResult* parseInputParser(Parser *parser) {
         if (! isEmptyCharBuf(parser->token)) {
           ParseToken *tok = kmalloc(sizeof *tok);
           tok->token = mkString(fromCharBuf(parser->token));
+          tok->isOp = 0;
           tok->next = parser->tokens;
           parser->tokens = tok;
           clearCharBuf(parser->token);
@@ -435,6 +455,15 @@ const ParseResult* parseInputParser(Parser *parser) {
           case ';':
             parser->state = ParserStateOperator;
             break;
+          case '|': {
+            ParseToken *tok = kmalloc(sizeof *tok);
+            tok->token = mkString("|");
+            tok->isOp = 1;
+            tok->next = parser->tokens;
+            parser->tokens = tok;
+            advanceInputParser(parser);
+            break;
+          }
           default:
             parser->state = ParserStateWord;
         }
@@ -452,6 +481,7 @@ const ParseResult* parseInputParser(Parser *parser) {
           case ' ':
           case '\t':
           case ';':
+          case '|':
           case '\r':
           case '\n':
             parser->state = ParserStateReady;
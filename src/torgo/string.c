@@ -118,3 +118,17 @@ int matchString(const String *a, const String *b) {
 
   return ((size_t)(aptr - a->str) == a->size);
 }
+
+/*
+ * hashString :: String -> UInt32
+ *
+ * FNV-1a over the bytes of the String.
+ */
+uint32_t hashString(const String *str) {
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < str->size; i++) {
+    h ^= (unsigned char)str->str[i];
+    h *= 16777619u;
+  }
+  return h;
+}
@@ -11,10 +11,20 @@
 #include <manos.h>
 
 #include <torgo/charbuf.h>
+#include <torgo/cmdcache.h>
 #include <torgo/commands.h>
 #include <torgo/env.h>
 #include <torgo/parser.h>
 
+/* how long a command waits for a free process slot */
+#define TORGO_SPAWN_TIMEOUT 5000
+
+/* most commands joined in one pipeline */
+#define TORGO_MAXSTAGES 8
+
+/* command search path when PATH is unset */
+#define TORGO_DEFAULT_PATH "/bin"
+
 typedef enum {
   ShellStateRun,
   ShellStateEOF,
@@ -23,6 +33,7 @@ typedef enum {
 
 typedef struct Shell {
   Env*       env;
+  CmdCache*  cache;
   Parser*    parser;
   CharBuf*   readBuf;
   ShellState state;
@@ -35,6 +46,7 @@ Shell* mkShell(void) {
   if (! shell) goto exit;
 
   shell->env = NULL;
+  shell->cache = NULL;
   shell->parser = NULL;
   shell->readBuf = NULL;
   shell->state = ShellStateRun;
@@ -42,6 +54,9 @@ Shell* mkShell(void) {
   shell->env = mkEnv();
   if (! shell->env) goto fail;
 
+  shell->cache = mkCmdCache();
+  if (! shell->cache) goto fail;
+
   shell->parser = mkParser();
   if (! shell->parser) goto fail;
 
@@ -60,6 +75,7 @@ fail:
 void freeShell(Shell *shell) {
   freeCharBuf(shell->readBuf);
   freeEnv(shell->env);
+  freeCmdCache(shell->cache);
   freeParser(shell->parser);
   free(shell);
 }
@@ -114,76 +130,375 @@ const CharBuf* readPromptShell(Shell *shell, const char *promptStr, int readMax)
 }
 
 /*
- * populateCmdArgsShell :: Env -> ParseResult -> IntPtr [Cstr]Ptr -> ()
+ * importEnvShell :: Env -> Environ -> ()
  *
- * Allocates the argv vector, and populates it from tje ParseResult.
- * Sets up 'argc' and expands variables in the process of populating
- * the vector.
+ * Seed the shell Env with the environment the shell was spawned with,
+ * each variable exported again so nested shells see it too.
  */
-int populateCmdArgsShell(Env *env, ParseResult *result, int *argc, char ***argv) {
-  int argc_ = getLengthParseResult(result);
-  char **argv_ = kmalloc((1 + argc_) * sizeof *argv_); /* sysexecv must have a NULL terminated array of pointers */
-
-  ParseTokenIterator *tokens = getParseTokenIteratorParseResult(result);
-  CharBuf *tokenBuilder = mkCharBuf(32);
-  CharBuf *varBuilder = mkCharBuf(32);
+void importEnvShell(Env *env, const Environ *snapshot) {
+  for (unsigned i = 0; snapshot && i < snapshot->count; i++) {
+    const char *entry = snapshot->envp[i];
+    const char *eq = strchr(entry, '=');
+    if (! eq) continue;
+
+    String name = { entry, eq - entry };
+    String value;
+    assignString(&value, eq + 1);
+    if (updateVarEnv(env, &name, &value))
+      exportVarEnv(env, &name);
+  }
+}
 
-  int bg = 0;
+/*
+ * builtinShell :: Shell -> Int -> [CStr] -> Bool
+ *
+ * Runs the commands which need the shell Env, and so cannot be
+ * passed off to 'exec':
+ *
+ *   set name = value
+ *   unset name
+ *   export name [= value]
+ *   rehash
+ *   fg pid
+ *
+ * Changing PATH, or 'rehash', forgets where commands were found.
+ * 'fg' continues a stopped job and waits for it as the shell waits
+ * for any command it runs.
+ *
+ * Returns 1 if argv was a builtin.
+ */
+int builtinShell(Shell *shell, int argc, char * const argv[]) {
+  String name;
+  String value;
 
-  for (int i = 0; i < argc_; i++) {
-    const String *token = getNextParseTokenIterator(tokens);
-    const char *tokenStr = fromString(token);
+  if (argc == 1 && strcmp(argv[0], "rehash") == 0) {
+    flushTargetsCmdCache(shell->cache);
+    return 1;
+  }
 
-    clearCharBuf(tokenBuilder);
+  if (argc == 2 && strcmp(argv[0], "fg") == 0) {
+    int pid = atoi(argv[1]);
+    if (postsignal(pid, SigContinue) == -1)
+      fprintln(rp->tty, "fg: no such job %s", argv[1]);
+    else
+      waitpid(pid, NULL, WAIT_UNTRACED);
+    return 1;
+  }
 
-    while (*tokenStr) {
-      switch (*tokenStr) {
-        case '$':
-          clearCharBuf(varBuilder);
-          tokenStr++;
-          if (*tokenStr == '_' || (*tokenStr >= 'a' && *tokenStr <= 'z') || (*tokenStr >= 'A' && *tokenStr <= 'Z')) {
-            while (*tokenStr == '_' || (*tokenStr >= 'a' && *tokenStr <= 'z') || (*tokenStr >= 'A' && *tokenStr <= 'Z') || (*tokenStr >= '0' && *tokenStr <= '9')) {
-              appendCharBuf(varBuilder, *tokenStr);
-              tokenStr++;
-            }
+  if (argc == 4 && strcmp(argv[0], "set") == 0 && strcmp(argv[2], "=") == 0) {
+    assignString(&name, argv[1]);
+    assignString(&value, argv[3]);
+    if (! updateVarEnv(shell->env, &name, &value))
+      fprintln(rp->tty, "set: out of memory");
+  } else if (argc == 2 && strcmp(argv[0], "unset") == 0) {
+    assignString(&name, argv[1]);
+    unsetVarEnv(shell->env, &name);
+  } else if ((argc == 2 || (argc == 4 && strcmp(argv[2], "=") == 0)) && strcmp(argv[0], "export") == 0) {
+    assignString(&name, argv[1]);
+    if (argc == 4) {
+      assignString(&value, argv[3]);
+      if (! updateVarEnv(shell->env, &name, &value))
+        fprintln(rp->tty, "export: out of memory");
+    }
+    if (exportVarEnv(shell->env, &name) == -1)
+      fprintln(rp->tty, "export: %s not set", argv[1]);
+  } else {
+    return 0;
+  }
 
-            String varStr;
-            assignString(&varStr, fromCharBuf(varBuilder));
-            const String* value = lookupVarEnv(env, &varStr);
+  if (strcmp(argv[1], "PATH") == 0)
+    flushTargetsCmdCache(shell->cache);
 
-            if (value)
-              concatCharBuf(tokenBuilder, fromString(value));
+  return 1;
+}
 
+/*
+ * expandTokenShell :: Env -> CharBuf -> CharBuf -> String -> CStr
+ *
+ * Expands the variables in 'token' into 'tokenBuilder'.
+ */
+static const char* expandTokenShell(Env *env, CharBuf *tokenBuilder, CharBuf *varBuilder, const String *token) {
+  const char *tokenStr = fromString(token);
+
+  clearCharBuf(tokenBuilder);
+
+  while (*tokenStr) {
+    switch (*tokenStr) {
+      case '$':
+        clearCharBuf(varBuilder);
+        tokenStr++;
+        if (*tokenStr == '_' || (*tokenStr >= 'a' && *tokenStr <= 'z') || (*tokenStr >= 'A' && *tokenStr <= 'Z')) {
+          while (*tokenStr == '_' || (*tokenStr >= 'a' && *tokenStr <= 'z') || (*tokenStr >= 'A' && *tokenStr <= 'Z') || (*tokenStr >= '0' && *tokenStr <= '9')) {
+            appendCharBuf(varBuilder, *tokenStr);
+            tokenStr++;
           }
-          break;
-        default:
-          appendCharBuf(tokenBuilder, *tokenStr);
-          tokenStr++;
-          break;
+
+          String varStr;
+          assignString(&varStr, fromCharBuf(varBuilder));
+          const String* value = lookupVarEnv(env, &varStr);
+
+          if (value)
+            concatCharBuf(tokenBuilder, fromString(value));
+
+        }
+        break;
+      default:
+        appendCharBuf(tokenBuilder, *tokenStr);
+        tokenStr++;
+        break;
+    }
+  }
+
+  return fromCharBuf(tokenBuilder);
+}
+
+/*
+ * populateCmdArgsShell :: Env -> CmdTemplate -> IntPtr [Cstr]Ptr -> ()
+ *
+ * Allocates the argv vector, and populates it from the CmdTemplate.
+ * Sets up 'argc' and expands variables in the process of populating
+ * the vector. Tokens without variables are copied as they are.
+ */
+int populateCmdArgsShell(Env *env, const CmdTemplate *tmpl, int *argc, char ***argv) {
+  int argc_ = tmpl->argc;
+  char **argv_ = kmalloc((1 + argc_) * sizeof *argv_); /* sysexecv must have a NULL terminated array of pointers */
+
+  CharBuf *tokenBuilder = NULL;
+  CharBuf *varBuilder = NULL;
+
+  int bg = 0;
+
+  for (int i = 0; i < argc_; i++) {
+    const char *arg = fromString(tmpl->argv[i]);
+    size_t size = tmpl->argv[i]->size;
+
+    if (tmpl->expand[i]) {
+      if (! tokenBuilder) {
+        tokenBuilder = mkCharBuf(32);
+        varBuilder = mkCharBuf(32);
       }
+      arg = expandTokenShell(env, tokenBuilder, varBuilder, tmpl->argv[i]);
+      size = strlen(arg);
     }
-    
-    const char* arg = fromCharBuf(tokenBuilder);
-    argv_[i] = kmalloc(strlen(arg) + 1);
-    memcpy(argv_[i], arg, strlen(arg));
+
+    argv_[i] = kmalloc(size + 1);
+    memcpy(argv_[i], arg, size + 1);
   }
+  argv_[argc_] = NULL;
 
   if (argc_) {
      char* lastArg = argv_[argc_ - 1];
-     if (*(lastArg + strlen(lastArg) - 1) == '&') {
+     if (*lastArg && *(lastArg + strlen(lastArg) - 1) == '&') {
          *(lastArg + strlen(lastArg) - 1) = 0;
         bg = 1;
      }
   }
 
-  freeCharBuf(tokenBuilder);
-  freeCharBuf(varBuilder);
-  freeParseTokenIterator(tokens);
+  if (tokenBuilder) {
+    freeCharBuf(tokenBuilder);
+    freeCharBuf(varBuilder);
+  }
   *argc = argc_;
   *argv = argv_;
   return bg;
 }
 
+/*
+ * resolveCmdShell :: Shell -> CStr -> CharBuf -> CStr
+ *
+ * Finds a bare command name on PATH (colon separated, "/bin" when
+ * unset), the first mode 0555 file wins. Where a name was found is
+ * cached, so the search runs once per name. Names with a '/', and
+ * names not found, are returned as they are for sysspawn to walk.
+ */
+const char* resolveCmdShell(Shell *shell, const char *name, CharBuf *pathBuilder) {
+  if (strchr(name, '/')) return name;
+
+  String nameStr;
+  assignString(&nameStr, name);
+
+  const String *target = lookupTargetCmdCache(shell->cache, &nameStr);
+  if (target) return fromString(target);
+
+  String pathVar;
+  assignString(&pathVar, "PATH");
+  const String *path = lookupVarEnv(shell->env, &pathVar);
+  const char *dirs = path ? fromString(path) : TORGO_DEFAULT_PATH;
+
+  while (*dirs) {
+    const char *colon = strchr(dirs, ':');
+    size_t n = colon ? (size_t)(colon - dirs) : strlen(dirs);
+
+    clearCharBuf(pathBuilder);
+    for (size_t i = 0; i < n; i++)
+      appendCharBuf(pathBuilder, dirs[i]);
+    if (n && dirs[n - 1] != '/')
+      appendCharBuf(pathBuilder, '/');
+    concatCharBuf(pathBuilder, name);
+
+    int fd = kopen(fromCharBuf(pathBuilder), CAP_READ);
+    if (fd >= 0) {
+      NodeInfo ni;
+      int found = kfstat(fd, &ni) == 0 && ni.mode == 0555;
+      kclose(fd);
+
+      if (found) {
+        String hit;
+        assignString(&hit, fromCharBuf(pathBuilder));
+        target = addTargetCmdCache(shell->cache, &nameStr, &hit);
+        return target ? fromString(target) : name;
+      }
+    }
+
+    dirs += colon ? n + 1 : n;
+  }
+
+  return name;
+}
+
+/*
+ * spawnCmdShell :: Shell -> [CStr] -> SpawnAttr -> CharBuf -> Pid
+ *
+ * Resolves and spawns one command, reporting failures.
+ */
+int spawnCmdShell(Shell *shell, char * const argv[], const SpawnAttr *attr, CharBuf *pathBuilder) {
+  const char *path = resolveCmdShell(shell, argv[0], pathBuilder);
+  int pid = kspawn(path, argv, attr, TORGO_SPAWN_TIMEOUT);
+
+  if (pid < 0 && (errno == ETIMEDOUT || errno == EAGAIN)) {
+    fprintln(rp->tty, "%s: no free process slot", argv[0]);
+  } else if (pid < 0) {
+    String nameStr;
+    assignString(&nameStr, argv[0]);
+    dropTargetCmdCache(shell->cache, &nameStr);
+  }
+
+  return pid;
+}
+
+/*
+ * runPipelineShell :: Shell -> [[CStr]] -> Int -> Bool -> CharBuf -> ()
+ *
+ * Spawns every stage at once, each reading the pipe the one before it
+ * writes, so the stages run concurrently and data streams through. The
+ * shell closes its copies of the pipe ends as it goes, so each reader
+ * sees EOF when its writer exits. Waits for every stage unless 'bg'.
+ */
+void runPipelineShell(Shell *shell, char **stages[], int nstages, int bg, CharBuf *pathBuilder) {
+  int pids[TORGO_MAXSTAGES];
+  int in = -1;
+
+  Environ *exports = exportsEnv(shell->env);
+
+  for (int i = 0; i < nstages; i++) {
+    int fds[2] = { -1, -1 };
+    if (i < nstages - 1 && kpipe(fds) == -1) {
+      fprintln(rp->tty, "%s: cannot make pipe", stages[i][0]);
+      nstages = i;
+      break;
+    }
+
+    SpawnAttr attr = { .env = exports, .in = in, .out = fds[1] };
+    pids[i] = spawnCmdShell(shell, stages[i], &attr, pathBuilder);
+
+    if (in >= 0) kclose(in);
+    if (fds[1] >= 0) kclose(fds[1]);
+    in = fds[0];
+  }
+
+  if (in >= 0) kclose(in);
+  releaseEnviron(exports);
+
+  for (int i = 0; i < nstages && !bg; i++) {
+    if (pids[i] > 0)
+      waitpid(pids[i], NULL, WAIT_UNTRACED);
+  }
+}
+
+/*
+ * reapJobsShell :: ()
+ *
+ * Collects every background job which has exited since the last prompt,
+ * without waiting for the rest.
+ */
+void reapJobsShell(void) {
+  int pid;
+  int status;
+
+  while ((pid = waitpid(-1, &status, WAIT_NOHANG)) > 0) {
+    if (WAIT_EXITED(status))
+      fprintln(rp->tty, "[%d] Done %d", pid, WAIT_CODE(status));
+  }
+}
+
+/*
+ * markPromptShell :: ()
+ *
+ * Tells the boot profile a shell has reached its prompt. Only the first
+ * shell to do so counts.
+ */
+void markPromptShell(void) {
+  int fd = kopen("/dev/boot", CAP_WRITE);
+  if (fd != -1) {
+    kwrite(fd, "prompt", 6);
+    kclose(fd);
+  }
+}
+
+/*
+ * runCmdsShell :: Shell -> CmdTemplate -> ()
+ *
+ * Expands and runs each command parsed from a line, splitting it into
+ * pipeline stages at each pipe operator. A "|" that came from quotes or
+ * a variable is an argument like any other.
+ */
+void runCmdsShell(Shell *shell, const CmdTemplate *cmds) {
+  CharBuf *pathBuilder = NULL;
+
+  for (const CmdTemplate *tmpl = cmds; tmpl; tmpl = tmpl->next) {
+    int cmdArgc;
+    char **cmdArgv;
+    int bg = populateCmdArgsShell(shell->env, tmpl, &cmdArgc, &cmdArgv);
+    if (! cmdArgc)
+      continue;
+
+    char **stages[TORGO_MAXSTAGES];
+    int nstages = 1;
+    int bad = 0;
+
+    stages[0] = cmdArgv;
+    for (int i = 0; i < cmdArgc; i++) {
+      if (! tmpl->op[i])
+        continue;
+
+      kfree(cmdArgv[i]);
+      cmdArgv[i] = NULL; /* ends the stage before */
+      if (nstages == TORGO_MAXSTAGES)
+        bad = 1;
+      else
+        stages[nstages++] = &cmdArgv[i + 1];
+    }
+
+    for (int i = 0; i < nstages; i++) {
+      if (! stages[i][0])
+        bad = 1;
+    }
+
+    if (bad) {
+      fprintln(rp->tty, "error: bad pipeline");
+      continue;
+    }
+
+    if (nstages == 1 && builtinShell(shell, cmdArgc, cmdArgv))
+      continue;
+
+    if (! pathBuilder) pathBuilder = mkCharBuf(32);
+    runPipelineShell(shell, stages, nstages, bg, pathBuilder);
+  }
+
+  if (pathBuilder) freeCharBuf(pathBuilder);
+}
+
 /*
  * main
  *
@@ -203,6 +518,7 @@ int torgo_main(int argc, char * const argv[]) {
   setSignalMask(SigStop, NULL);
 
   Shell *shell = mkShell();
+  importEnvShell(shell->env, rp->env);
 
   fputstr(rp->tty, "[2J[f");
   fputstr(rp->tty, harvard_ansi);
@@ -211,8 +527,12 @@ int torgo_main(int argc, char * const argv[]) {
   fputstr(rp->tty, "[G[m");
   fprintln(rp->tty, "");
   
+  markPromptShell();
+
   const char *ps = ps1;
   while (shell->state == ShellStateRun) {
+    if (ps == ps1)
+      reapJobsShell();
     const CharBuf *input = readPromptShell(shell, ps, 32);
 
     if (isEmptyCharBuf(input)) {
@@ -224,47 +544,35 @@ int torgo_main(int argc, char * const argv[]) {
       break;
     }
 
+    /* a line starting a fresh command may have been parsed before */
+    String line;
+    assignString(&line, fromCharBuf(input));
+    int fresh = (ps == ps1);
+
+    const CmdTemplate *cached = fresh ? lookupLineCmdCache(shell->cache, &line) : NULL;
+    if (cached) {
+      runCmdsShell(shell, cached);
+      continue;
+    }
+
     addInputParser(shell->parser, fromCharBuf(input));
 
+    CmdTemplate *cmds = NULL;
+    CmdTemplate **lastCmd = &cmds;
+    int cacheable = fresh;
+
     while (hasUnparsedInputParser(shell->parser)) {
       ParseResult *result = parseInputParser(shell->parser);
 
       if (isCompleteParseResult(result)) {
-        int cmdArgc;
-        char **cmdArgv;
-        int bg = populateCmdArgsShell(shell->env, result, &cmdArgc, &cmdArgv);
-        int pid = kexec(cmdArgv[0], cmdArgv);
-
-        if (pid > 0 && !bg)
-            waitpid(pid);
-
-        /*
-         * Some commands need shell environment access and so cannot be passed of to 'exec' at the moment
-         */
-#if 0
-        if (cmdArgc == 4 && strcmp(cmdArgv[0], "set") == 0 && strcmp(cmdArgv[2], "=") == 0) {
-          String name;
-          String value;
-
-          assignString(&name, cmdArgv[1]);
-          assignString(&value, cmdArgv[3]);
-          addVarEnv(shell->env, &name, &value);
-        } else if (cmdArgc == 2 && strcmp(cmdArgv[0], "unset") == 0) {
-          String name;
-
-          assignString(&name, cmdArgv[1]);
-          unsetVarEnv(shell->env, &name);
-        } else if (cmdArgc == 1 && strcmp(cmdArgv[0], "perror") == 0) {
-          printf("Last status (%d): %s\n", shellErrno, strerror(shellErrno)); /* fromErr(shellErrno)); */
+        CmdTemplate *tmpl = mkCmdTemplate(result);
+        if (tmpl) {
+          runCmdsShell(shell, tmpl);
+          *lastCmd = tmpl;
+          lastCmd = &tmpl->next;
         } else {
-          for (int i = 0; cmdArgc && i < numBuiltinCmds; i++) {
-            if (strcmp(builtinCmds[i].cmdName, cmdArgv[0]) == 0) {
-              shellErrno = 0;
-              shellErrno = builtinCmds[i].cmd(cmdArgc, cmdArgv);
-            }
-          }
+          cacheable = 0;
         }
-#endif
 
         ps = ps1;
       } else {
@@ -272,6 +580,11 @@ int torgo_main(int argc, char * const argv[]) {
       }
       freeParseResult(result);
     }
+
+    if (cacheable && cmds && ps == ps1)
+      addLineCmdCache(shell->cache, &line, cmds);
+    else
+      freeCmdTemplate(cmds);
   }
  
   return 0;
@@ -17,5 +17,6 @@ WalkTrail* emptyWalkTrail(unsigned n) {
     }
 
     t->max = n;
+    t->top = 0;
     return t;
 }
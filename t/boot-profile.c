@@ -0,0 +1,52 @@
+#include <errno.h>
+#include <manos.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+
+/*
+ * Mark boot phases directly and by name, read the profile back as
+ * /dev/boot would, and bring a device up more than once.
+ */
+
+static unsigned inits = 0;
+static void countInit(void) { inits++; }
+
+int main(void) {
+    char text[512] = {0};
+    readBoot(text, sizeof text - 1, 0);
+    report("unmarked", strstr(text, "reset          -\n") == NULL || strstr(text, "deferred       -\n") == NULL);
+
+    bootMark(BootReset);
+    bootMark(BootClocks);
+    bootMark(BootReset);
+    memset(text, 0, sizeof text);
+    size_t len = readBoot(text, sizeof text - 1, 0);
+    report("marked", !bootMarked(BootReset) || !bootMarked(BootClocks) || bootMarked(BootDevices) ||
+                     strstr(text, "clocks         0.000 ms  +0.000\n") == NULL ||
+                     strstr(text, "devices        -\n") == NULL);
+
+    errno = 0;
+    int bad = bootMarkName("prompt\n", 7) != 0 || !bootMarked(BootPrompt);
+    bad |= bootMarkName("promp", 5) != -1 || errno != EINVAL;
+    bad |= bootMarkName("bogus", 5) != -1;
+    report("names", bad);
+    report("wait", bootWait(BootPrompt, 10) != 0);
+
+    /* a line at a time, as cat reads it */
+    char piece[512] = {0};
+    size_t got = 0, n;
+    while ((n = readBoot(piece + got, 7, got)) > 0)
+        got += n;
+    memset(text, 0, sizeof text);
+    report("offset", got != readBoot(text, sizeof text - 1, 0) || got < len || strcmp(piece, text) != 0);
+
+    Dev fake = { .name = "fake", .reset = resetDev, .power = powerDev, .init = countInit, .lazy = 1 };
+    deviceTable[0] = &fake;
+    bringUpDevice(0);
+    bringUpDevice(0);
+    report("bringup", inits != 1);
+
+    return failures != 0;
+}
@@ -0,0 +1,26 @@
+#ifndef MANOS_T_CHECK_H
+#define MANOS_T_CHECK_H
+
+#include <manos.h>
+#include <stdio.h>
+
+/*
+ * Shared by the tests under t/. Each check prints a line through
+ * report(), and main() returns failures != 0.
+ */
+
+static int failures = 0;
+
+static inline void report(const char* name, int bad) {
+    printf("Test %-10s %s\n", name, bad ? "FAIL" : "PASS");
+    failures += bad != 0;
+}
+
+/* bytes in use in kmalloc region idx */
+static inline uint32_t inUse(unsigned idx) {
+    KmallocStats stats;
+    kmallocRegionStats(idx, &stats);
+    return stats.inUse;
+}
+
+#endif /* ! MANOS_T_CHECK_H */
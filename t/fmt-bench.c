@@ -0,0 +1,254 @@
+#include <limits.h>
+#include <manos.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Check fmtSnprintf against the host snprintf, then time it against the
+ * formatter it replaced (kept below as oldFmt) on the kinds of lines the
+ * status files print.
+ */
+
+/* the previous formatter, verbatim but for its name */
+static char intToHexLC[16] = { '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f' };
+
+static int uintToStr(char* buf, size_t n, int hex, uint32_t i) {
+    if (n == 0) return 0;
+
+    if (i == 0) {
+        *(buf + n - 1) = '0';
+        return 1;
+    }
+
+    int base = hex ? 16 : 10;
+    char* c = buf + n - 1;
+    int x = n;
+
+    while (x && i) {
+        uint32_t r = i % base;
+        i /= base;
+
+        if (hex) {
+            *c = intToHexLC[r];
+        } else {
+            *c = r + '0';
+        }
+        c--;
+        x--;
+    }
+
+    return n - x;
+}
+
+#define INTBUF_SIZE 20
+
+static ptrdiff_t oldVsnprintf(char buf[], size_t n, int useN, const char* fmt, va_list ap) {
+    char intBuf[INTBUF_SIZE + 1] = {0};
+    const char* c = fmt;
+    char* p = buf;
+
+    while (n && *c) {
+        const char* x = c;
+
+        /* scan for format delimiter */
+        while ((n || !useN) && *x && *x != '%') {
+            *p++ = *x;
+            x++;
+            n--;
+        }
+
+        c = x;
+
+        if (*x == '%') { 
+            if (*(x + 1) == '%') {
+                *p++ = '%';
+                c = x + 2;
+                n--;
+                continue;
+            }
+            x++;
+            /* 1: handle flags */
+           switch (*x) {
+           case '0':
+               kmemset(intBuf, '0', INTBUF_SIZE);
+               x++;
+               break;
+           }
+           c = x;
+
+           /* 2: handle width */
+           unsigned width = 0;
+           while (*x >= '0' && *x <= '9')
+               x++;
+
+           width = atoi(c);
+           c = x;
+
+           int hasPrecision = 0;
+           unsigned precision = 0;
+           /* 2a: handle precision */
+           if (*x == '.') {
+               hasPrecision = 1;
+               x++;
+               c = x;
+
+               while (*x >= '0' && *x <= '9')
+                   x++;
+
+               precision = atoi(c);
+           }
+
+           c = x;
+
+           int longModifiers = 0;
+           size_t bytes = 0;
+           char* s;
+           /* 3: handle type */
+restartOnLongModifier:
+           switch (*x) {
+           case 'l':
+               x++;
+               longModifiers++;
+               goto restartOnLongModifier;
+           case 'd':
+           case 'u':
+               bytes = uintToStr(intBuf, INTBUF_SIZE, 0, va_arg(ap, uint32_t));
+               if (bytes < width) bytes = width;
+               if (useN && bytes > n) bytes = n;
+               memcpy(p, intBuf + INTBUF_SIZE - bytes, bytes);
+               n -= bytes;
+               p += bytes;
+               c = x + 1;
+               break;
+           case 'x':
+               bytes = uintToStr(intBuf, INTBUF_SIZE, 1, va_arg(ap, uint32_t));
+               if (bytes < width) bytes = width;
+               if (useN && bytes > n) bytes = n;
+               memcpy(p, intBuf + INTBUF_SIZE - bytes, bytes);
+               n -= bytes;
+               p += bytes;
+               c = x + 1;
+               break;
+           case 's':
+               s = va_arg(ap, char*);
+               bytes = strlen(s);
+               if (hasPrecision && precision < bytes) bytes = precision;
+               if (width > bytes) {
+                   width -= bytes;
+                   while (width && (n || !useN)) {
+                       *p = ' ';
+                       p++;
+                       n--;
+                       width--;
+                   }
+               }
+               if (useN && !n) break;
+               if (useN && bytes > n) bytes = n;
+               memcpy(p, s, bytes);
+               n -= bytes;
+               p += bytes;
+               c = x + 1;
+               break;
+           }
+        }
+    }
+    *p = 0;
+    return p - buf;
+}
+
+static ptrdiff_t oldFmt(char buf[], size_t n, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    ptrdiff_t bytes = oldVsnprintf(buf, n, 1, fmt, ap);
+    va_end(ap);
+    return bytes;
+}
+
+static int failures = 0;
+
+/* the host's formatter, out of line so truncation is not a warning */
+static void hostFmt(char buf[], size_t n, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(buf, n, fmt, ap);
+    va_end(ap);
+}
+
+#define CHECK(n, fmt, ...) do {                                           \
+    char want[128];                                                        \
+    char got[128];                                                         \
+    memset(got, 'X', sizeof got);                                          \
+    hostFmt(want, (n), fmt, __VA_ARGS__);                                  \
+    ptrdiff_t len = fmtSnprintf(got, (n), fmt, __VA_ARGS__);               \
+    int ok = strcmp(want, got) == 0 && (size_t)len == strlen(want);        \
+    printf("Test %-24s %s (%s)\n", "\"" fmt "\"", ok ? "PASS" : "FAIL", got); \
+    failures += !ok;                                                       \
+} while (0)
+
+static void checkFormats(void) {
+    CHECK(128, "%d", 0);
+    CHECK(128, "%d", -1);
+    CHECK(128, "%d", INT_MIN);
+    CHECK(128, "%d", INT_MAX);
+    CHECK(128, "%u", UINT_MAX);
+    CHECK(128, "%x", 0xdeadbeefu);
+    CHECK(128, "%ld", LONG_MIN);
+    CHECK(128, "%lu", ULONG_MAX);
+    CHECK(128, "%lld", LLONG_MIN);
+    CHECK(128, "%lld", 1234567890123LL);
+    CHECK(128, "%llu", ULLONG_MAX);
+    CHECK(128, "%llu", 1000000000ULL);
+    CHECK(128, "%llx", 0x123456789abcdefULL);
+    CHECK(128, "%05d|%d", -42, 7);
+    CHECK(128, "%5d|%-5d|", 42, 42);
+    CHECK(128, "%02d:%02d", 3, 14);
+    CHECK(128, "%03u.%u", 7, 8);
+    CHECK(128, "%.2x", 5);
+    CHECK(128, "%5s|%-5s|", "ab", "cd");
+    CHECK(128, "%.2s", "abcdef");
+    CHECK(128, "100%% %s", "done");
+    CHECK(5, "%s", "hello world");
+    CHECK(4, "%d", 123456);
+    CHECK(128, "%s:\t\t\t%lld\n", "SYSTICK", 123456789012LL);
+}
+
+#define ITERATIONS 200000
+
+typedef ptrdiff_t (*FmtFn)(char[], size_t, const char*, ...);
+
+#define RUNS 5
+
+/* best of RUNS, in ns per call */
+static double bench(FmtFn fn) {
+    char buf[128];
+    double best = 0;
+    for (unsigned run = 0; run < RUNS; run++) {
+        clock_t start = clock();
+        for (unsigned i = 0; i < ITERATIONS; i++) {
+            fn(buf, sizeof buf, "%s:\t\t\t%u\n", "SYSTICK", i * 2654435761u);
+            fn(buf, sizeof buf, "%d %d %d %s", i, i >> 3, 1000000 + i, "ready");
+            fn(buf, sizeof buf, "PID %u STATE %s %x", i & 127, "running", i);
+            fn(buf, sizeof buf, "%02d:%02d:%02d", i % 24, i % 60, (i >> 1) % 60);
+        }
+        double ns = (double)(clock() - start) / CLOCKS_PER_SEC * 1e9 / (4.0 * ITERATIONS);
+        if (run == 0 || ns < best)
+            best = ns;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    checkFormats();
+
+    double before = bench(oldFmt);
+    double after  = bench(fmtSnprintf);
+    printf("fmt old: %.1f ns/call new: %.1f ns/call (%.2fx)\n", before, after, before / after);
+
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
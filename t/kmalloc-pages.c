@@ -0,0 +1,78 @@
+#include <manos.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+
+/*
+ * Take the bulk region a page at a time and check that freeing it in any
+ * order merges the pages back into large blocks, and that small objects
+ * give their arenas of pages back once freed.
+ */
+
+#define BULK 1
+#define PAGE 4096
+
+static void* pages[1024];
+
+/* take single pages from the bulk region until it runs out, return how many */
+static unsigned fill(int* misaligned) {
+    unsigned n = 0;
+    while (n < COUNT_OF(pages)) {
+        uint32_t before = inUse(BULK);
+        void* p = syskmallocHint(PAGE, MemBulk);
+        if (p && inUse(BULK) == before + PAGE) {
+            *misaligned |= (uintptr_t)p & (PAGE - 1);
+            pages[n++] = p;
+            continue;
+        }
+        syskfree(p); /* spilled into the fast region */
+        break;
+    }
+    return n;
+}
+
+/* free every 'stride'th page, then the rest, so buddies come back apart */
+static void drain(unsigned n, unsigned stride) {
+    for (unsigned s = 0; s < stride; s++)
+        for (unsigned i = s; i < n; i += stride)
+            syskfree(pages[i]);
+}
+
+int main(void) {
+    int misaligned = 0;
+    unsigned n0 = fill(&misaligned);
+    report("align", n0 < 16 || misaligned || inUse(BULK) != n0 * PAGE);
+
+    drain(n0, 3);
+    unsigned big = PAGE;
+    while (2 * big <= n0 * PAGE)
+        big *= 2;
+    void* whole = syskmallocHint(big, MemBulk);
+    report("coalesce", !whole || inUse(BULK) != big || ((uintptr_t)whole & (PAGE - 1)));
+    if (whole)
+        memset(whole, 0xa5, big);
+    syskfree(whole);
+
+    /* enough small objects for several arenas */
+    static void* small[4096];
+    int bad = 0;
+    for (unsigned i = 0; i < COUNT_OF(small); i++) {
+        small[i] = syskmallocHint(64, MemBulk);
+        bad |= small[i] == NULL;
+    }
+    bad |= inUse(BULK) < COUNT_OF(small) * 64;
+    for (unsigned i = 0; i < COUNT_OF(small); i += 2)
+        syskfree(small[i]);
+    for (unsigned i = 1; i < COUNT_OF(small); i += 2)
+        syskfree(small[i]);
+    bad |= inUse(BULK) != 0;
+
+    /* one arena may be kept, everything else is pages again */
+    unsigned n1 = fill(&misaligned);
+    drain(n1, 1);
+    report("arenas", bad || n1 + 16 < n0);
+
+    report("free", inUse(BULK) != 0);
+    return failures != 0;
+}
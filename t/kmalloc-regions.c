@@ -0,0 +1,62 @@
+#include <manos.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+
+/*
+ * Allocate from the fast and bulk regions with and without hints, and
+ * check where each allocation landed by the in-use count of each region.
+ */
+
+#define FAST 0
+#define BULK 1
+
+/* allocate n bytes and say which region grew, -1 on failure */
+static int placed(void** mem, size_t n, MemHint hint) {
+    uint32_t fast = inUse(FAST), bulk = inUse(BULK);
+    *mem = hint == MemAny ? syskmalloc(n) : syskmallocHint(n, hint);
+    if (!*mem || ((uintptr_t)*mem & 7))
+        return -1;
+    return inUse(FAST) > fast ? FAST : inUse(BULK) > bulk ? BULK : -1;
+}
+
+int main(void) {
+    KmallocStats fast, bulk;
+    const char* fastName = kmallocRegionStats(FAST, &fast);
+    const char* bulkName = kmallocRegionStats(BULK, &bulk);
+    report("regions", !fastName || !bulkName || strcmp(fastName, "sram") || strcmp(bulkName, "sdram") ||
+                      fast.total == 0 || bulk.total <= fast.total || kmallocRegionStats(2, &fast) != NULL);
+
+    void* small;
+    void* large;
+    void* pinned;
+    int bad = placed(&small, 48, MemAny) != FAST;
+    bad |= placed(&large, 4096, MemAny) != BULK;
+    bad |= placed(&pinned, 4096, MemFast) != FAST;
+    report("hints", bad);
+
+    /* once the fast region is full, allocations hinted at it spill into bulk */
+    void* fill[4096];
+    unsigned n = 0;
+    int where = -1;
+    while (n < COUNT_OF(fill) && (where = placed(&fill[n], 1024, MemFast)) == FAST)
+        n++;
+    if (where == BULK)
+        n++;
+    report("spill", where != BULK);
+
+    memset(large, 0x5a, 4096);
+    syskfree(small);
+    syskfree(large);
+    syskfree(pinned);
+    while (n > 0)
+        syskfree(fill[--n]);
+    report("free", inUse(FAST) != 0 || inUse(BULK) != 0);
+
+    KmallocStats all;
+    kmallocStats(&all);
+    report("total", all.total != fast.total + bulk.total || all.inUse != 0);
+
+    return failures != 0;
+}
@@ -0,0 +1,141 @@
+#include <manos.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Check kmemset, kmemcpy and kmemmove against a bytewise reference over
+ * every alignment and a spread of lengths, then time them on a large
+ * block against a byte loop and the host libc.
+ */
+
+#define AREA 1024
+#define GUARD 0xee
+
+static unsigned char area[AREA];
+static unsigned char want[AREA];
+static int failures = 0;
+
+static void fill(unsigned char* p, size_t n, unsigned seed) {
+    for (size_t i = 0; i < n; i++)
+        p[i] = (unsigned char)(seed + i * 7);
+}
+
+static void refMove(unsigned char* d, const unsigned char* s, size_t n) {
+    unsigned char tmp[AREA];
+    for (size_t i = 0; i < n; i++)
+        tmp[i] = s[i];
+    for (size_t i = 0; i < n; i++)
+        d[i] = tmp[i];
+}
+
+static void report(const char* name, unsigned cases, unsigned bad) {
+    printf("Test %-10s %s (%u cases)\n", name, bad ? "FAIL" : "PASS", cases);
+    failures += bad != 0;
+}
+
+static void checkSet(void) {
+    unsigned cases = 0, bad = 0;
+    for (size_t align = 0; align < 8; align++) {
+        for (size_t n = 0; n < 300; n++) {
+            memset(area, GUARD, AREA);
+            memset(want, GUARD, AREA);
+            for (size_t i = 0; i < n; i++)
+                want[64 + align + i] = 0x5a;
+            if (kmemset(area + 64 + align, 0x5a, n) != area + 64 + align || memcmp(area, want, AREA) != 0)
+                bad++;
+            cases++;
+        }
+    }
+    report("kmemset", cases, bad);
+}
+
+static void checkCopy(void) {
+    unsigned char src[AREA];
+    unsigned cases = 0, bad = 0;
+    fill(src, AREA, 3);
+    for (size_t da = 0; da < 8; da++) {
+        for (size_t sa = 0; sa < 8; sa++) {
+            for (size_t n = 0; n < 300; n += (n < 80 ? 1 : 13)) {
+                memset(area, GUARD, AREA);
+                memset(want, GUARD, AREA);
+                refMove(want + 64 + da, src + sa, n);
+                if (kmemcpy(area + 64 + da, src + sa, n) != area + 64 + da || memcmp(area, want, AREA) != 0)
+                    bad++;
+                cases++;
+            }
+        }
+    }
+    report("kmemcpy", cases, bad);
+}
+
+static void checkMove(void) {
+    unsigned cases = 0, bad = 0;
+    for (int shift = -41; shift <= 41; shift++) {
+        for (size_t align = 0; align < 4; align++) {
+            for (size_t n = 0; n < 300; n += (n < 80 ? 1 : 17)) {
+                size_t from = 256 + align;
+                fill(area, AREA, (unsigned)n);
+                memcpy(want, area, AREA);
+                refMove(want + from + shift, want + from, n);
+                if (kmemmove(area + from + shift, area + from, n) != area + from + shift || memcmp(area, want, AREA) != 0)
+                    bad++;
+                cases++;
+            }
+        }
+    }
+    report("kmemmove", cases, bad);
+}
+
+#define BLOCK (256 * 1024)
+#define ROUNDS 200
+
+typedef void* (*CopyFn)(void*, const void*, size_t);
+
+static void* byteCopy(void* dest, const void* src, size_t n) {
+    volatile unsigned char* d = dest;
+    const unsigned char* s = src;
+    while (n--)
+        *d++ = *s++;
+    return dest;
+}
+
+/* best of five, in MB/s */
+static double bench(CopyFn fn, unsigned char* d, const unsigned char* s, size_t n) {
+    double best = 0;
+    for (unsigned run = 0; run < 5; run++) {
+        clock_t start = clock();
+        for (unsigned i = 0; i < ROUNDS; i++)
+            fn(d, s, n);
+        double secs = (double)(clock() - start) / CLOCKS_PER_SEC;
+        double mbs = secs > 0 ? (double)n * ROUNDS / secs / 1e6 : 0;
+        if (mbs > best)
+            best = mbs;
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    (void)argc;
+    (void)argv;
+
+    checkSet();
+    checkCopy();
+    checkMove();
+
+    unsigned char* a = malloc(BLOCK);
+    unsigned char* b = malloc(BLOCK);
+    if (!a || !b)
+        return EXIT_FAILURE;
+    fill(b, BLOCK, 1);
+
+    printf("copy %d KiB: bytes %.0f MB/s kmemcpy %.0f MB/s libc %.0f MB/s\n", BLOCK / 1024,
+            bench(byteCopy, a, b, BLOCK), bench(kmemcpy, a, b, BLOCK), bench(memcpy, a, b, BLOCK));
+    printf("move %d KiB: kmemmove %.0f MB/s libc %.0f MB/s\n", BLOCK / 1024,
+            bench(kmemmove, a + 4, a, BLOCK - 4), bench(memmove, a + 4, a, BLOCK - 4));
+
+    free(a);
+    free(b);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,87 @@
+#include <manos.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+
+/*
+ * Load programs through /dev/led/ctl and check the levels the NICE
+ * stand-in records on /dev/led/wave.
+ */
+
+extern Dev devLed;
+
+static Portal* ledFile(Portal* root, char* name) {
+    WalkTrail* t = devLed.walk(root, &name, 1);
+    if (!t)
+        return NULL;
+
+    Portal* p = kmalloc(sizeof *p);
+    mkPortal(p, root->device);
+    clonePortal(root, p);
+    topCrumb(t, &p->crumb);
+    freeWalkTrail(t);
+    return devLed.open(p, CAP_READWRITE);
+}
+
+static int ctl(Portal* p, char* cmd) {
+    return devLed.write(p, cmd, strlen(cmd), 0) == (ptrdiff_t)strlen(cmd) ? 0 : -1;
+}
+
+/* read n levels and compare them against want */
+static int expectWave(Portal* wave, const LedLevel* want, unsigned n) {
+    LedLevel got[16];
+    ptrdiff_t bytes = devLed.read(wave, got, n * sizeof got[0], 0);
+    if (bytes != (ptrdiff_t)(n * sizeof got[0]))
+        return 1;
+
+    for (unsigned i = 0; i < n; i++) {
+        if (got[i].msecs != want[i].msecs || got[i].led != want[i].led || got[i].duty != want[i].duty) {
+            printf("  level %u: got %u/%u/%u want %u/%u/%u\n", i,
+                   got[i].msecs, got[i].led, got[i].duty, want[i].msecs, want[i].led, want[i].duty);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void) {
+    devLed.init();
+    Portal* root = devLed.attach("");
+    Portal* c    = ledFile(root, "ctl");
+    Portal* wave = ledFile(root, "wave");
+    Portal* blue = ledFile(root, "blue");
+    if (!c || !wave || !blue) {
+        printf("cannot walk /dev/led\n");
+        return 1;
+    }
+
+    /* blue: 50% for 100ms of every second */
+    const LedLevel blink[] = {
+        { 0, 3, 50, 0 }, { 100, 3, 0, 0 }, { 1000, 3, 50, 0 }, { 1100, 3, 0, 0 }, { 2000, 3, 50, 0 }
+    };
+    report("blink", ctl(c, "blink blue 1000 100 50") || expectWave(wave, blink, COUNT_OF(blink)));
+
+    char state = 0;
+    devLed.read(blue, &state, 1, 0);
+    report("state", state != '1');
+
+    /* green: a three step ramp, from wherever the engine clock is now */
+    ctl(c, "duty blue 0");
+    devLed.read(wave, (LedLevel[1]){{0}}, sizeof(LedLevel), 0);
+    LedLevel first;
+    ctl(c, "seq green 10 25 75 100");
+    devLed.read(wave, &first, sizeof first, 0);
+    const LedLevel seq[] = {
+        { first.msecs + 10, 2, 75, 0 }, { first.msecs + 20, 2, 100, 0 }, { first.msecs + 30, 2, 25, 0 }
+    };
+    report("seq", first.led != 2 || first.duty != 25 || expectWave(wave, seq, COUNT_OF(seq)));
+
+    report("invalid", ctl(c, "duty blue 101") == 0 || ctl(c, "blink red 10 5") == 0 || ctl(c, "blink blue 10 10") == 0);
+
+    char text[256] = {0};
+    devLed.read(c, text, sizeof text - 1, 0);
+    report("ctl", strstr(text, "green seq 10 25 75 100\n") == NULL || strstr(text, "blue duty 0\n") == NULL);
+
+    return failures != 0;
+}
@@ -0,0 +1,129 @@
+#include <errno.h>
+#include <manos.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "check.h"
+
+/*
+ * Build a small executable in memory, load it and check the text and
+ * data relocations, the data address fixups of each instance, that
+ * malformed or misplaced relocations are refused, and that a second
+ * exec of the same file hits the cache.
+ */
+
+#define TEXT_WORDS 4
+#define DATA_WORDS 3
+#define RELOCS     3
+
+typedef struct Mex {
+    MexHeader h;
+    uint32_t  text[TEXT_WORDS];
+    uint32_t  data[DATA_WORDS];
+    uint32_t  reloc[RELOCS];
+} Mex;
+
+/*
+ * text[1] points at text[3], data[0] at text[2] and data[1] at data[2];
+ * text[0] and the rest are left alone.
+ */
+static void mkMex(Mex* m) {
+    memset(m, 0, sizeof *m);
+    m->h.magic    = MEX_MAGIC;
+    m->h.textSize = sizeof m->text;
+    m->h.dataSize = sizeof m->data;
+    m->h.bssSize  = 16;
+    m->h.entry    = 1;
+    m->h.nrelocs  = RELOCS;
+
+    m->text[0] = 0x11111111;
+    m->text[1] = 12;
+    m->text[2] = 0x22222222;
+    m->text[3] = 0x33333333;
+    m->data[0] = 8;
+    m->data[1] = 8;
+    m->data[2] = 0x44444444;
+
+    m->reloc[0] = 4;
+    m->reloc[1] = MEX_RELOC_DATA | 0;
+    m->reloc[2] = MEX_RELOC_DATA | MEX_RELOC_TODATA | 4;
+}
+
+static void mkInfo(NodeInfo* ni, Fid fid) {
+    memset(ni, 0, sizeof *ni);
+    ni->device    = 1;
+    ni->crumb.fid = fid;
+    ni->length    = sizeof(Mex);
+    ni->mtime     = 42;
+}
+
+static uint32_t wordAt(const char* p, size_t offset) {
+    uint32_t word;
+    memcpy(&word, p + offset, sizeof word);
+    return word;
+}
+
+/* the loader must refuse m with ENOEXEC */
+static int refused(const Mex* m, size_t len, Fid fid) {
+    NodeInfo ni;
+    mkInfo(&ni, fid);
+    errno = 0;
+    return loadMex(&ni, m, len) == NULL && errno == ENOEXEC;
+}
+
+int main(void) {
+    Mex m;
+    NodeInfo ni;
+    mkMex(&m);
+    mkInfo(&ni, 1);
+
+    MexImage* image = loadMex(&ni, &m, sizeof m);
+    report("load", image == NULL || image->entry != 1 || image->nfixups != 1);
+    if (!image)
+        return 1;
+
+    uint32_t textBase = (uint32_t)(uintptr_t)image->text;
+    report("text", wordAt(image->text, 0) != 0x11111111 || wordAt(image->text, 4) != textBase + 12 ||
+                   wordAt(image->text, 8) != 0x22222222);
+    report("data", wordAt(image->data, 0) != textBase + 8 || wordAt(image->data, 4) != 8 ||
+                   wordAt(image->data, 8) != 0x44444444);
+
+    /* each instance gets its own data, pointed at itself, and a zeroed bss */
+    char* a = instanceMex(image);
+    char* b = instanceMex(image);
+    int bad = !a || !b || a == b;
+    for (unsigned i = 0; !bad && i < 4; i++)
+        bad |= wordAt(a, sizeof m.data + 4 * i) != 0;
+    report("instance", bad || wordAt(a, 0) != textBase + 8 ||
+                       wordAt(a, 4) != (uint32_t)(uintptr_t)a + 8 ||
+                       wordAt(b, 4) != (uint32_t)(uintptr_t)b + 8);
+    syskfree(a);
+    syskfree(b);
+
+    Mex bad0 = m;
+    bad0.h.magic = 0;
+    Mex bad1 = m;
+    bad1.reloc[0] = 2;                        /* not word aligned */
+    Mex bad2 = m;
+    bad2.reloc[0] = sizeof m.text;            /* past the end of text */
+    Mex bad3 = m;
+    bad3.reloc[0] = MEX_RELOC_TODATA | 4;     /* text holding a data address */
+    Mex bad4 = m;
+    bad4.h.entry = sizeof m.text;             /* entry outside text */
+    Mex bad5 = m;
+    bad5.h.bssSize = 0xffffffff - sizeof m.data; /* data + bss + 1 wraps to 0 */
+    report("malformed", !refused(&bad0, sizeof m, 2) || !refused(&m, sizeof m - 1, 2) ||
+                        !refused(&bad4, sizeof m, 2) || !refused(&bad5, sizeof m, 2));
+    report("misplaced", !refused(&bad1, sizeof m, 2) || !refused(&bad2, sizeof m, 2) ||
+                        !refused(&bad3, sizeof m, 2));
+
+    /* the same file hits, a changed one misses */
+    MexImage* hit = findMex(&ni);
+    ni.mtime++;
+    MexImage* miss = findMex(&ni);
+    report("cache", hit != image || miss != NULL || getRef(&image->refs) != 3);
+
+    releaseMex(hit);
+    releaseMex(image);
+    return failures != 0;
+}
@@ -0,0 +1,75 @@
+#include <errno.h>
+#include <manos.h>
+#include <manos/list.h>
+#include <stdio.h>
+
+#include "check.h"
+
+/*
+ * End child Procs through exitProc() and check what waitpid() collects:
+ * exit codes, any child, not waiting, and children orphaned with their
+ * parent.
+ */
+
+static Proc* child(Proc* parent) {
+    rp = parent;
+    Proc* p = newProc(0);
+    if (p)
+        p->state = ProcReady;
+    return p;
+}
+
+static void end(Proc* p, int status) {
+    p->exitStatus = status;
+    p->state = ProcDead;
+    exitProc(p);
+}
+
+int main(void) {
+    static Proc procs[8];
+    INIT_LIST_HEAD(&procFreelist);
+    INIT_LIST_HEAD(&procSpawnQ);
+    INIT_REF(&nextPid);
+    for (unsigned i = 0; i < COUNT_OF(procs); i++)
+        listAddBefore(&procs[i].nextFreelist, &procFreelist);
+    procTable = kmalloc(MANOS_MAXPROC * sizeof *procTable);
+    kmemset(procTable, 0, MANOS_MAXPROC * sizeof *procTable);
+
+    rp = NULL;
+    Proc* parent = newProc(0);
+    Proc* a = child(parent);
+    Proc* b = child(parent);
+    if (!parent || !a || !b) {
+        printf("cannot make Procs\n");
+        return 1;
+    }
+    int apid = a->pid;
+    int bpid = b->pid;
+
+    int status = -1;
+    report("nohang", waitpid(-1, &status, WAIT_NOHANG) != 0 || status != -1);
+
+    end(b, 7);
+    int bad = b->state != ProcZombie || procTable[bpid] != b;
+    bad |= waitpid(bpid, &status, 0) != bpid || !WAIT_EXITED(status) || WAIT_CODE(status) != 7;
+    report("pid", bad || procTable[bpid] != NULL || b->state != ProcDead);
+
+    end(a, WAIT_KILLED);
+    report("any", waitpid(-1, &status, 0) != apid || WAIT_EXITED(status));
+
+    errno = 0;
+    report("echild", waitpid(-1, &status, WAIT_NOHANG) != -1 || errno != ECHILD ||
+                     waitpid(apid, &status, 0) != -1);
+
+    /* the parent goes first: a live child is orphaned, a zombie freed */
+    Proc* c = child(parent);
+    Proc* d = child(parent);
+    end(d, 0);
+    end(parent, 0);
+    report("orphan", c->ppid != 0 || d->state != ProcDead || parent->state != ProcDead);
+
+    end(c, 0);
+    report("recycle", c->state != ProcDead);
+
+    return failures != 0;
+}
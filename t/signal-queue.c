@@ -0,0 +1,62 @@
+#include <manos.h>
+#include <stdio.h>
+
+#include "check.h"
+
+/*
+ * Queue signals on a Proc and check the order, coalescing and masking
+ * takeSignal() applies.
+ */
+
+/* take signals until none are left and compare them against want */
+static int expectSignals(Proc* p, uint32_t held, const ProcSig* want, unsigned n) {
+    for (unsigned i = 0; i < n; i++) {
+        ProcSig got = takeSignal(p, held);
+        if (got != want[i]) {
+            printf("  signal %u: got %#x want %#x\n", i, (unsigned)got, (unsigned)want[i]);
+            return 1;
+        }
+    }
+    return takeSignal(p, held) != 0;
+}
+
+static void handler(ProcSig sig) {
+    UNUSED(sig);
+}
+
+int main(void) {
+    static Proc proc;
+    Proc* p = &proc;
+    p->signalQ = newHeapQ(MANOS_MAXSIGPENDING);
+
+    /* urgent first, stops coalesce, alarms count */
+    queueSignal(p, SigAlarm);
+    queueSignal(p, SigContinue);
+    queueSignal(p, SigStop);
+    queueSignal(p, SigAlarm);
+    queueSignal(p, SigStop);
+    queueSignal(p, SigAbort);
+    const ProcSig order[] = { SigAbort, SigStop, SigContinue, SigAlarm, SigAlarm };
+    report("order", expectSignals(p, 0, order, COUNT_OF(order)) || p->sigPending != 0);
+
+    /* a held signal stays queued while others pass it */
+    queueSignal(p, SigStop);
+    queueSignal(p, SigAlarm);
+    const ProcSig unheld[] = { SigAlarm };
+    int bad = expectSignals(p, SigStop, unheld, COUNT_OF(unheld)) || p->sigPending != SigStop;
+    const ProcSig released[] = { SigStop };
+    report("held", bad || expectSignals(p, 0, released, COUNT_OF(released)));
+
+    int full = 0;
+    for (unsigned i = 0; i <= MANOS_MAXSIGPENDING; i++)
+        full |= queueSignal(p, SigAlarm) == -1;
+    flushSignals(p);
+    report("full", !full || p->sigPending != 0 || takeSignal(p, 0) != 0);
+
+    rp = p;
+    report("handler", setSignalHandler(SigStop, handler, NULL) == 0 ||
+                      setSignalHandler(SigAlarm, handler, NULL) != 0 ||
+                      caughtSignals(p) != SigAlarm || signalHandler(p, SigAlarm) != handler);
+
+    return failures != 0;
+}